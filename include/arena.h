@@ -0,0 +1,98 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+/*******************************************************************
+ * 	Per-thread arena for the memory of one operation               *
+ *                                                                 *
+ * 	Between `arena_begin` and `arena_end`, bytestreams and GMP     *
+ * 	integers of the calling thread take their memory from a bump   *
+ * 	allocator owned by that thread. Frees are no-ops and the whole *
+ * 	arena is reset at `arena_end`, so an operation that runs again *
+ * 	and again reuses the same memory and, once the arena has grown *
+ * 	to fit it, does not call malloc at all.                        *
+ *                                                                 *
+ * 	Memory taken before the scope keeps coming from the heap, also *
+ * 	when it is freed or grown inside the scope. Bytestreams and    *
+ * 	GMP integers that outlive a scope must therefore be created,   *
+ * 	and grown to their final size, before it begins: whatever is   *
+ * 	allocated inside is gone at `arena_end`.                       *
+ *                                                                 *
+ * 	GMP memory functions are replaced for the whole process on the *
+ * 	first `arena_begin`. The replacements chain to the functions   *
+ * 	GMP had before, as given by mp_get_memory_functions, outside   *
+ * 	of a scope and for memory those took, so GMP integers created  *
+ * 	before the first scope are grown and freed as they were made.  *
+ * 	Bytestreams outside of a scope use malloc, realloc and free.   *
+ *******************************************************************/
+
+/**
+ * 	Arena Constants
+ *
+ * 	ARENA_CHUNK: Minimum size of the memory the arena takes from the heap
+ * 	ARENA_ALIGN: Alignment of every allocation
+ */
+#define ARENA_CHUNK (64 << 10)
+#define ARENA_ALIGN 16
+
+/**
+ * 	Allocations of the last scope of a thread
+ */
+typedef struct _arena_stats_t {
+	size_t allocs; /* Allocations served by the arena */
+	size_t heap; /* Of those, allocations that had to grow it with malloc */
+	size_t bytes; /* Bytes allocated */
+} arena_stats_t;
+
+/**
+ * 	Start a scope on the calling thread
+ * 	Scopes nest, only the outermost one resets the arena
+ */
+void arena_begin();
+
+/**
+ * 	End a scope on the calling thread, resetting the arena if it is the
+ * 	outermost one. Memory taken from the heap to grow the arena is kept
+ * 	in one block for the next scope
+ */
+void arena_end();
+
+/**
+ * 	Allocations of the last outermost scope ended by the calling thread
+ *
+ * 	@param stats Where to store them
+ */
+void arena_stats(arena_stats_t *stats);
+
+/**
+ * 	Allocate memory, from the arena inside a scope, else from the heap
+ *
+ * 	@param size Number of bytes
+ * 	@return The memory, aligned to ARENA_ALIGN inside a scope
+ */
+void *arena_alloc(size_t size);
+
+/**
+ * 	Resize memory from `arena_alloc`
+ * 	Heap memory stays on the heap. Arena memory grows in place if it is
+ * 	the last allocation, otherwise it is copied
+ *
+ * 	@param ptr Memory to resize
+ * 	@param old Its size
+ * 	@param size New size
+ * 	@return The resized memory
+ */
+void *arena_realloc(void *ptr, size_t old, size_t size);
+
+/**
+ * 	Free memory from `arena_alloc`
+ * 	Heap memory is freed, arena memory is only taken back if it is the
+ * 	last allocation
+ *
+ * 	@param ptr Memory to free
+ * 	@param size Its size
+ */
+void arena_free(void *ptr, size_t size);
+
+#endif
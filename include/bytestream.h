@@ -14,6 +14,14 @@
  * 	for the results, if any. Other arguments are used as operands. *
  * 	A bytestream can be both a function destination and operand at *
  * 	the same time.                                                 *
+ *                                                                 *
+ * 	Views are non-owning windows over bytes held somewhere else,   *
+ * 	passed by value, so reading a part of a bytestream or a buffer *
+ * 	does not copy it.                                              *
+ *                                                                 *
+ * 	Bytestream memory comes from `arena_alloc`, so bytestreams     *
+ * 	made inside an arena scope only live until it ends, see        *
+ * 	arena.h.                                                       *
  *******************************************************************/
 
 /**
@@ -39,6 +47,21 @@ typedef struct _bytestream_t {
 	size_t _avail; /* Max size the bytestream can hold */
 } * bytestream_t[1];
 
+/**
+ * 	Bytestream view
+ *
+ * 	`len` bytes at `data`, owned by a bytestream or any other object.
+ * 	A view is never cleared and is only valid while the bytes it points
+ * 	to are, so it must not be kept across a call that may grow the
+ * 	bytestream it points into
+ *
+ * 	Used in function arguments as by-value value
+ */
+typedef struct _bs_view_t {
+	const byte_t *data; /* First byte */
+	size_t len; /* Number of bytes */
+} bs_view_t;
+
 /**
  * 	Initialize a bytestream with default size
  * 	One bytestream should not be initialized more than once
@@ -76,6 +99,15 @@ void bs_set(bytestream_t bs, bytestream_t const op1);
  */
 void bs_set_b(bytestream_t bs, void * const bytes, size_t len);
 
+/**
+ * 	Set a bytestream with the bytes of a view
+ * 	The view must not point into the bytestream
+ *
+ * 	@param bs Bytestream to have bytes copied into
+ * 	@param op1 View to copy bytes from
+ */
+void bs_set_view(bytestream_t bs, bs_view_t op1);
+
 /**
  * 	Concatenate two bytestreams
  *
@@ -85,6 +117,16 @@ void bs_set_b(bytestream_t bs, void * const bytes, size_t len);
  */
 void bs_concat(bytestream_t bs, bytestream_t const op1, bytestream_t const op2);
 
+/**
+ * 	Concatenate a view to a bytestream
+ * 	The view must not point into `bs`
+ *
+ * 	@param bs Bytestream to hold concatenated bytestreams
+ * 	@param op1 A bytestream
+ * 	@param op2 A view
+ */
+void bs_concat_view(bytestream_t bs, bytestream_t const op1, bs_view_t op2);
+
 /**
  * 	Concatenate a byte to a bytestream
  *
@@ -109,10 +151,38 @@ void bs_concat_zero(bytestream_t bs, bytestream_t const op1, size_t len);
  * 	@param bs Bytestream to hold trimmed bytestream
  * 	@param op1 Bytestream to be trimmed
  * 	@param len Number of bytes to be trimmed. If `len` is negative, bytes
- * 	are trimmed from the begining of the stream, otherwise, from the end
+ * 	are trimmed from the begining of the stream, otherwise, from the end.
+ * 	Trimming the end of a bytestream into itself moves no bytes
  */
 void bs_trim(bytestream_t bs, bytestream_t const op1, int len);
 
+/**
+ * 	View of the bytes of a bytestream
+ *
+ * 	@param bs A bytestream
+ * 	@return A view of all of its bytes
+ */
+bs_view_t bs_view(bytestream_t const bs);
+
+/**
+ * 	View of the bytes of a generic object
+ *
+ * 	@param bytes First byte
+ * 	@param len Number of bytes
+ * 	@return A view of `len` bytes at `bytes`
+ */
+bs_view_t bs_view_b(const void *bytes, size_t len);
+
+/**
+ * 	View of a part of a view
+ *
+ * 	@param op A view
+ * 	@param start Index of the first byte, views past the end are empty
+ * 	@param len Number of bytes, at most the bytes left after `start`
+ * 	@return A view of bytes `start` to `start + len` of `op`
+ */
+bs_view_t bs_view_sub(bs_view_t op, size_t start, size_t len);
+
 /**
  * 	Clear memory used by a bytestream
  * 	Should be called when a bytestream will no longer be used
@@ -164,14 +234,45 @@ void bs_load(bytestream_t dest, void * const src, size_t size, int start, int en
  */
 void mpz_set_bs(mpz_t rot, bytestream_t const op);
 
+/**
+ *  Set a GMP integer from the bytes of a view, most significant first
+ *
+ *  @param rot Target GMP integer
+ *  @param op Source view
+ */
+void mpz_set_view(mpz_t rot, bs_view_t op);
+
 /**
  * 	Set a bytestream from the bytes of a GMP integer
+ * 	The bytes are exported straight into the bytestream, leading zero
+ * 	bytes are dropped
  *
  * 	@param bs Target bytestream
  * 	@param op Source GMP integer
  */
 void bs_set_mpz(bytestream_t bs, mpz_t const op);
 
+/**
+ * 	Set a bytestream to exactly `size` bytes of a GMP integer, with
+ * 	leading zero bytes kept
+ *
+ * 	@param bs Target bytestream
+ * 	@param op Source GMP integer
+ * 	@param size Number of bytes, see `bs_save_mpz`
+ */
+void bs_set_mpz_size(bytestream_t bs, mpz_t const op, size_t size);
+
+/**
+ * 	Save the `size` least significant bytes of a GMP integer in a
+ * 	destination, most significant first and padded with zero bytes
+ * 	Nothing is allocated
+ *
+ * 	@param dest Pointer to destination of `size` bytes
+ * 	@param op Source non-negative GMP integer
+ * 	@param size Number of bytes
+ */
+void bs_save_mpz(void *dest, mpz_t const op, size_t size);
+
 /**
  * 	Get length of a bytestream in bytes
  *
@@ -0,0 +1,81 @@
+#ifndef __CHUNKIDX_H__
+#define __CHUNKIDX_H__
+
+#include "bytestream.h"
+
+/*******************************************************************
+ * 	Content-defined chunk index                                    *
+ *                                                                 *
+ * 	A file is cut into chunks where a gear rolling hash over the   *
+ * 	last 64 bytes has its top CHUNKIDX_BITS bits clear, no sooner  *
+ * 	than CHUNKIDX_MIN bytes and no later than CHUNKIDX_MAX bytes   *
+ * 	into a chunk. Boundaries follow the content, so inserting or   *
+ * 	removing bytes only changes the chunks around the edit.        *
+ *                                                                 *
+ * 	The index is CHUNKIDX_MAGIC, the file size and the number of   *
+ * 	chunks as `word_t`, then an entry per chunk: its offset as a   *
+ * 	`word_t` and its SHA3-256 digest. A byte range of the file is  *
+ * 	checked by reading and hashing only the chunks covering it.    *
+ * 	An empty file has no chunks.                                   *
+ *******************************************************************/
+
+/**
+ * 	Chunk Index Constants
+ *
+ * 	CHUNKIDX_MAGIC: First bytes of an index
+ * 	CHUNKIDX_MAGICLEN: Length of CHUNKIDX_MAGIC
+ * 	CHUNKIDX_HEAD: Bytes before the first entry
+ * 	CHUNKIDX_DIGESTLEN: Bytes of a chunk digest
+ * 	CHUNKIDX_ENTRY: Bytes of an entry
+ * 	CHUNKIDX_MIN: Smallest chunk but the last
+ * 	CHUNKIDX_MAX: Largest chunk
+ * 	CHUNKIDX_BITS: Hash bits that must be clear at a boundary, for
+ * 	chunks of CHUNKIDX_MIN + 2^CHUNKIDX_BITS bytes on average
+ * 	CHUNKIDX_CUSTOM: cSHAKE256 customization string of signed indexes
+ */
+#define CHUNKIDX_MAGIC "RSACDC01"
+#define CHUNKIDX_MAGICLEN 8
+#define CHUNKIDX_HEAD (CHUNKIDX_MAGICLEN + 2 * sizeof(word_t))
+#define CHUNKIDX_DIGESTLEN 32
+#define CHUNKIDX_ENTRY (sizeof(word_t) + CHUNKIDX_DIGESTLEN)
+#define CHUNKIDX_MIN (16 << 10)
+#define CHUNKIDX_MAX (256 << 10)
+#define CHUNKIDX_BITS 16
+#define CHUNKIDX_CUSTOM "RSA chunk index"
+
+/**
+ * 	Chunk index of a file
+ * 	The file is read with the backend set by `input_set_backend`, in
+ * 	constant memory
+ *
+ * 	@param index Bytestream to hold the index
+ * 	@param filepath File path, STDIOPATH for the standard input
+ */
+void chunkidx_file(bytestream_t index, char * const filepath);
+
+/**
+ * 	Length of the index a view starts with
+ * 	Offsets must start at 0 and grow by chunks of at most CHUNKIDX_MAX
+ * 	bytes up to the file size
+ *
+ * 	@param view View starting with an index
+ * 	@return Bytes of the index, 0 if the view does not start with a
+ * 	valid one
+ */
+size_t chunkidx_len(bs_view_t view);
+
+/**
+ * 	Check a byte range of a file against an index
+ * 	Only the chunks covering the range are read, with `pread`
+ *
+ * 	@param index View of an index checked by `chunkidx_len`
+ * 	@param filepath File path, not the standard input
+ * 	@param offset First byte of the range
+ * 	@param length Bytes of the range
+ * 	@return Whether the file has the indexed size and every chunk
+ * 	covering the range has its indexed digest, 0 if the range goes past
+ * 	the end of the file
+ */
+int chunkidx_verify_range(bs_view_t index, char * const filepath, size_t offset, size_t length);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef __ENCFILE_H__
+#define __ENCFILE_H__
+
+#include "rsa.h"
+
+/*******************************************************************
+ * 	Encryption of files of any size                                *
+ *                                                                 *
+ * 	A file is split into records of OAEP_MSGLEN bytes, the last    *
+ * 	one shorter, and every record is encrypted on its own. The     *
+ * 	encrypted file starts with a header of ENCFILE_HEAD bytes:     *
+ * 	ENCFILE_MAGIC, then the plaintext length, the record length    *
+ * 	and the cipher length as `word_t`. The ciphers follow, each as *
+ * 	long as the key modulo, so record i of either file is found at *
+ * 	a fixed offset.                                                *
+ *                                                                 *
+ * 	Records are independent: they are encrypted and decrypted in   *
+ * 	groups of ENCFILE_GROUP on a thread pool, each worker with its *
+ * 	own key context, and written in place with `pwrite`. Groups    *
+ * 	run ENCFILE_BATCH records at a time, and a batch only starts   *
+ * 	when the previous one is written, so an interrupted run can be *
+ * 	resumed from the last batch the output reaches into.           *
+ *******************************************************************/
+
+/**
+ * 	Encrypted File Constants
+ *
+ * 	ENCFILE_MAGIC: First bytes of an encrypted file
+ * 	ENCFILE_MAGICLEN: Length of ENCFILE_MAGIC
+ * 	ENCFILE_HEAD: Bytes before the first cipher
+ * 	ENCFILE_GROUP: Records handed to a worker at a time
+ * 	ENCFILE_BATCH: Records written before the next ones are started
+ */
+#define ENCFILE_MAGIC "RSAENC01"
+#define ENCFILE_MAGICLEN 8
+#define ENCFILE_HEAD (ENCFILE_MAGICLEN + 3 * sizeof(word_t))
+#define ENCFILE_GROUP 64
+#define ENCFILE_BATCH 4096
+
+/**
+ * 	Encrypt a file into an encrypted file
+ * 	When resuming, an output with the header of this file and key keeps
+ * 	its records up to the last batch it reaches into, any other output
+ * 	is an error
+ *
+ * 	@param outpath Encrypted file path
+ * 	@param filepath File path
+ * 	@param key RSA key
+ * 	@param threads Number of threads, at least 1
+ * 	@param resume Whether to keep the records already in the output
+ * 	@return Number of records encrypted
+ */
+size_t encfile_encrypt(char * const outpath, char * const filepath, rsa_key_t const key, int threads, int resume);
+
+/**
+ * 	Decrypt an encrypted file
+ * 	When resuming, the output keeps its records up to the last batch it
+ * 	reaches into
+ *
+ * 	@param outpath Decrypted file path
+ * 	@param filepath Encrypted file path
+ * 	@param key RSA key
+ * 	@param threads Number of threads, at least 1
+ * 	@param resume Whether to keep the records already in the output
+ * 	@return Number of records decrypted
+ */
+size_t encfile_decrypt(char * const outpath, char * const filepath, rsa_key_t const key, int threads, int resume);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+#include "bytestream.h"
+
+/*******************************************************************
+ * 	File input backends                                            *
+ *                                                                 *
+ * 	Files are read whole and handed to a consumer, such as a SHA3  *
+ * 	context, straight from where the backend put them:             *
+ * 	- stdio: fread through a buffer of IOBUFSIZE bytes             *
+ * 	- mmap: the file mapped with MADV_SEQUENTIAL, in one piece.    *
+ * 	  Files other than regular ones, as pipes, are read with stdio *
+ * 	- pread: pread through a buffer of INPUT_BUFSIZE bytes, with   *
+ * 	  POSIX_FADV_SEQUENTIAL                                        *
+ * 	- direct: O_DIRECT reads into an aligned buffer of             *
+ * 	  INPUT_BUFSIZE bytes, bypassing the page cache. Files on      *
+ * 	  file systems without O_DIRECT are read with pread instead    *
+ *                                                                 *
+ * 	The backend used by the file functions of rsa.h is set once    *
+ * 	for the process with `input_set_backend`, stdio by default.    *
+ * 	A file path of STDIOPATH reads the standard input through a    *
+ * 	buffer of INPUT_BUFSIZE bytes whatever the backend, so pipes   *
+ * 	are read in constant memory.                                   *
+ *******************************************************************/
+
+/**
+ * 	Input Constants
+ *
+ * 	INPUT_STDIO, INPUT_MMAP, INPUT_PREAD, INPUT_DIRECT: Backends
+ * 	INPUT_BACKENDS: Number of backends
+ * 	INPUT_BUFSIZE: Size of the buffer of the pread and direct backends
+ * 	INPUT_ALIGN: Alignment of the buffer and reads of the direct backend
+ */
+#define INPUT_STDIO 0
+#define INPUT_MMAP 1
+#define INPUT_PREAD 2
+#define INPUT_DIRECT 3
+#define INPUT_BACKENDS 4
+#define INPUT_BUFSIZE (1 << 20)
+#define INPUT_ALIGN 4096
+
+/* Consume `len` bytes of a file, in order */
+typedef void (*input_fn)(void *arg, const byte_t *data, size_t len);
+
+/**
+ * 	Backend of a name
+ *
+ * 	@param name "stdio", "mmap", "pread" or "direct"
+ * 	@return The backend, -1 if there is none of that name
+ */
+int input_backend(char const *name);
+
+/**
+ * 	Name of a backend
+ *
+ * 	@param backend A backend
+ * 	@return Its name
+ */
+char const *input_name(int backend);
+
+/**
+ * 	Set the backend used by `input_file`, before any thread reads
+ *
+ * 	@param backend A backend
+ */
+void input_set_backend(int backend);
+
+/**
+ * 	Read a whole file with a backend
+ *
+ * 	@param filepath File path, or STDIOPATH for the standard input
+ * 	@param backend A backend
+ * 	@param fn Consumer of the file bytes
+ * 	@param arg Argument given to every call of `fn`
+ */
+void input_read(char * const filepath, int backend, input_fn fn, void *arg);
+
+/**
+ * 	Read a whole file with the backend set by `input_set_backend`
+ *
+ * 	@param filepath File path, or STDIOPATH for the standard input
+ * 	@param fn Consumer of the file bytes
+ * 	@param arg Argument given to every call of `fn`
+ */
+void input_file(char * const filepath, input_fn fn, void *arg);
+
+#endif
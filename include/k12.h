@@ -0,0 +1,83 @@
+#ifndef __K12_H__
+#define __K12_H__
+
+#include "sha3.h"
+
+/*******************************************************************
+ * 	KangarooTwelve (RFC 9861)                                      *
+ *                                                                 *
+ * 	TurboSHAKE128, a sponge of rate SHAKE128_RATE over the 12      *
+ * 	rounds of `keccak_p12`, on a tree of K12_CHUNK byte chunks.    *
+ * 	S is the message, the customization string and the length     *
+ * 	encoding of the latter. Up to K12_CHUNK bytes, S is hashed     *
+ * 	alone. Else every chunk after the first is hashed to a         *
+ * 	K12_CVLEN byte chaining value, SHA3_XN_MAXLANES chunks at a    *
+ * 	time in the SIMD lanes of `turboshake128_xn`, and the final    *
+ * 	node absorbs the first chunk, then the chaining values as they *
+ * 	come. Nothing but the chunks of the current batch is buffered, *
+ * 	so messages of any size are hashed in constant memory.         *
+ *******************************************************************/
+
+/**
+ * 	KangarooTwelve Constants
+ *
+ * 	K12_CHUNK: Bytes of a chunk
+ * 	K12_CVLEN: Bytes of a chunk chaining value
+ * 	K12_BATCH: Bytes of chunks hashed at once
+ */
+#define K12_CHUNK 8192
+#define K12_CVLEN 32
+#define K12_BATCH (SHA3_XN_MAXLANES * K12_CHUNK)
+
+/**
+ * 	KangarooTwelve incremental context
+ * 	Used in function arguments as by-reference value
+ */
+typedef struct _k12_ctx_t {
+	sha3_ctx_t _node; /* Final node */
+	byte_t _chunks[K12_BATCH]; /* Chunks after the first not yet hashed */
+	size_t _chunklen; /* Number of occupied bytes in `_chunks` */
+	uint64_t _absorbed; /* Number of bytes of S absorbed */
+	uint64_t _nchunks; /* Number of chaining values absorbed */
+} k12_ctx_t[1];
+
+/**
+ * 	Initialize an incremental KangarooTwelve context
+ *
+ * 	@param ctx A KangarooTwelve context
+ * 	@param len Output length in bits
+ */
+void k12_init(k12_ctx_t ctx, size_t len);
+
+/**
+ * 	Absorb bytes of the message into a KangarooTwelve context
+ *
+ * 	@param ctx A KangarooTwelve context
+ * 	@param data Bytes to be hashed
+ * 	@param size Number of bytes in `data`
+ */
+void k12_update(k12_ctx_t ctx, const void *data, size_t size);
+
+/**
+ * 	Absorb the customization string, squeeze the hash and clear the
+ * 	context
+ * 	The context must be initialized again before being reused
+ *
+ * 	@param hash Bytestream to hold hashed data
+ * 	@param ctx A KangarooTwelve context
+ * 	@param custom Customization string, may be empty
+ */
+void k12_final(bytestream_t hash, k12_ctx_t ctx, bs_view_t custom);
+
+/**
+ * 	KangarooTwelve of a view
+ *
+ * 	@param hash Bytestream to hold hashed data, not the one `msg` points
+ * 	into
+ * 	@param msg View of the data to be hashed
+ * 	@param custom Customization string, may be empty
+ * 	@param len Output length in bits
+ */
+void k12(bytestream_t hash, bs_view_t msg, bs_view_t custom, size_t len);
+
+#endif
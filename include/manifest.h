@@ -0,0 +1,84 @@
+#ifndef __MANIFEST_H__
+#define __MANIFEST_H__
+
+#include "rsa.h"
+#include "pipeline.h"
+
+/*******************************************************************
+ * 	Manifests of files to verify                                   *
+ *                                                                 *
+ * 	A manifest is a text file of entries made of three paths       *
+ * 	separated by white space: a file, its signature and the key to *
+ * 	verify it with. Lines starting with '#' are comments. Every    *
+ * 	distinct key path is loaded once.                              *
+ *******************************************************************/
+
+/**
+ * 	Manifest Constants
+ *
+ * 	MANIFEST_MAXPATH: Maximum length of a path in a manifest, plus one
+ */
+#define MANIFEST_MAXPATH 4096
+
+/**
+ * 	Manifest object
+ *
+ * 	Used in function arguments as by-reference value
+ */
+typedef struct _manifest_t {
+	char **files; /* Files to verify */
+	char **signs; /* Their signature files */
+	size_t *keys; /* Index of their keys in `_keys` */
+	size_t count; /* Number of entries */
+	rsa_key_t *_keys; /* Every distinct key */
+	char **_keypaths; /* Their paths */
+	size_t _nkeys; /* Number of distinct keys */
+} manifest_t[1];
+
+/**
+ * 	Load a manifest and its keys
+ *
+ * 	@param manifest A manifest object
+ * 	@param filepath Manifest file path
+ */
+void manifest_load(manifest_t manifest, char * const filepath);
+
+/**
+ * 	Clear memory used by a manifest and its keys
+ *
+ * 	@param manifest A manifest object
+ */
+void manifest_clear(manifest_t manifest);
+
+/**
+ * 	Verify every entry of a manifest in a thread pool
+ * 	Every thread has its own key context for every key. Entries that
+ * 	cannot be read are reported on the standard error and the others are
+ * 	still verified
+ *
+ * 	@param valid Array of `manifest->count` integers set to 1 for each valid
+ * 	entry, 0 for each invalid one and -1 for each whose file or signature
+ * 	could not be read
+ * 	@param manifest A manifest object
+ * 	@param threads Number of threads, at least 1
+ * 	@return Number of valid entries
+ */
+size_t manifest_verify(int *valid, manifest_t const manifest, int threads);
+
+/**
+ * 	Verify every entry of a manifest in a pipeline, see `pipeline_run`
+ * 	Files are read and hashed by the pipeline threads while the calling
+ * 	thread verifies the signatures of those already hashed
+ *
+ * 	@param valid Array of `manifest->count` integers set to 1 for each valid
+ * 	entry, 0 for each invalid one and -1 for each whose file or signature
+ * 	could not be read
+ * 	@param stats Time spent by the stages of the pipeline, or NULL
+ * 	@param manifest A manifest object
+ * 	@param slots Number of slots in the ring, at least 1
+ * 	@param threads Number of hashing threads, at least 1
+ * 	@return Number of valid entries
+ */
+size_t manifest_verify_pipeline(int *valid, pipeline_stats_t *stats, manifest_t const manifest, int slots, int threads);
+
+#endif
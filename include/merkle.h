@@ -0,0 +1,97 @@
+#ifndef __MERKLE_H__
+#define __MERKLE_H__
+
+#include "bytestream.h"
+
+/*******************************************************************
+ * 	cSHAKE256 Merkle tree over the digests of many messages        *
+ *                                                                 *
+ * 	Every hash is cSHAKE256 with MERKLE_CUSTOM, written H. Leaves  *
+ * 	are H(0x00 || digest) and inner nodes are                      *
+ * 	H(0x01 || left || right), each level hashed at once with       *
+ * 	`cshake256_xn`. The last node of a level with an odd number of *
+ * 	nodes goes up unchanged. The root committed to is              *
+ * 	H(0x02 || count || top node), with the number of leaves as 8   *
+ * 	little endian bytes, so the shape of the tree is fixed. The    *
+ * 	customization string keeps roots apart from SHAKE256 digests   *
+ * 	of files, so a signed root is never a plain file signature.    *
+ *******************************************************************/
+
+/**
+ * 	Merkle Constants
+ *
+ * 	MERKLE_MAXPATH: Maximum number of nodes in an inclusion path
+ * 	MERKLE_CUSTOM: cSHAKE256 customization string of every hash
+ */
+#define MERKLE_MAXPATH 64
+#define MERKLE_CUSTOM "RSA batch"
+
+/**
+ * 	Merkle tree
+ *
+ * 	Used in function arguments as by-reference value
+ */
+typedef struct _merkle_t {
+	bytestream_t *_nodes; /* Every level of the tree, leaves first */
+	size_t _nnodes; /* Number of nodes in `_nodes` */
+	size_t _count; /* Number of leaves */
+	size_t _len; /* Output length of the hashes in bits */
+} merkle_t[1];
+
+/**
+ * 	Build a Merkle tree
+ *
+ * 	@param tree A Merkle tree
+ * 	@param digests Array of `count` bytestreams with the message digests
+ * 	@param count Number of messages, at least 1
+ * 	@param len Output length of the hashes in bits
+ */
+void merkle_init(merkle_t tree, bytestream_t *digests, size_t count, size_t len);
+
+/**
+ * 	Clear memory used by a Merkle tree
+ *
+ * 	@param tree A Merkle tree
+ */
+void merkle_clear(merkle_t tree);
+
+/**
+ * 	Root committed to by a Merkle tree
+ *
+ * 	@param root Bytestream to hold the root
+ * 	@param tree A Merkle tree
+ */
+void merkle_root(bytestream_t root, merkle_t const tree);
+
+/**
+ * 	Number of nodes in the inclusion path of a leaf
+ *
+ * 	@param index Index of the leaf
+ * 	@param count Number of leaves
+ * 	@return Number of nodes
+ */
+size_t merkle_path_len(size_t index, size_t count);
+
+/**
+ * 	Inclusion path of a leaf, its sibling nodes from the leaves up
+ *
+ * 	@param path Array of `merkle_path_len` initialized bytestreams to hold the nodes
+ * 	@param tree A Merkle tree
+ * 	@param index Index of the leaf
+ */
+void merkle_path(bytestream_t *path, merkle_t const tree, size_t index);
+
+/**
+ * 	Root committed to by a tree holding a digest, from its inclusion path
+ * 	Equal to `merkle_root` of the tree when the digest and path are right
+ *
+ * 	@param root Bytestream to hold the root
+ * 	@param digest Bytestream with the message digest
+ * 	@param index Index of the leaf
+ * 	@param count Number of leaves
+ * 	@param path Array of `merkle_path_len` views of the path nodes
+ * 	@param len Output length of the hashes in bits
+ */
+void merkle_root_path(bytestream_t root, bytestream_t const digest, size_t index, size_t count, bs_view_t *path, size_t len);
+
+#endif
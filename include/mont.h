@@ -0,0 +1,137 @@
+#ifndef __MONT_H__
+#define __MONT_H__
+
+#include <gmp.h>
+
+/*******************************************************************
+ * 	Montgomery exponentiation on GMP limbs for a fixed odd modulo  *
+ *                                                                 *
+ * 	All constants of the modulo, the recoded secret exponent and   *
+ * 	the scratch space used by the operations are computed and      *
+ * 	allocated once by `mont_init`, so exponentiations do not       *
+ * 	allocate. Moduli of MONT_SIZES limbs use code specialized for  *
+ * 	that size, others use the same code with a runtime size.       *
+ * 	Numbers are kept in 52-bit digits multiplied with AVX-512 IFMA *
+ * 	on CPUs that have it, or in 64-bit limbs multiplied with       *
+ * 	mpn_sec_mul and mpn_sec_sqr, the secret exponent going through *
+ * 	the same fixed window in both. A Montgomery object is not      *
+ * 	thread safe, as operations share its scratch space.            *
+ *                                                                 *
+ * 	The `_xn` functions raise many bases to the same exponent, a   *
+ * 	group at a time in SIMD lanes: 8 in 52-bit digits with AVX-512 *
+ * 	IFMA or 4 in 26-bit digits with AVX2, falling back to one at a *
+ * 	time on other CPUs.                                            *
+ *******************************************************************/
+
+/**
+ * 	Montgomery Constants
+ *
+ * 	MONT_WINDOW: Bits of the secret exponent consumed per multiplication
+ * 	MONT_MAXLIMBS: Maximum number of limbs in a modulo
+ * 	MONT_SIZES: Modulo sizes in limbs with specialized code (1024, 2048,
+ * 	3072 and 4096 bits), as a list of X(limbs)
+ */
+#define MONT_WINDOW 5
+#define MONT_MAXLIMBS 128
+#define MONT_SIZES(X) X(16) X(32) X(48) X(64)
+
+struct _mont_t;
+
+/* Exponentiation of `m->_n` limbs, by `exp` or by the recoded exponent if NULL */
+typedef void (*mont_powm_fn)(struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *xp, mpz_srcptr exp);
+
+/**
+ * 	Montgomery object for a modulo m
+ *
+ * 	Used in function arguments as by-reference value
+ */
+typedef struct _mont_t {
+	mp_size_t _n; /* Number of limbs in the modulo */
+	mp_size_t _w; /* Number of words of a number in the representation used */
+	mp_limb_t *_mod; /* Modulo */
+	mp_limb_t _minv; /* -m ^ -1 mod 2 ^ 64 */
+	mp_limb_t *_r2; /* R ^ 2 mod m, to convert into Montgomery form */
+	mp_limb_t *_one; /* The integer 1, to convert out of Montgomery form */
+	mp_limb_t *_x; /* Base of an exponentiation */
+	mp_limb_t *_y; /* Accumulator of an exponentiation */
+	mp_limb_t *_t; /* Table entry selected for a multiplication */
+	mp_limb_t *_table; /* Powers 0 to 2 ^ MONT_WINDOW - 1 of the base */
+	mp_limb_t *_scratch; /* Scratch space of mpn_sec_mul and mpn_sec_sqr */
+	unsigned char *_digits; /* Secret exponent in MONT_WINDOW-bit digits, most significant first */
+	size_t _ndigits; /* Number of digits in `_digits` */
+	mont_powm_fn _powm; /* Exponentiation for this size */
+	mp_limb_t *_xn; /* Multi-lane constants, table and scratch space, allocated on first use */
+	mpz_t _m; /* Modulo */
+	mpz_t _base; /* Base reduced modulo m */
+} mont_t[1];
+
+/**
+ * 	Initialize a Montgomery object
+ *
+ * 	@param m A Montgomery object
+ * 	@param mod Odd modulo of at most MONT_MAXLIMBS limbs
+ * 	@param exp Exponent used by `mont_powm_sec`, recoded once here
+ */
+void mont_init(mont_t m, mpz_t const mod, mpz_t const exp);
+
+/**
+ * 	Clear memory used by a Montgomery object
+ *
+ * 	@param m A Montgomery object
+ */
+void mont_clear(mont_t m);
+
+/**
+ * 	Compute rop = base ^ exp mod m in variable time
+ * 	Only for public exponents, the time taken depends on the bits of `exp`
+ *
+ * 	@param rop Target GMP integer
+ * 	@param base Base GMP integer
+ * 	@param exp Exponent, 0 or more
+ * 	@param m A Montgomery object
+ */
+void mont_powm(mpz_t rop, mpz_t const base, mpz_t const exp, mont_t m);
+
+/**
+ * 	Compute rop = base ^ exp mod m with the exponent given to `mont_init`
+ * 	Squarings, multiplications and table reads do not depend on the
+ * 	exponent bits
+ *
+ * 	@param rop Target GMP integer
+ * 	@param base Base GMP integer
+ * 	@param m A Montgomery object
+ */
+void mont_powm_sec(mpz_t rop, mpz_t const base, mont_t m);
+
+/**
+ * 	Compute rops[i] = bases[i] ^ exp mod m in variable time for many bases
+ * 	`rops` may be `bases`
+ *
+ * 	@param rops Array of `count` target GMP integers
+ * 	@param bases Array of `count` base GMP integers
+ * 	@param count Number of bases
+ * 	@param exp Exponent, 0 or more
+ * 	@param m A Montgomery object
+ */
+void mont_powm_xn(mpz_t *rops, mpz_t *bases, size_t count, mpz_t const exp, mont_t m);
+
+/**
+ * 	Compute rops[i] = bases[i] ^ exp mod m with the exponent given to
+ * 	`mont_init` for many bases, in constant time as `mont_powm_sec`
+ * 	`rops` may be `bases`
+ *
+ * 	@param rops Array of `count` target GMP integers
+ * 	@param bases Array of `count` base GMP integers
+ * 	@param count Number of bases
+ * 	@param m A Montgomery object
+ */
+void mont_powm_sec_xn(mpz_t *rops, mpz_t *bases, size_t count, mont_t m);
+
+/**
+ * 	Number of exponentiations the `_xn` functions run at a time
+ *
+ * 	@return 8, 4 or 1
+ */
+int mont_xn_lanes();
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "bytestream.h"
+#include <stdio.h>
+
+/*******************************************************************
+ * 	Pipeline hashing many files while they are read                *
+ *                                                                 *
+ * 	Reader threads read the files in slots of PIPELINE_SLOTSIZE    *
+ * 	bytes from a ring of a fixed number of slots, waiting for a    *
+ * 	free slot when the ring is full. Hashing threads absorb the    *
+ * 	filled slots into the SHA3 state of their file, chunks of one  *
+ * 	file in order and chunks of different files at once, then free *
+ * 	them. The calling thread is the final stage: it gets every     *
+ * 	digest as soon as its file is hashed, to sign or verify it.    *
+ * 	Digests are the same as `rsa_sign_file` computes. A file that  *
+ * 	cannot be opened or fails to read is reported on the standard  *
+ * 	error and reaches the final stage without a digest.            *
+ *******************************************************************/
+
+/**
+ * 	Pipeline Constants
+ *
+ * 	PIPELINE_SLOTSIZE: Bytes read into a slot at a time
+ * 	PIPELINE_READERS: Number of reader threads
+ * 	PIPELINE_STAGES: Number of stages, readers, hashers and the final one
+ */
+#define PIPELINE_SLOTSIZE (1 << 20)
+#define PIPELINE_READERS 2
+#define PIPELINE_STAGES 3
+
+/* Final stage of file `item`, with its digest, NULL if the file could not be read */
+typedef void (*pipeline_fn)(void *arg, size_t item, bytestream_t const digest);
+
+/**
+ * 	Time spent by the stages of a pipeline run
+ */
+typedef struct _pipeline_stats_t {
+	double wall; /* Seconds from start to end */
+	int slots; /* Number of slots in the ring */
+	int threads[PIPELINE_STAGES]; /* Threads of every stage */
+	double busy[PIPELINE_STAGES]; /* Seconds every stage spent working, over its threads */
+	double blocked; /* Seconds readers waited for a free slot, over their threads */
+} pipeline_stats_t;
+
+/**
+ * 	Hash files in a pipeline and run `fn` on every digest
+ *
+ * 	@param stats Time spent by the stages, or NULL
+ * 	@param paths Array of `count` file paths
+ * 	@param count Number of files
+ * 	@param fn Final stage, run by the calling thread in the order files are hashed
+ * 	@param arg Argument given to every call of `fn`
+ * 	@param slots Number of slots in the ring, at least 1
+ * 	@param hashers Number of hashing threads, at least 1
+ */
+void pipeline_run(pipeline_stats_t *stats, char **paths, size_t count, pipeline_fn fn, void *arg, int slots, int hashers);
+
+/**
+ * 	Hash files in a pipeline into an array of digests
+ * 	Exits if a file cannot be read
+ *
+ * 	@param stats Time spent by the stages, or NULL
+ * 	@param digests Array of `count` initialized bytestreams to hold the digests
+ * 	@param paths Array of `count` file paths
+ * 	@param count Number of files
+ * 	@param slots Number of slots in the ring, at least 1
+ * 	@param hashers Number of hashing threads, at least 1
+ */
+void pipeline_digests(pipeline_stats_t *stats, bytestream_t *digests, char **paths, size_t count, int slots, int hashers);
+
+/**
+ * 	Print the utilization of every stage of a pipeline run
+ * 	Busy time per thread over the wall time, and how long readers were
+ * 	held back by a full ring
+ *
+ * 	@param file Output file
+ * 	@param stats Time spent by the stages
+ */
+void pipeline_print(FILE *file, pipeline_stats_t const *stats);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stddef.h>
+
+/*******************************************************************
+ * 	Thread pool running one function over many items               *
+ *                                                                 *
+ * 	Workers take the next item from a shared counter until every   *
+ * 	item is done, so slow items do not hold back the others. The   *
+ * 	calling thread is one of the workers.                          *
+ *                                                                 *
+ * 	Tasks that make more tasks, such as walking a directory tree,  *
+ * 	run with `pool_steal_run` instead. Every worker has a deque of *
+ * 	tasks: it pushes and pops its own tasks at the back, so it     *
+ * 	goes depth first, while idle workers steal from the front of   *
+ * 	the others, where the oldest and usually largest tasks are.    *
+ *******************************************************************/
+
+struct _pool_steal_t;
+
+/* Work on item `item` by worker `worker`, with 0 <= worker < threads */
+typedef void (*pool_fn)(void *arg, size_t item, int worker);
+
+/* Run a task by worker `worker`, which may push more tasks to `pool` */
+typedef void (*pool_task_fn)(struct _pool_steal_t *pool, void *arg, void *task, int worker);
+
+/**
+ * 	Number of threads to use by default
+ *
+ * 	@return Number of online processors, at least 1
+ */
+int pool_threads();
+
+/**
+ * 	Run `fn` on every item in `threads` threads and wait for all of them
+ *
+ * 	@param fn Function run on every item
+ * 	@param arg Argument given to every call of `fn`
+ * 	@param count Number of items
+ * 	@param threads Number of threads, at least 1
+ */
+void pool_run(pool_fn fn, void *arg, size_t count, int threads);
+
+/**
+ * 	Run `fn` on every task in `threads` threads with work stealing, and
+ * 	on every task pushed by them, until no task is left
+ *
+ * 	@param fn Function run on every task
+ * 	@param arg Argument given to every call of `fn`
+ * 	@param tasks Array of `count` initial tasks
+ * 	@param count Number of initial tasks
+ * 	@param threads Number of threads, at least 1
+ */
+void pool_steal_run(pool_task_fn fn, void *arg, void **tasks, size_t count, int threads);
+
+/**
+ * 	Push a task to the deque of a worker, from a task it is running
+ *
+ * 	@param pool Pool given to the running task
+ * 	@param worker Worker given to the running task
+ * 	@param task New task
+ */
+void pool_push(struct _pool_steal_t *pool, int worker, void *task);
+
+#endif
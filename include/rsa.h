@@ -2,36 +2,96 @@
 #define __RSA_H__
 
 #include "bytestream.h"
+#include "mont.h"
 #include <gmp.h>
 
 /** RSA Constants
  * 	BITLEN: RSA bit length
  * 	EXPONENT: exponent e for public key generation
  * 	OAEP_K0: k0 constant used for OAEP
+ * 	OAEP_MSGLEN: bytes of the X part of an OAEP encoding, the most a
+ * 	message can have
+ * 	OAEP_RLEN: bytes of the Y part of an OAEP encoding, the random seed
+ * 	OAEP_LEN: bytes of an OAEP encoding, X||Y
+ * 	PRIMES: default number of prime factors of the modulo
+ * 	MAXPRIMES: maximum number of prime factors of the modulo
+ * 	PUBEXPBITS: exponents up to this bit length are public and use
+ * 	variable-time exponentiation
+ * 	BLINDUSES: secret key operations between two random blinding factors
  */
 #define BITLEN 1024
 #define EXPONENT 65537
 #define OAEP_K0 88
+#define OAEP_MSGLEN ((BITLEN - OAEP_K0) / 8)
+#define OAEP_RLEN (OAEP_K0 / 8)
+#define OAEP_LEN (BITLEN / 8)
+#define PRIMES 2
+#define MAXPRIMES 4
+#define PUBEXPBITS 64
+#define BLINDUSES 64
 
 /**	IO Consants
  * 	SIGNSUFFIX: signature file suffix
  * 	PKSUFFIX: public key file suffix
  * 	SKSUFFIX: secret key file suffix
  * 	KEYSUFFIXLEN: maximum length of a key file suffix
+ * 	KEYMPZMAX: most bytes of an integer in a key file, twice those of
+ * 	a modulo
+ * 	IOBUFSIZE: size of the buffer files are streamed through
+ * 	PROOFMAGIC: first bytes of a signature file holding a batch proof
+ * 	PROOFMAGICLEN: length of PROOFMAGIC
+ * 	TREEMAGIC: first bytes of a signature file of a tree hash
+ * 	TREEMAGICLEN: length of TREEMAGIC
+ * 	HASHMAGIC: first bytes of a signature file naming its hash algorithm
+ * 	HASHMAGICLEN: length of HASHMAGIC
+ * 	STDIOPATH: file path standing for the standard input or output
  */
 #define SIGNSUFFIX ".sign"
 #define PKSUFFIX ".pk"
 #define SKSUFFIX ".sk"
 #define KEYSUFFIXLEN 3
+#define KEYMPZMAX (4 * BITLEN / 8)
+#define IOBUFSIZE 65536
+#define PROOFMAGIC "RSAMRKL1"
+#define PROOFMAGICLEN 8
+#define TREEMAGIC "RSATREE1"
+#define TREEMAGICLEN 8
+#define HASHMAGIC "RSAHASH1"
+#define HASHMAGICLEN 8
+#define STDIOPATH "-"
+
+/**	Hash Algorithms of file signatures
+ * 	HASH_SHAKE256: SHAKE256, the hash of signatures without a header
+ * 	HASH_K12: KangarooTwelve with an empty customization string, see k12.h
+ * 	HASH_ALGOS: number of algorithms
+ */
+#define HASH_SHAKE256 0
+#define HASH_K12 1
+#define HASH_ALGOS 2
 
 /**
  * 	RSA key struct
  *
+ * 	Secret keys may also carry their prime factors and the Chinese
+ * 	Remainder Theorem exponents and coefficients (`nprimes` > 0). Primes
+ * 	after the first two are kept in `r`, `d` and `t`, as in PKCS #1
+ * 	multi-prime keys. Public keys and secret keys from old key files only
+ * 	have `mod` and `exp` (`nprimes` == 0). All fields are always initialized.
+ *
  * 	Used in function arguments and returns as by-value value
  */
 typedef struct _rsa_key_t {
 	mpz_t mod; /* Key modulo */
 	mpz_t exp; /* Key exponent */
+	int nprimes; /* Number of prime factors stored, 0 if none */
+	mpz_t p; /* First prime factor */
+	mpz_t q; /* Second prime factor */
+	mpz_t dp; /* exp mod (p - 1) */
+	mpz_t dq; /* exp mod (q - 1) */
+	mpz_t qinv; /* q ^ -1 mod p */
+	mpz_t r[MAXPRIMES - 2]; /* Other prime factors */
+	mpz_t d[MAXPRIMES - 2]; /* exp mod (r[i] - 1) */
+	mpz_t t[MAXPRIMES - 2]; /* (p * q * r[0] * ... * r[i - 1]) ^ -1 mod r[i] */
 } rsa_key_t;
 
 /**
@@ -45,14 +105,115 @@ typedef struct _keypair_t {
 } keypair_t;
 
 /**
- * 	Generate a RSA key pair
+ * 	RSA key context
+ *
+ * 	Built once per key with `rsa_ctx_init` and reused for any number of
+ * 	operations. It holds the Montgomery constants and scratch space of the
+ * 	modulo and of every prime factor, so operations do not repeat that
+ * 	setup. Secret key operations are blinded: the operand is multiplied by
+ * 	r ^ e before the exponentiation and the result by r ^ -1 after it. The
+ * 	pair is squared after every operation and regenerated from a random r
+ * 	every BLINDUSES operations. Making a pair takes an inversion and an
+ * 	exponentiation by e, so a context should outlive a single operation.
+ * 	Secret keys without prime factors do not carry e: EXPONENT, the one
+ * 	of generated keys, is taken and checked against the first result, and
+ * 	only if it is wrong are pairs made with a secret exponentiation.
+ * 	Blinding fields are only set for secret keys. The key must outlive
+ * 	the context. A context is not thread safe. All of its memory is
+ * 	allocated by `rsa_ctx_init`, so a context built outside an arena
+ * 	scope can be used inside one, see arena.h
+ *
+ * 	Used in function arguments as by-reference value
+ */
+typedef struct _rsa_ctx_t {
+	rsa_key_t _key; /* Key the context was built for */
+	int _pub; /* Whether the exponent is public, see PUBEXPBITS */
+	mont_t _mod; /* Montgomery object of the modulo */
+	mont_t _primes[MAXPRIMES]; /* Montgomery objects of the prime factors */
+	mpz_t _m1, _m2, _R; /* CRT recombination temporaries */
+	mpz_t _parts[MAXPRIMES]; /* Residues of an operand modulo every prime factor */
+	mpz_t _e; /* Public exponent of a secret key, 0 if unknown */
+	int _eknown; /* Whether `_e` was derived or checked, else a guess */
+	mpz_t _blind; /* r ^ e mod key modulo */
+	mpz_t _unblind; /* r ^ -1 mod key modulo */
+	unsigned long _blinduses; /* Operations done with the blinding factors */
+} rsa_ctx_t[1];
+
+/**
+ * 	Generate a RSA key pair with PRIMES prime factors
  *
  * 	@return A key pair
  */
 keypair_t rsa_gen_keypair();
 
+/**
+ * 	Generate a RSA key pair with a modulo of `nprimes` prime factors
+ * 	The modulo has the same size for any number of primes, so more primes
+ * 	mean smaller primes and faster key generation and secret key operations
+ *
+ * 	@param nprimes Number of prime factors, from 2 to MAXPRIMES
+ * 	@return A key pair
+ */
+keypair_t rsa_gen_keypair_primes(int nprimes);
+
+/**
+ * 	Compute R(op, key) = op ^ key.exp % key.mod
+ * 	Keys with prime factors use one exponentiation per prime and Garner's
+ * 	recombination instead of one full-size exponentiation. Builds a key
+ * 	context for a single operation, see `rsa_ctx_powm`
+ *
+ * 	@param rop Target GMP integer
+ * 	@param op Base GMP integer
+ * 	@param key RSA key
+ */
+void rsa_powm(mpz_t rop, mpz_t const op, rsa_key_t const key);
+
+/**
+ * 	Initialize a key context
+ *
+ * 	@param ctx A key context
+ * 	@param key RSA key
+ */
+void rsa_ctx_init(rsa_ctx_t ctx, rsa_key_t const key);
+
+/**
+ * 	Clear memory used by a key context
+ *
+ * 	@param ctx A key context
+ */
+void rsa_ctx_clear(rsa_ctx_t ctx);
+
+/**
+ * 	Compute R(op, key) = op ^ key.exp % key.mod with a key context
+ * 	Public exponents use variable-time Montgomery square and multiply.
+ * 	Secret exponents use blinded constant-time exponentiation, per prime
+ * 	factor when the key has them. Their results are checked with e before
+ * 	being returned, and a fault exits.
+ *
+ * 	@param rop Target GMP integer
+ * 	@param op Base GMP integer
+ * 	@param ctx A key context
+ */
+void rsa_ctx_powm(mpz_t rop, mpz_t const op, rsa_ctx_t ctx);
+
+/**
+ * 	Compute R(ops[i], key) for many operands with a key context
+ * 	Exponentiations run a group at a time in SIMD lanes, see `mont_powm_xn`
+ * 	and `mont_powm_sec_xn`
+ *
+ * 	@param rops Array of `count` target GMP integers, may be `ops`
+ * 	@param ops Array of `count` base GMP integers
+ * 	@param count Number of operands
+ * 	@param ctx A key context
+ */
+void rsa_ctx_powm_xn(mpz_t *rops, mpz_t *ops, size_t count, rsa_ctx_t ctx);
+
+/* Bytes of the modulo of a context, the length of its ciphers */
+#define rsa_ctx_bytes(ctx) ((mpz_sizeinbase((ctx)->_key.mod, 2) + 7) / 8)
+
 /**
  * 	Encrypt a byte stream
+ * 	Ciphers have as many bytes as the key modulo
  *
  * 	@param cipher Bytestream to hold encrypted data
  * 	@param msg Bytestream with data to be encrypted
@@ -60,8 +221,40 @@ keypair_t rsa_gen_keypair();
  */
 void rsa_enc(bytestream_t cipher, bytestream_t const msg, rsa_key_t const key);
 
+/**
+ * 	Encrypt a byte stream with a key context
+ *
+ * 	@param cipher Bytestream to hold encrypted data
+ * 	@param msg Bytestream with data to be encrypted
+ * 	@param ctx A key context
+ */
+void rsa_enc_ctx(bytestream_t cipher, bytestream_t const msg, rsa_ctx_t ctx);
+
+/**
+ * 	Encrypt many byte streams with the same key
+ * 	OAEP hashing of the whole batch runs through `shake256_xn_mask` and the
+ * 	exponentiations through `rsa_ctx_powm_xn`
+ *
+ * 	@param ciphers Array of `count` bytestreams to hold encrypted data
+ * 	@param msgs Array of `count` bytestreams with data to be encrypted
+ * 	@param count Number of messages
+ * 	@param key RSA key
+ */
+void rsa_enc_batch(bytestream_t *ciphers, bytestream_t *msgs, size_t count, rsa_key_t const key);
+
+/**
+ * 	Encrypt many byte streams with a key context, see `rsa_enc_batch`
+ *
+ * 	@param ciphers Array of `count` bytestreams to hold encrypted data
+ * 	@param msgs Array of `count` bytestreams with data to be encrypted
+ * 	@param count Number of messages
+ * 	@param ctx A key context
+ */
+void rsa_enc_batch_ctx(bytestream_t *ciphers, bytestream_t *msgs, size_t count, rsa_ctx_t ctx);
+
 /**
  * 	Decrypt a byte stream
+ * 	Messages come out as OAEP_MSGLEN bytes, padded with zero bytes
  *
  * 	@param msg Bytestream to hold decrypted data
  * 	@param cipher Bytestream with data to be decrypted
@@ -69,6 +262,37 @@ void rsa_enc(bytestream_t cipher, bytestream_t const msg, rsa_key_t const key);
  */
 void rsa_dec(bytestream_t msg, bytestream_t const cipher, rsa_key_t const key);
 
+/**
+ * 	Decrypt a byte stream with a key context
+ *
+ * 	@param msg Bytestream to hold decrypted data
+ * 	@param cipher Bytestream with data to be decrypted
+ * 	@param ctx A key context
+ */
+void rsa_dec_ctx(bytestream_t msg, bytestream_t const cipher, rsa_ctx_t ctx);
+
+/**
+ * 	Decrypt many byte streams with the same key
+ * 	OAEP hashing of the whole batch runs through `shake256_xn_mask` and the
+ * 	exponentiations through `rsa_ctx_powm_xn`
+ *
+ * 	@param msgs Array of `count` bytestreams to hold decrypted data
+ * 	@param ciphers Array of `count` bytestreams with data to be decrypted
+ * 	@param count Number of messages
+ * 	@param key RSA key
+ */
+void rsa_dec_batch(bytestream_t *msgs, bytestream_t *ciphers, size_t count, rsa_key_t const key);
+
+/**
+ * 	Decrypt many byte streams with a key context, see `rsa_dec_batch`
+ *
+ * 	@param msgs Array of `count` bytestreams to hold decrypted data
+ * 	@param ciphers Array of `count` bytestreams with data to be decrypted
+ * 	@param count Number of messages
+ * 	@param ctx A key context
+ */
+void rsa_dec_batch_ctx(bytestream_t *msgs, bytestream_t *ciphers, size_t count, rsa_ctx_t ctx);
+
 /**
  * 	Generate a signature for a message
  *
@@ -78,6 +302,15 @@ void rsa_dec(bytestream_t msg, bytestream_t const cipher, rsa_key_t const key);
  */
 void rsa_sign(bytestream_t sign, bytestream_t const msg, rsa_key_t const key);
 
+/**
+ * 	Generate a signature for a message with a key context
+ *
+ * 	@param sign Bytestream to hold the signature
+ * 	@param msg Bytestream with data to be signed
+ * 	@param ctx A key context
+ */
+void rsa_sign_ctx(bytestream_t sign, bytestream_t const msg, rsa_ctx_t ctx);
+
 /**
  * 	Verify a signature for a message
  *
@@ -87,24 +320,143 @@ void rsa_sign(bytestream_t sign, bytestream_t const msg, rsa_key_t const key);
  */
 int rsa_verify(bytestream_t const sign, bytestream_t const msg, rsa_key_t const key);
 
+/**
+ * 	Verify a signature for a message with a key context
+ *
+ * 	@param sign Bytestream with a signature
+ * 	@param msg Bytestream with message data
+ * 	@param ctx A key context
+ */
+int rsa_verify_ctx(bytestream_t const sign, bytestream_t const msg, rsa_ctx_t ctx);
+
+/**
+ * 	Verify many signatures with the same key
+ * 	Messages are hashed with `shake256_xn` and signatures are checked with
+ * 	`rsa_ctx_powm_xn`
+ *
+ * 	@param valid Array of `count` integers set to whether each signature is valid
+ * 	@param signs Array of `count` bytestreams with signatures
+ * 	@param msgs Array of `count` bytestreams with message data
+ * 	@param count Number of messages
+ * 	@param key RSA key
+ * 	@return Whether all signatures are valid
+ */
+int rsa_verify_batch(int *valid, bytestream_t *signs, bytestream_t *msgs, size_t count, rsa_key_t const key);
+
+/**
+ * 	Verify many signatures of message digests with a key context
+ *
+ * 	@param valid Array of `count` integers set to whether each signature is valid
+ * 	@param signs Array of `count` bytestreams with signatures
+ * 	@param digests Array of `count` bytestreams with the shake256 digests of the messages
+ * 	@param count Number of messages
+ * 	@param ctx A key context
+ * 	@return Whether all signatures are valid
+ */
+int rsa_verify_digest_batch_ctx(int *valid, bytestream_t *signs, bytestream_t *digests, size_t count, rsa_ctx_t ctx);
+
+/**
+ * 	Generate a signature for an already computed message digest
+ *
+ * 	@param sign Bytestream to hold the signature
+ * 	@param digest Bytestream with the shake256 digest of the message
+ * 	@param key RSA key
+ */
+void rsa_sign_digest(bytestream_t sign, bytestream_t const digest, rsa_key_t const key);
+
+/**
+ * 	Generate a signature for a message digest with a key context
+ *
+ * 	@param sign Bytestream to hold the signature
+ * 	@param digest Bytestream with the shake256 digest of the message
+ * 	@param ctx A key context
+ */
+void rsa_sign_digest_ctx(bytestream_t sign, bytestream_t const digest, rsa_ctx_t ctx);
+
+/**
+ * 	Verify a signature for an already computed message digest
+ *
+ * 	@param sign Bytestream with a signature
+ * 	@param digest Bytestream with the shake256 digest of the message
+ * 	@param key RSA key
+ */
+int rsa_verify_digest(bytestream_t const sign, bytestream_t const digest, rsa_key_t const key);
+
+/**
+ * 	Verify a signature for a message digest with a key context
+ *
+ * 	@param sign Bytestream with a signature
+ * 	@param digest Bytestream with the shake256 digest of the message
+ * 	@param ctx A key context
+ */
+int rsa_verify_digest_ctx(bytestream_t const sign, bytestream_t const digest, rsa_ctx_t ctx);
+
 /**
  * 	Encode a message with OAEP
+ * 	The encoding is OAEP_LEN bytes, X||Y: the message padded to
+ * 	OAEP_MSGLEN bytes XOR a mask from the hash of a random seed r, then
+ * 	r XOR a mask from the hash of X. Masks are XORed in place with
+ * 	`shake256_mask` and nothing is allocated once `encoded` has room
  *
- * 	@param encoded Bytestream to hold encoded data
- * 	@param msg Bytestream with data to be encoded
+ * 	@param encoded Bytestream to hold encoded data, not `msg`
+ * 	@param msg Bytestream with at most OAEP_MSGLEN bytes to be encoded
  */
 void rsa_oaep_enc(bytestream_t encoded, bytestream_t const msg);
 
+/**
+ * 	Encode OAEP_MSGLEN bytes or less into OAEP_LEN bytes, see `rsa_oaep_enc`
+ *
+ * 	@param encoded Buffer of OAEP_LEN bytes to hold encoded data
+ * 	@param msg View of the data to be encoded
+ */
+void rsa_oaep_enc_b(byte_t *encoded, bs_view_t msg);
+
+/**
+ * 	Encode many messages with OAEP
+ * 	The two hashing steps of every message are done together with
+ * 	`shake256_xn_mask`
+ *
+ * 	@param encoded Array of `count` bytestreams to hold encoded data
+ * 	@param msgs Array of `count` bytestreams with data to be encoded
+ * 	@param count Number of messages
+ */
+void rsa_oaep_enc_batch(bytestream_t *encoded, bytestream_t *msgs, size_t count);
+
 /**
  * 	Decode a message with OAEP
+ * 	Encodings shorter than OAEP_LEN bytes are taken as having leading
+ * 	zero bytes. The message is OAEP_MSGLEN bytes, padding included
  *
- * 	@param msg Bytestream to hold decoded data
+ * 	@param msg Bytestream to hold decoded data, may be `encoded`
  * 	@param encoded Bytestream with encoded data
  */
 void rsa_oaep_dec(bytestream_t msg, bytestream_t const encoded);
 
+/**
+ * 	Decode OAEP_LEN bytes in place, leaving the message in the first
+ * 	OAEP_MSGLEN bytes, see `rsa_oaep_dec`
+ *
+ * 	@param encoded Buffer of OAEP_LEN bytes with encoded data
+ */
+void rsa_oaep_dec_b(byte_t *encoded);
+
+/**
+ * 	Decode many messages with OAEP
+ * 	The two hashing steps of every message are done together with
+ * 	`shake256_xn_mask`
+ *
+ * 	@param msgs Array of `count` bytestreams to hold decoded data
+ * 	@param encoded Array of `count` bytestreams with encoded data
+ * 	@param count Number of messages
+ */
+void rsa_oaep_dec_batch(bytestream_t *msgs, bytestream_t *encoded, size_t count);
+
 /**
  * 	Save a RSA key to a file
+ * 	The file holds the modulo and the exponent, each as a length followed
+ * 	by its bytes. Keys with prime factors are followed by the number of
+ * 	primes and p, q, dp, dq and qinv in the same form, then r, d and t of
+ * 	every other prime.
  *
  * 	@param filepath File path to save key
  * 	@param key RSA key
@@ -113,6 +465,7 @@ void rsa_save_key(char * const filepath, rsa_key_t const key);
 
 /**
  * 	Load a RSA key from a file
+ * 	Key files with only the modulo and the exponent are accepted
  *
  * 	@param filepath File path
  * 	@return key RSA key
@@ -121,6 +474,10 @@ rsa_key_t rsa_load_key(char * const filepath);
 
 /**
  * 	Sign a file and save it's signature to a file.
+ * 	The file is read with the backend set by `input_set_backend`, so
+ * 	memory use does not depend on the file size. A `filepath` of
+ * 	STDIOPATH reads the standard input and a `signpath` of STDIOPATH
+ * 	writes the signature to the standard output
  *
  * 	@param signpath File path to save signature
  * 	@param filepath File path to sign
@@ -128,8 +485,147 @@ rsa_key_t rsa_load_key(char * const filepath);
  */
 void rsa_sign_file(char * const signpath, char * const filepath, rsa_key_t const key);
 
+/**
+ * 	Sign a file with a key context, see `rsa_sign_file`
+ *
+ * 	@param signpath File path to save signature
+ * 	@param filepath File path to sign
+ * 	@param ctx A key context
+ */
+void rsa_sign_file_ctx(char * const signpath, char * const filepath, rsa_ctx_t ctx);
+
+/**
+ * 	Sign the tree hash of a file, see treehash.h
+ * 	Leaves are hashed in `treehash_threads()` threads. The signature file
+ * 	holds TREEMAGIC and the leaf size as a word, then the signature
+ *
+ * 	@param signpath File path to save signature, STDIOPATH for the standard output
+ * 	@param filepath File path to sign, not the standard input
+ * 	@param leafsize Leaf size in bytes, at least TREEHASH_MINLEAF
+ * 	@param key RSA key
+ */
+void rsa_sign_file_tree(char * const signpath, char * const filepath, size_t leafsize, rsa_key_t const key);
+
+/**
+ * 	Sign the tree hash of a file with a key context, see `rsa_sign_file_tree`
+ *
+ * 	@param signpath File path to save signature, STDIOPATH for the standard output
+ * 	@param filepath File path to sign, not the standard input
+ * 	@param leafsize Leaf size in bytes, at least TREEHASH_MINLEAF
+ * 	@param ctx A key context
+ */
+void rsa_sign_file_tree_ctx(char * const signpath, char * const filepath, size_t leafsize, rsa_ctx_t ctx);
+
+/**
+ * 	Sign the content-defined chunk index of a file, see chunkidx.h
+ * 	The index is hashed with cSHAKE256 and CHUNKIDX_CUSTOM and signed.
+ * 	The signature file holds the index, then the signature, so byte
+ * 	ranges of the file can be checked with `rsa_verify_file_range`
+ *
+ * 	@param signpath File path to save signature, STDIOPATH for the standard output
+ * 	@param filepath File path to sign, STDIOPATH for the standard input
+ * 	@param key RSA key
+ */
+void rsa_sign_file_index(char * const signpath, char * const filepath, rsa_key_t const key);
+
+/**
+ * 	Sign the chunk index of a file with a key context, see `rsa_sign_file_index`
+ *
+ * 	@param signpath File path to save signature, STDIOPATH for the standard output
+ * 	@param filepath File path to sign, STDIOPATH for the standard input
+ * 	@param ctx A key context
+ */
+void rsa_sign_file_index_ctx(char * const signpath, char * const filepath, rsa_ctx_t ctx);
+
+/**
+ * 	Hash algorithm of a name
+ *
+ * 	@param name "shake256" or "k12"
+ * 	@return The algorithm, -1 if there is none of that name
+ */
+int rsa_hash_algo(char const *name);
+
+/**
+ * 	Sign a file hashed with a given algorithm, see `rsa_sign_file`
+ * 	The signature file holds HASHMAGIC and the algorithm as a word, then
+ * 	the signature
+ *
+ * 	@param signpath File path to save signature, STDIOPATH for the standard output
+ * 	@param filepath File path to sign, STDIOPATH for the standard input
+ * 	@param algo Hash algorithm, HASH_SHAKE256 or HASH_K12
+ * 	@param key RSA key
+ */
+void rsa_sign_file_hash(char * const signpath, char * const filepath, int algo, rsa_key_t const key);
+
+/**
+ * 	Sign a file hashed with a given algorithm with a key context, see
+ * 	`rsa_sign_file_hash`
+ *
+ * 	@param signpath File path to save signature, STDIOPATH for the standard output
+ * 	@param filepath File path to sign, STDIOPATH for the standard input
+ * 	@param algo Hash algorithm, HASH_SHAKE256 or HASH_K12
+ * 	@param ctx A key context
+ */
+void rsa_sign_file_hash_ctx(char * const signpath, char * const filepath, int algo, rsa_ctx_t ctx);
+
+/**
+ * 	Sign a file that only ever grows, such as an append-only log.
+ * 	The hashing state is kept in `statepath`. If it exists, only the bytes
+ * 	appended since it was saved are hashed, otherwise the whole file is.
+ * 	The state is then saved again for the next call. The signature is the
+ * 	same one `rsa_sign_file` produces for the whole file.
+ *
+ * 	@param signpath File path to save signature
+ * 	@param filepath File path to sign
+ * 	@param statepath File path of the saved hashing state
+ * 	@param key RSA key
+ */
+void rsa_sign_append(char * const signpath, char * const filepath, char * const statepath, rsa_key_t const key);
+
+/**
+ * 	Sign a file that only ever grows with a key context, see `rsa_sign_append`
+ *
+ * 	@param signpath File path to save signature
+ * 	@param filepath File path to sign
+ * 	@param statepath File path of the saved hashing state
+ * 	@param ctx A key context
+ */
+void rsa_sign_append_ctx(char * const signpath, char * const filepath, char * const statepath, rsa_ctx_t ctx);
+
+/**
+ * 	Sign many files with a single secret key operation.
+ * 	The file digests are the leaves of a Merkle tree, see merkle.h, whose
+ * 	root is signed with `rsa_sign_digest`. Every file gets a signature saved to its
+ * 	own path with SIGNSUFFIX, holding PROOFMAGIC, the number of files, the
+ * 	index of the file and the signature length as words, then the root
+ * 	signature and the nodes of the inclusion path of the file.
+ *
+ * 	@param filepaths Array of `count` file paths to sign
+ * 	@param count Number of files, at least 1
+ * 	@param key RSA key
+ */
+void rsa_sign_batch(char **filepaths, size_t count, rsa_key_t const key);
+
+/**
+ * 	Sign many files whose digests are already computed, see `rsa_sign_batch`
+ *
+ * 	@param filepaths Array of `count` file paths to sign
+ * 	@param digests Array of `count` bytestreams with the shake256 digests of the files
+ * 	@param count Number of files, at least 1
+ * 	@param key RSA key
+ */
+void rsa_sign_batch_digests(char **filepaths, bytestream_t *digests, size_t count, rsa_key_t const key);
+
 /**
  * 	Verify a file signature.
+ * 	The file is read as in `rsa_sign_file`. A `signpath` of STDIOPATH
+ * 	reads the signature from the standard input. Signatures
+ * 	made by `rsa_sign_batch` are checked against the root their inclusion
+ * 	path leads to. Signatures made by `rsa_sign_file_tree` are checked
+ * 	against the tree hash of the file with the leaf size they hold, and
+ * 	those made by `rsa_sign_file_hash` against the hash of the file with
+ * 	the algorithm they hold. Signatures made by `rsa_sign_file_index` are
+ * 	checked against every chunk of the file
  *
  * 	@param signpath Signature file path
  * 	@param filepath File path
@@ -137,6 +633,57 @@ void rsa_sign_file(char * const signpath, char * const filepath, rsa_key_t const
  */
 int rsa_verify_file(char * const signpath, char * const filepath, rsa_key_t const key);
 
-#define rsa_clear_keys(keys) mpz_clears(keys.pk.exp, keys.pk.mod, keys.sk.exp, keys.sk.mod, NULL)
-#define rsa_clear_key(key) mpz_clears(key.exp, key.mod, NULL)
+/**
+ * 	Verify a byte range of a file
+ * 	With a signature made by `rsa_sign_file_index`, only the chunks
+ * 	covering the range are read and hashed. Any other signature is
+ * 	verified against the whole file, as in `rsa_verify_file`
+ *
+ * 	@param signpath Signature file path, STDIOPATH for the standard input
+ * 	@param filepath File path, not the standard input for an index
+ * 	@param offset First byte of the range
+ * 	@param length Bytes of the range
+ * 	@param key RSA key
+ * 	@return Whether the signature is valid, the range is within the file
+ * 	and its chunks are the signed ones
+ */
+int rsa_verify_file_range(char * const signpath, char * const filepath, size_t offset, size_t length, rsa_key_t const key);
+
+/**
+ * 	Verify a file signature with a key context, see `rsa_verify_file`
+ * 	A signature or file that cannot be opened is reported and returned as
+ * 	an error instead of exiting, so one missing entry of many does not
+ * 	stop the others
+ *
+ * 	@param signpath Signature file path
+ * 	@param filepath File path
+ * 	@param ctx A key context
+ * 	@return 1 if the signature is valid, 0 if not, -1 if the signature or
+ * 	file could not be opened
+ */
+int rsa_verify_file_ctx(char * const signpath, char * const filepath, rsa_ctx_t ctx);
+
+/**
+ * 	Verify a file signature for an already computed file digest with a key
+ * 	context, see `rsa_verify_file`
+ * 	The digest is not used for signatures of a tree hash or naming their
+ * 	hash algorithm, the file is hashed again as they say instead
+ *
+ * 	@param signpath Signature file path
+ * 	@param filepath File path
+ * 	@param digest Bytestream with the shake256 digest of the file
+ * 	@param ctx A key context
+ * 	@return 1 if the signature is valid, 0 if not, -1 if the signature or
+ * 	file could not be opened, see `rsa_verify_file_ctx`
+ */
+int rsa_verify_file_digest_ctx(char * const signpath, char * const filepath, bytestream_t const digest, rsa_ctx_t ctx);
+
+/**
+ * 	Clear memory used by a RSA key
+ *
+ * 	@param key RSA key
+ */
+void rsa_clear_key(rsa_key_t key);
+
+#define rsa_clear_keys(keys) (rsa_clear_key(keys.pk), rsa_clear_key(keys.sk))
 #endif
@@ -17,31 +17,75 @@
  * 	SHA3_B: State width in bits
  * 	SHA3_C: Capacity in bits
  * 	SHA3_RNDS: Number of Keccak rounds
+ * 	K12_RNDS: Number of Keccak rounds of TurboSHAKE and KangarooTwelve
  * 	SHA3_MAXC: Maximum capacity value (if VARIABLE_CAPACITY is defined)
  * 	SHA3_STTDEPTH: State depth
  */
 #define SHA3_B 1600
 #define SHA3_C 512
 #define SHA3_RNDS 24
+#define K12_RNDS 12
 #define SHA3_MAXC 512
 #define SHA3_STTDEPTH 64
 
-/* State type */
-typedef word_t ** state_t;
+/**
+ * 	Rate in bytes for an output length of `len` bits
+ */
+#ifdef VARIABLE_CAPACITY
+#define SHA3_RATE(len) ((SHA3_B - ((len) > SHA3_MAXC ? SHA3_MAXC : (len) * 2)) / 8)
+#else
+#define SHA3_RATE(len) ((SHA3_B - SHA3_C) / 8)
+#endif
+
+/**
+ * 	Fixed-parameter SHA3 and SHAKE constants
+ *
+ * 	SHA3_PAD: Domain padding byte of SHA3
+ * 	SHAKE_PAD: Domain padding byte of SHAKE
+ * 	CSHAKE_PAD: Domain padding byte of cSHAKE with a customization string
+ * 	SHA3_<n>_RATE: Rate in bytes of SHA3-<n>, with a capacity of 2n bits
+ * 	SHAKE<n>_RATE: Rate in bytes of SHAKE<n>, with a capacity of 2n bits
+ */
+#define SHA3_PAD 0x06
+#define SHAKE_PAD 0x1f
+#define CSHAKE_PAD 0x04
+#define SHA3_224_RATE 144
+#define SHA3_256_RATE 136
+#define SHA3_384_RATE 104
+#define SHA3_512_RATE 72
+#define SHAKE128_RATE 168
+#define SHAKE256_RATE 136
 
 /**
- * 	Alloc space for the state sponge
+ * 	SHA3 multi-buffer constants
  *
- * 	@param st Pointer to the state
+ * 	SHA3_XN_MAXLANES: Maximum number of messages hashed in parallel
  */
-void state_init(state_t *st);
+#define SHA3_XN_MAXLANES 8
 
 /**
- * 	Clear memory used for the state
+ * 	State type
  *
- * 	@param st Pointer to the state
+ * 	The 5x5 lanes of the sponge, lane (x, y) is stored at index x + 5 * y
  */
-void state_clear(state_t *st);
+typedef word_t state_t[25];
+
+/**
+ * 	SHA3 incremental context
+ *
+ * 	Holds the sponge state and the bytes of a partial block between calls
+ * 	to `sha3_update`. Used in function arguments as by-reference value
+ */
+typedef struct _sha3_ctx_t {
+	state_t _st; /* Sponge state */
+	byte_t _buf[SHA3_B / 8]; /* Partial block not yet absorbed */
+	size_t _buflen; /* Number of occupied bytes in `_buf` */
+	size_t _rate; /* Rate in bytes */
+	size_t _len; /* Output length in bits */
+	byte_t _pad; /* Domain padding byte, SHA3_PAD or SHAKE_PAD */
+	int _rounds; /* Keccak rounds, SHA3_RNDS or K12_RNDS */
+	uint64_t _absorbed; /* Number of bytes given to `sha3_update` */
+} sha3_ctx_t[1];
 
 /**
  * 	Print state values as a 5x5 matrix of words
@@ -52,17 +96,28 @@ void state_clear(state_t *st);
 #define state_print(st, fmt) { \
 	for (int i = 0; i < 5; i++) { \
 		for (int j = 0; j < 5; j++) \
-			printf(fmt "%s", st[i][j], j == 4 ? "" : " "); \
+			printf(fmt "%s", st[i + 5 * j], j == 4 ? "" : " "); \
 		printf("\n"); \
 	} \
 } NULL
 
+/* Keccak round constants */
+extern const word_t keccak_rc[SHA3_RNDS];
+
 /**
  * 	Keccak function
+ * 	Rounds are unrolled over local lanes, no memory is allocated
+ *
+ * 	@param st The state
+ */
+void keccak_f(state_t st);
+
+/**
+ * 	Keccak-p[1600, 12], the last K12_RNDS rounds of `keccak_f`
  *
- * 	@param st Pointer to the state
+ * 	@param st The state
  */
-void keccak_f(state_t *st);
+void keccak_p12(state_t st);
 
 /**
  * 	SHA3 hashing algorithm
@@ -73,12 +128,230 @@ void keccak_f(state_t *st);
  */
 void sha3(bytestream_t hash, bytestream_t const msg, size_t len);
 
+/**
+ * 	SHA3 hashing of the bytes of a view, absorbed where they are
+ *
+ * 	@param hash Bytestream to hold hashed data, may be the one `msg`
+ * 	points into
+ * 	@param msg View of the data to be hashed
+ * 	@param len Output lenght in bits
+ */
+void sha3_view(bytestream_t hash, bs_view_t msg, size_t len);
+
+/**
+ * 	FIPS 202 hash functions with fixed parameters
+ * 	Rate, padding and, for SHA3, output length are constants of every
+ * 	function, so its absorb and squeeze loops are specialized for them.
+ * 	The output is squeezed straight into `out`, nothing is allocated
+ *
+ * 	@param out Buffer of 28, 32, 48 or 64 bytes to hold hashed data, may
+ * 	overlap `msg`
+ * 	@param msg View of the data to be hashed
+ */
+void sha3_224(byte_t *out, bs_view_t msg);
+void sha3_256(byte_t *out, bs_view_t msg);
+void sha3_384(byte_t *out, bs_view_t msg);
+void sha3_512(byte_t *out, bs_view_t msg);
+
+/**
+ * 	FIPS 202 extendable-output functions, see `sha3_224`
+ *
+ * 	@param out Buffer of `outlen` bytes to hold hashed data, may overlap
+ * 	`msg`
+ * 	@param outlen Output length in bytes
+ * 	@param msg View of the data to be hashed
+ */
+void shake128(byte_t *out, size_t outlen, bs_view_t msg);
+void shake256(byte_t *out, size_t outlen, bs_view_t msg);
+
+/**
+ * 	XOR SHAKE output into a buffer, as a mask generator
+ *
+ * 	@param out Buffer of `outlen` bytes, not overlapping `msg`
+ * 	@param outlen Output length in bytes
+ * 	@param msg View of the data to be hashed
+ */
+void shake128_mask(byte_t *out, size_t outlen, bs_view_t msg);
+void shake256_mask(byte_t *out, size_t outlen, bs_view_t msg);
+
+/**
+ * 	Initialize an incremental SHA3 context
+ *
+ * 	@param ctx A SHA3 context
+ * 	@param len Output length in bits
+ */
+void sha3_init(sha3_ctx_t ctx, size_t len);
+
+/**
+ * 	Initialize an incremental SHAKE256 context, used like a SHA3 context
+ *
+ * 	@param ctx A SHA3 context
+ * 	@param len Output length in bits
+ */
+void shake256_init(sha3_ctx_t ctx, size_t len);
+
+/**
+ * 	Initialize an incremental cSHAKE256 context (NIST SP 800-185) with an
+ * 	empty function name, used like a SHA3 context
+ * 	An empty customization string makes it a SHAKE256 context
+ *
+ * 	@param ctx A SHA3 context
+ * 	@param len Output length in bits
+ * 	@param custom Customization string, at most SHAKE256_RATE - 8 bytes
+ */
+void cshake256_init(sha3_ctx_t ctx, size_t len, bs_view_t custom);
+
+/**
+ * 	Initialize an incremental TurboSHAKE128 context, used like a SHA3
+ * 	context: rate SHAKE128_RATE and K12_RNDS rounds of Keccak-p
+ * 	Cannot be saved with `sha3_save`
+ *
+ * 	@param ctx A SHA3 context
+ * 	@param len Output length in bits
+ * 	@param pad Domain separation byte, 0x01 to 0x7f
+ */
+void turboshake128_init(sha3_ctx_t ctx, size_t len, byte_t pad);
+
+/**
+ * 	Absorb bytes into a SHA3 context
+ * 	Full rate-sized blocks are absorbed directly from `data`, only a
+ * 	partial tail is buffered in the context
+ *
+ * 	@param ctx A SHA3 context
+ * 	@param data Bytes to be hashed
+ * 	@param size Number of bytes in `data`
+ */
+void sha3_update(sha3_ctx_t ctx, const void *data, size_t size);
+
+/**
+ * 	Pad the buffered tail, squeeze the hash and clear the context
+ * 	The context must be initialized again before being reused
+ *
+ * 	@param hash Bytestream to hold hashed data
+ * 	@param ctx A SHA3 context
+ */
+void sha3_final(bytestream_t hash, sha3_ctx_t ctx);
+
+/**
+ * 	Finalize a SHA3 context into a buffer, see `sha3_final`
+ *
+ * 	@param out Buffer of `len / 8` bytes to hold hashed data
+ * 	@param ctx A SHA3 context
+ */
+void sha3_final_b(byte_t *out, sha3_ctx_t ctx);
+
+/**
+ * 	Number of bytes absorbed by a SHA3 context
+ *
+ * 	@param ctx A SHA3 context
+ */
+#define sha3_absorbed(ctx) (ctx[0]._absorbed)
+
+/**
+ * 	Save a SHA3 context to a file so hashing can be resumed later
+ * 	Writes the output length, the rate, the padding byte, the 200 bytes
+ * 	of lanes, the absorbed length and the buffered partial block
+ *
+ * 	@param filepath File path to save the context
+ * 	@param ctx A SHA3 context
+ */
+void sha3_save(char * const filepath, sha3_ctx_t const ctx);
+
+/**
+ * 	Load a SHA3 context saved with `sha3_save`
+ * 	The loaded context continues absorbing where the saved one stopped
+ *
+ * 	@param ctx SHA3 context to be loaded
+ * 	@param filepath File path
+ */
+void sha3_load(sha3_ctx_t ctx, char * const filepath);
+
+/**
+ * 	SHA3 hashing of many independent messages
+ * 	Messages are grouped by length and hashed in parallel SIMD lanes, 8 at
+ * 	a time with AVX-512 or 4 with AVX2, falling back to one at a time with
+ * 	`keccak_f`. The kernel is picked at runtime. Outputs are the same as
+ * 	calling `sha3` on each message, and `hashes[i]` may be `msgs[i]`
+ *
+ * 	@param hashes Array of `count` bytestreams to hold hashed data
+ * 	@param msgs Array of `count` bytestreams with data to be hashed
+ * 	@param count Number of messages
+ * 	@param len Output length in bits
+ */
+void sha3_xn(bytestream_t *hashes, bytestream_t *msgs, size_t count, size_t len);
+
+/**
+ * 	SHA3 hashing of many independent views, see `sha3_xn`
+ * 	`msgs[i]` may point into `hashes[i]` only if it already has room
+ * 	for `len` bits, since smaller outputs are grown first
+ *
+ * 	@param hashes Array of `count` bytestreams to hold hashed data
+ * 	@param msgs Array of `count` views of the data to be hashed
+ * 	@param count Number of messages
+ * 	@param len Output length in bits
+ */
+void sha3_xn_view(bytestream_t *hashes, bs_view_t *msgs, size_t count, size_t len);
+
+/**
+ * 	SHAKE256 of many independent byte streams, see `sha3_xn`
+ *
+ * 	@param hashes Array of `count` bytestreams to hold hashed data
+ * 	@param msgs Array of `count` bytestreams with data to be hashed
+ * 	@param count Number of messages
+ * 	@param len Output length in bits
+ */
+void shake256_xn(bytestream_t *hashes, bytestream_t *msgs, size_t count, size_t len);
+
+/**
+ * 	cSHAKE256 of many independent byte streams with one customization
+ * 	string, see `sha3_xn` and `cshake256_init`
+ *
+ * 	@param hashes Array of `count` bytestreams to hold hashed data
+ * 	@param msgs Array of `count` bytestreams with data to be hashed
+ * 	@param count Number of messages
+ * 	@param len Output length in bits
+ * 	@param custom Customization string, at most SHAKE256_RATE - 8 bytes
+ */
+void cshake256_xn(bytestream_t *hashes, bytestream_t *msgs, size_t count, size_t len, bs_view_t custom);
+
+/**
+ * 	XOR the SHAKE256 output of many independent views into buffers, see
+ * 	`sha3_xn` and `shake256_mask`
+ *
+ * 	@param outs Array of `count` buffers of `len / 8` bytes, not
+ * 	overlapping the views
+ * 	@param msgs Array of `count` views of the data to be hashed
+ * 	@param count Number of messages
+ * 	@param len Output length in bits
+ */
+void shake256_xn_mask(byte_t **outs, bs_view_t *msgs, size_t count, size_t len);
+
+/**
+ * 	TurboSHAKE128 of many independent views into buffers, see `sha3_xn`
+ * 	and `turboshake128_init`
+ *
+ * 	@param outs Array of `count` buffers of `len / 8` bytes, not
+ * 	overlapping the views
+ * 	@param msgs Array of `count` views of the data to be hashed
+ * 	@param count Number of messages
+ * 	@param len Output length in bits
+ * 	@param pad Domain separation byte, 0x01 to 0x7f
+ */
+void turboshake128_xn(byte_t **outs, bs_view_t *msgs, size_t count, size_t len, byte_t pad);
+
+/**
+ * 	Number of messages `sha3_xn` hashes in parallel on this CPU
+ *
+ * 	@return 8, 4 or 1
+ */
+int sha3_xn_lanes();
+
 /**
  * 	Rotate bits to the left
  *
  * 	@param n A word
  * 	@param d Number of bits
  */
-#define ROT64(n, d) (n << d | n >> (64 - d))
+#define ROT64(n, d) ((n) << (d) | (n) >> (64 - (d)))
 
 #endif
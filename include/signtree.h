@@ -0,0 +1,28 @@
+#ifndef __SIGNTREE_H__
+#define __SIGNTREE_H__
+
+#include "rsa.h"
+
+/*******************************************************************
+ * 	Signing of every regular file under a directory                *
+ *                                                                 *
+ * 	Directories are listed and files signed as tasks of a          *
+ * 	work-stealing pool, so walking and signing overlap and a few   *
+ * 	large files do not leave the other workers idle. Every file    *
+ * 	gets the signature `rsa_sign_file` makes, saved next to it     *
+ * 	with SIGNSUFFIX. Files ending with SIGNSUFFIX are not signed,  *
+ * 	and symbolic links are not followed.                           *
+ *******************************************************************/
+
+/**
+ * 	Sign every regular file under a directory
+ * 	The key is shared read-only by the workers, each with its own context
+ *
+ * 	@param dirpath Directory path
+ * 	@param key RSA key
+ * 	@param threads Number of threads, at least 1
+ * 	@return Number of files signed
+ */
+size_t signtree_sign(char * const dirpath, rsa_key_t const key, int threads);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef __TREEHASH_H__
+#define __TREEHASH_H__
+
+#include "bytestream.h"
+
+/*******************************************************************
+ * 	Tree hashing of large files                                    *
+ *                                                                 *
+ * 	A file is split into leaves of a fixed size, the last one      *
+ * 	shorter, and every leaf is hashed with SHAKE256 on its own, so *
+ * 	leaves are hashed at once by the workers of a thread pool,     *
+ * 	each reading with its own file descriptor. The root is         *
+ * 	cSHAKE256 with TREEHASH_CUSTOM over the leaf size and the file *
+ * 	size, as 8 little endian bytes each, followed by the leaf      *
+ * 	digests in order. The customization string keeps roots apart   *
+ * 	from SHAKE256 digests of whole files. An empty file has one    *
+ * 	empty leaf.                                                    *
+ *******************************************************************/
+
+/**
+ * 	Tree Hashing Constants
+ *
+ * 	TREEHASH_LEAFLEN: Bytes of a leaf digest
+ * 	TREEHASH_MINLEAF: Smallest leaf size in bytes
+ * 	TREEHASH_BUFSIZE: Bytes a worker reads at a time
+ * 	TREEHASH_CUSTOM: cSHAKE256 customization string of the root
+ */
+#define TREEHASH_LEAFLEN 64
+#define TREEHASH_MINLEAF 4096
+#define TREEHASH_BUFSIZE (1 << 20)
+#define TREEHASH_CUSTOM "RSA tree hash"
+
+/**
+ * 	Number of threads leaves are hashed with
+ *
+ * 	@return The number set by `treehash_set_threads`, else `pool_threads()`
+ */
+int treehash_threads();
+
+/**
+ * 	Set the number of threads leaves are hashed with
+ *
+ * 	@param threads Number of threads, at least 1
+ */
+void treehash_set_threads(int threads);
+
+/**
+ * 	Tree hash of a file
+ *
+ * 	@param hash Bytestream to hold the root
+ * 	@param filepath File path, not the standard input
+ * 	@param leafsize Leaf size in bytes, at least TREEHASH_MINLEAF
+ * 	@param len Output length in bits
+ */
+void treehash_file(bytestream_t hash, char * const filepath, size_t leafsize, size_t len);
+
+#endif
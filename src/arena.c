@@ -0,0 +1,216 @@
+#include "../include/arena.h"
+#include <gmp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Round up to a multiple of ARENA_ALIGN */
+#define arena_round(n) (((n) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+/**
+ * 	Block of memory taken from the heap, its bytes follow the header
+ */
+typedef struct _arena_chunk_t {
+	struct _arena_chunk_t *next; /* Older chunk */
+	size_t size; /* Bytes in the chunk */
+	size_t used; /* Bytes handed out */
+} arena_chunk_t;
+
+/* Size of the chunk header, keeping the bytes aligned */
+#define ARENA_HEAD arena_round(sizeof(arena_chunk_t))
+
+/* First byte of a chunk */
+#define arena_data(chunk) ((char *) (chunk) + ARENA_HEAD)
+
+/**
+ * 	Arena of a thread
+ */
+typedef struct _arena_t {
+	arena_chunk_t *chunks; /* Chunks, the one allocations come from first */
+	size_t total; /* Bytes in all chunks */
+	void *last; /* Last allocation, which can grow or be taken back */
+	int depth; /* Number of scopes begun and not ended */
+	arena_stats_t now; /* Allocations of the current scope */
+	arena_stats_t done; /* Allocations of the last scope */
+} arena_t;
+
+static __thread arena_t arena;
+
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+
+/* Set on threads with an arena, to free it when they exit */
+static pthread_key_t arena_key;
+
+/**
+ * 	Free the chunks of the arena of an exiting thread
+ */
+static void arena_release(void *ptr) {
+	arena_t *a = ptr;
+	for (arena_chunk_t *chunk = a->chunks, *next; chunk; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+	a->chunks = NULL;
+}
+
+/* GMP memory functions in place before the arena took over */
+static void *(*arena_mp_alloc)(size_t);
+static void *(*arena_mp_realloc)(void *, size_t, size_t);
+static void (*arena_mp_free)(void *, size_t);
+
+static void *arena_gmp_alloc(size_t size);
+static void *arena_gmp_realloc(void *ptr, size_t old, size_t size);
+static void arena_gmp_free(void *ptr, size_t size);
+
+/**
+ * 	Route GMP memory through the arena, keeping the previous functions for
+ * 	memory outside of scopes
+ */
+static void arena_setup() {
+	pthread_key_create(&arena_key, arena_release);
+	mp_get_memory_functions(&arena_mp_alloc, &arena_mp_realloc, &arena_mp_free);
+	mp_set_memory_functions(arena_gmp_alloc, arena_gmp_realloc, arena_gmp_free);
+}
+
+void arena_begin() {
+	pthread_once(&arena_once, arena_setup);
+	if (!arena.depth++)
+		pthread_setspecific(arena_key, &arena);
+}
+
+void arena_end() {
+	if (--arena.depth)
+		return;
+
+	arena.done = arena.now;
+	memset(&arena.now, 0, sizeof(arena_stats_t));
+	arena.last = NULL;
+
+	/* Merge the chunks so the next scope fits in one */
+	if (arena.chunks && arena.chunks->next) {
+		arena_release(&arena);
+		arena.chunks = malloc(ARENA_HEAD + arena.total);
+		if (!arena.chunks) {
+			fprintf(stderr, "Could not allocate memory\n");
+			exit(EXIT_FAILURE);
+		}
+		arena.chunks->next = NULL;
+		arena.chunks->size = arena.total;
+	}
+	if (arena.chunks)
+		arena.chunks->used = 0;
+}
+
+void arena_stats(arena_stats_t *stats) {
+	*stats = arena.done;
+}
+
+/**
+ * 	Whether memory was handed out by the arena of the calling thread
+ */
+static int arena_owns(void *ptr) {
+	for (arena_chunk_t *chunk = arena.chunks; chunk; chunk = chunk->next)
+		if ((uintptr_t) ptr - (uintptr_t) arena_data(chunk) < chunk->size)
+			return 1;
+	return 0;
+}
+
+/**
+ * 	Allocate memory from the arena, inside a scope
+ */
+static void *arena_take(size_t size) {
+	size_t need = arena_round(size ? size : 1);
+	arena_chunk_t *chunk = arena.chunks;
+
+	/* Grow with a chunk of at least ARENA_CHUNK bytes */
+	if (!chunk || chunk->size - chunk->used < need) {
+		size_t bytes = need > ARENA_CHUNK ? need : ARENA_CHUNK;
+		chunk = malloc(ARENA_HEAD + bytes);
+		if (!chunk) {
+			fprintf(stderr, "Could not allocate memory\n");
+			exit(EXIT_FAILURE);
+		}
+		chunk->next = arena.chunks;
+		chunk->size = bytes;
+		chunk->used = 0;
+		arena.chunks = chunk;
+		arena.total += bytes;
+		arena.now.heap++;
+	}
+
+	void *ptr = arena_data(chunk) + chunk->used;
+	chunk->used += need;
+	arena.last = ptr;
+	arena.now.allocs++;
+	arena.now.bytes += size;
+
+	return ptr;
+}
+
+/**
+ * 	Resize memory of the arena, inside a scope
+ */
+static void *arena_grow(void *ptr, size_t old, size_t size) {
+	/* The last allocation grows in place while its chunk has room */
+	if (ptr == arena.last) {
+		arena_chunk_t *chunk = arena.chunks;
+		size_t start = (char *) ptr - arena_data(chunk), need = arena_round(size ? size : 1);
+		if (chunk->size - start >= need) {
+			chunk->used = start + need;
+			arena.now.bytes += size > old ? size - old : 0;
+			return ptr;
+		}
+	}
+
+	void *new = arena_take(size);
+	memcpy(new, ptr, old < size ? old : size);
+	return new;
+}
+
+/**
+ * 	Free memory of the arena, inside a scope
+ */
+static void arena_drop(void *ptr) {
+	/* Only the last allocation can be taken back */
+	if (ptr == arena.last) {
+		arena.chunks->used = (char *) ptr - arena_data(arena.chunks);
+		arena.last = NULL;
+	}
+}
+
+void *arena_alloc(size_t size) {
+	return arena.depth ? arena_take(size) : malloc(size);
+}
+
+void *arena_realloc(void *ptr, size_t old, size_t size) {
+	if (!arena.depth || !arena_owns(ptr))
+		return realloc(ptr, size);
+	return arena_grow(ptr, old, size);
+}
+
+void arena_free(void *ptr, size_t size) {
+	if (!arena.depth || !arena_owns(ptr))
+		free(ptr);
+	else
+		arena_drop(ptr);
+}
+
+/* GMP memory functions, the previous ones outside of scopes */
+static void *arena_gmp_alloc(size_t size) {
+	return arena.depth ? arena_take(size) : arena_mp_alloc(size);
+}
+
+static void *arena_gmp_realloc(void *ptr, size_t old, size_t size) {
+	if (!arena.depth || !arena_owns(ptr))
+		return arena_mp_realloc(ptr, old, size);
+	return arena_grow(ptr, old, size);
+}
+
+static void arena_gmp_free(void *ptr, size_t size) {
+	if (!arena.depth || !arena_owns(ptr))
+		arena_mp_free(ptr, size);
+	else
+		arena_drop(ptr);
+}
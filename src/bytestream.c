@@ -1,23 +1,27 @@
 #include "../include/bytestream.h"
+#include "../include/arena.h"
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
 
 void bs_init(bytestream_t bs) {
-	bs[0] = malloc(sizeof(bytestream_t));
+	bs[0] = arena_alloc(sizeof(*bs[0]));
 	bs[0]->_len = 0;
 	bs[0]->_avail = _BS_INIT;
-	assert((bs[0]->_data = malloc(sizeof(byte_t) * bs[0]->_avail)));
+	assert((bs[0]->_data = arena_alloc(sizeof(byte_t) * bs[0]->_avail)));
 }
 
 void bs_init_size(bytestream_t bs, size_t size) {
-	bs[0] = malloc(sizeof(bytestream_t));
+	bs[0] = arena_alloc(sizeof(*bs[0]));
 	bs[0]->_len = 0;
 	bs[0]->_avail = size;
-	assert((bs[0]->_data = calloc(size, sizeof(byte_t))));
+	assert((bs[0]->_data = arena_alloc(sizeof(byte_t) * size)));
+	memset(bs[0]->_data, 0, size);
 }
 
 void bs_set(bytestream_t bs, bytestream_t const op1) {
+	if (bs[0] == op1[0])
+		return;
 	if (bs[0]->_avail < op1[0]->_len)
 		_bs_update(bs, op1[0]->_len);
 	memcpy(bs[0]->_data, op1[0]->_data, op1[0]->_len);
@@ -31,6 +35,10 @@ void bs_set_b(bytestream_t bs, void *bytes, size_t len) {
 	bs[0]->_len = len;
 }
 
+void bs_set_view(bytestream_t bs, bs_view_t op1) {
+	bs_set_b(bs, (void *) op1.data, op1.len);
+}
+
 void bs_concat(bytestream_t bs, bytestream_t const op1, bytestream_t const op2) {
 	size_t catlen = op1[0]->_len + op2[0]->_len, op1len = op1[0]->_len;
 	if (catlen > bs[0]->_avail)
@@ -51,6 +59,17 @@ void bs_concat(bytestream_t bs, bytestream_t const op1, bytestream_t const op2)
 	bs[0]->_len = catlen;
 }
 
+void bs_concat_view(bytestream_t bs, bytestream_t const op1, bs_view_t op2) {
+	size_t op1len = bs_len(op1);
+	if (bs[0]->_avail < op1len + op2.len)
+		_bs_update(bs, op1len + op2.len);
+
+	if (bs[0] != op1[0])
+		memcpy(bs[0]->_data, op1[0]->_data, op1len);
+	memcpy(bs[0]->_data + op1len, op2.data, op2.len);
+	bs[0]->_len = op1len + op2.len;
+}
+
 void bs_concat_b(bytestream_t bs, bytestream_t const op1, byte_t op2) {
 	size_t op1len = bs_len(op1);
 	if (bs[0]->_avail < op1len + 1)
@@ -89,28 +108,46 @@ void bs_trim(bytestream_t bs, bytestream_t const op1, int len) {
 
 	if (reverse) {
 		move(bs[0]->_data, op1[0]->_data + len, new_len);
-	} else {
+	} else if (bs[0] != op1[0]) {
 		move(bs[0]->_data, op1[0]->_data, new_len);
 	}
 
 	bs[0]->_len = new_len;
 }
 
+bs_view_t bs_view(bytestream_t const bs) {
+	bs_view_t view = {bs[0]->_data, bs[0]->_len};
+	return view;
+}
+
+bs_view_t bs_view_b(const void *bytes, size_t len) {
+	bs_view_t view = {bytes, len};
+	return view;
+}
+
+bs_view_t bs_view_sub(bs_view_t op, size_t start, size_t len) {
+	if (start > op.len)
+		start = op.len;
+	if (len > op.len - start)
+		len = op.len - start;
+	bs_view_t view = {op.data + start, len};
+	return view;
+}
+
 void _bs_update(bytestream_t bs, size_t size) {
+	size_t old = bs[0]->_avail;
 	if (size == 0)
 		bs[0]->_avail *= _BS_UPDT_MUL;
 	else
 		bs[0]->_avail = size;
-	byte_t *new = malloc(sizeof(byte_t) * bs[0]->_avail);
+	byte_t *new = arena_realloc(bs[0]->_data, old, sizeof(byte_t) * bs[0]->_avail);
 	assert(new);
-	memcpy(new, bs[0]->_data, bs[0]->_len);
-	free(bs[0]->_data);
 	bs[0]->_data = new;
 }
 
 void bs_clear(bytestream_t bs) {
-	free(bs[0]->_data);
-	free(bs[0]);
+	arena_free(bs[0]->_data, bs[0]->_avail);
+	arena_free(bs[0], sizeof(*bs[0]));
 	bs[0] = NULL;
 }
 
@@ -146,13 +183,37 @@ void bs_load(bytestream_t dest, void * const src, size_t size, int start, int en
 }
 
 void mpz_set_bs(mpz_t rot, bytestream_t const op) {
-	mpz_import(rot, bs_len(op), 1, 1, 1, 0, op[0]->_data);
+	mpz_set_view(rot, bs_view(op));
+}
+
+void mpz_set_view(mpz_t rot, bs_view_t op) {
+	mpz_import(rot, op.len, 1, 1, 1, 0, op.data);
 }
 
 void bs_set_mpz(bytestream_t bs, mpz_t const op) {
-	void *data;
-	size_t op_len;
-	/* Export msg byte data and set data to point to it */
-	data = mpz_export(NULL, &op_len, 1, 1, 1, 0, op);
-	bs_set_b(bs, data, op_len);
+	/* Make room for every byte, then export msg byte data in place */
+	size_t op_len = (mpz_sizeinbase(op, 2) + 7) / 8;
+	if (bs[0]->_avail < op_len)
+		_bs_update(bs, op_len);
+	mpz_export(bs[0]->_data, &op_len, 1, 1, 1, 0, op);
+	bs[0]->_len = op_len;
+}
+
+void bs_set_mpz_size(bytestream_t bs, mpz_t const op, size_t size) {
+	if (bs[0]->_avail < size)
+		_bs_update(bs, size);
+	bs_save_mpz(bs[0]->_data, op, size);
+	bs[0]->_len = size;
+}
+
+void bs_save_mpz(void *dest, mpz_t const op, size_t size) {
+	const mp_limb_t *limbs = mpz_limbs_read(op);
+	size_t nlimbs = mpz_size(op);
+	byte_t *out = (byte_t *) dest + size;
+
+	/* Least significant byte last */
+	for (size_t i = 0; i < size; i++) {
+		size_t limb = i / sizeof(mp_limb_t);
+		*--out = limb < nlimbs ? limbs[limb] >> (8 * (i % sizeof(mp_limb_t))) : 0;
+	}
 }
@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/chunkidx.h"
+#include "../include/sha3.h"
+#include "../include/input.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Bytes into a chunk the rolling hash starts at, so it covers 64 bytes by CHUNKIDX_MIN */
+#define CHUNKIDX_SKIP (CHUNKIDX_MIN - 64)
+
+/**
+ * 	State of an index being built
+ */
+typedef struct _chunkidx_run_t {
+	bytestream_t index; /* Index so far */
+	word_t gear[256]; /* Rolling hash value of every byte */
+	word_t hash; /* Rolling hash of the current chunk */
+	word_t offset; /* Offset of the current chunk */
+	size_t buflen; /* Bytes of the current chunk in `buf` */
+	byte_t buf[CHUNKIDX_MAX]; /* Current chunk */
+} chunkidx_run_t;
+
+/**
+ * 	Fill the gear table with the splitmix64 sequence of seed 0
+ */
+static void chunkidx_gear(word_t *gear) {
+	word_t x = 0;
+	for (int i = 0; i < 256; i++) {
+		word_t z = (x += 0x9e3779b97f4a7c15);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+		gear[i] = z ^ (z >> 31);
+	}
+}
+
+/**
+ * 	Add an entry for the first `len` bytes of the buffer and start a new chunk
+ */
+static void chunkidx_cut(chunkidx_run_t *run, size_t len) {
+	/* Grow by doubling, entries are appended one at a time */
+	while (run->index[0]->_avail < bs_len(run->index) + CHUNKIDX_ENTRY)
+		_bs_update(run->index, 0);
+
+	byte_t *entry = run->index[0]->_data + bs_len(run->index);
+	memcpy(entry, &run->offset, sizeof(word_t));
+	sha3_256(entry + sizeof(word_t), bs_view_b(run->buf, len));
+	run->index[0]->_len += CHUNKIDX_ENTRY;
+
+	run->offset += len;
+	run->buflen = 0;
+	run->hash = 0;
+}
+
+/**
+ * 	Cut bytes of a file read by an input backend into chunks
+ */
+static void chunkidx_absorb(void *arg, const byte_t *data, size_t len) {
+	chunkidx_run_t *run = arg;
+
+	while (len) {
+		size_t n = CHUNKIDX_MAX - run->buflen < len ? CHUNKIDX_MAX - run->buflen : len,
+			end = run->buflen + n, cut = 0;
+		memcpy(run->buf + run->buflen, data, n);
+
+		/* First boundary in the new bytes, if any */
+		word_t hash = run->hash;
+		for (size_t p = run->buflen > CHUNKIDX_SKIP ? run->buflen : CHUNKIDX_SKIP; p < end; p++) {
+			hash = (hash << 1) + run->gear[run->buf[p]];
+			if (p + 1 >= CHUNKIDX_MIN && !(hash >> (64 - CHUNKIDX_BITS))) {
+				cut = p + 1;
+				break;
+			}
+		}
+		if (!cut && end == CHUNKIDX_MAX)
+			cut = end;
+
+		if (cut) {
+			/* Bytes copied past the boundary are copied again for the next chunk */
+			data += cut - run->buflen;
+			len -= cut - run->buflen;
+			chunkidx_cut(run, cut);
+		} else {
+			run->hash = hash;
+			run->buflen = end;
+			data += n;
+			len -= n;
+		}
+	}
+}
+
+void chunkidx_file(bytestream_t index, char * const filepath) {
+	chunkidx_run_t *run = malloc(sizeof(chunkidx_run_t));
+	run->index[0] = index[0];
+	run->hash = 0;
+	run->offset = 0;
+	run->buflen = 0;
+	chunkidx_gear(run->gear);
+
+	/* Header, the size and count filled in at the end */
+	bs_set_b(index, CHUNKIDX_MAGIC, CHUNKIDX_MAGICLEN);
+	bs_concat_zero(index, index, 2 * sizeof(word_t));
+
+	input_file(filepath, chunkidx_absorb, run);
+	if (run->buflen)
+		chunkidx_cut(run, run->buflen);
+
+	word_t head[2] = {run->offset, (bs_len(index) - CHUNKIDX_HEAD) / CHUNKIDX_ENTRY};
+	memcpy(index[0]->_data + CHUNKIDX_MAGICLEN, head, sizeof(head));
+
+	/* Clear */
+	free(run);
+}
+
+/**
+ * 	Offset of an entry of an index
+ */
+static word_t chunkidx_offset(bs_view_t index, size_t i) {
+	word_t offset;
+	memcpy(&offset, index.data + CHUNKIDX_HEAD + i * CHUNKIDX_ENTRY, sizeof(word_t));
+	return offset;
+}
+
+size_t chunkidx_len(bs_view_t view) {
+	if (view.len < CHUNKIDX_HEAD || memcmp(view.data, CHUNKIDX_MAGIC, CHUNKIDX_MAGICLEN))
+		return 0;
+
+	word_t head[2];
+	memcpy(head, view.data + CHUNKIDX_MAGICLEN, sizeof(head));
+	if (head[1] > (view.len - CHUNKIDX_HEAD) / CHUNKIDX_ENTRY)
+		return 0;
+
+	/* Offsets from 0 to the size, in chunks of 1 to CHUNKIDX_MAX bytes */
+	word_t end = 0;
+	for (size_t i = 0; i < head[1]; i++) {
+		word_t offset = chunkidx_offset(view, i),
+			next = i + 1 < head[1] ? chunkidx_offset(view, i + 1) : head[0];
+		if (offset != end || next <= offset || next - offset > CHUNKIDX_MAX)
+			return 0;
+		end = next;
+	}
+	if (end != head[0])
+		return 0;
+
+	return CHUNKIDX_HEAD + head[1] * CHUNKIDX_ENTRY;
+}
+
+int chunkidx_verify_range(bs_view_t index, char * const filepath, size_t offset, size_t length) {
+	word_t head[2];
+	memcpy(head, index.data + CHUNKIDX_MAGICLEN, sizeof(head));
+	if (offset > head[0] || length > head[0] - offset)
+		return 0;
+
+	int fd = open(filepath, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Could not open \"%s\" for reading\n", filepath);
+		exit(EXIT_FAILURE);
+	}
+	struct stat st;
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+		fprintf(stderr, "Range verification needs a regular file, \"%s\" is not\n", filepath);
+		exit(EXIT_FAILURE);
+	}
+	if (st.st_size != head[0]) {
+		close(fd);
+		return 0;
+	}
+
+	/* Last chunk starting at or before the range */
+	size_t lo = 0, hi = head[1];
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (chunkidx_offset(index, mid) <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	/* Every chunk up to the end of the range */
+	byte_t *buf = malloc(CHUNKIDX_MAX), digest[CHUNKIDX_DIGESTLEN];
+	int ret = 1;
+	for (size_t i = lo; ret && length && i < head[1] && chunkidx_offset(index, i) < offset + length; i++) {
+		word_t start = chunkidx_offset(index, i),
+			end = i + 1 < head[1] ? chunkidx_offset(index, i + 1) : head[0];
+		size_t got = 0;
+		while (got < end - start) {
+			ssize_t n = pread(fd, buf + got, end - start - got, start + got);
+			if (n <= 0) {
+				fprintf(stderr, "Could not read \"%s\"\n", filepath);
+				exit(EXIT_FAILURE);
+			}
+			got += n;
+		}
+		sha3_256(digest, bs_view_b(buf, got));
+		ret = !memcmp(digest, index.data + CHUNKIDX_HEAD + i * CHUNKIDX_ENTRY + sizeof(word_t), CHUNKIDX_DIGESTLEN);
+	}
+
+	/* Clear */
+	free(buf);
+	close(fd);
+
+	return ret;
+}
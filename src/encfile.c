@@ -0,0 +1,267 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/encfile.h"
+#include "../include/pool.h"
+#include "../include/arena.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define encfile_min(a, b) ((a) < (b) ? (a) : (b))
+
+/* Number of records of a plaintext of `size` bytes */
+#define encfile_records(size) (((size) + OAEP_MSGLEN - 1) / OAEP_MSGLEN)
+
+/**
+ * 	State of an encryption or decryption run
+ */
+typedef struct _encfile_run_t {
+	int dec; /* Whether records are decrypted */
+	int in, out; /* Input and output files */
+	word_t size; /* Plaintext bytes */
+	size_t clen; /* Bytes of a cipher */
+	size_t first, count; /* Records of the current batch */
+	rsa_key_t key; /* Key shared by the workers */
+	rsa_ctx_t *ctxs; /* Key context of every worker */
+	char *ready; /* Whether each context is initialized */
+} encfile_run_t;
+
+/**
+ * 	Read exactly `len` bytes at `offset`
+ */
+static void encfile_pread(int fd, byte_t *buf, size_t len, off_t offset) {
+	while (len) {
+		ssize_t got = pread(fd, buf, len, offset);
+		if (got <= 0) {
+			fprintf(stderr, "Could not read the input\n");
+			exit(EXIT_FAILURE);
+		}
+		buf += got;
+		len -= got;
+		offset += got;
+	}
+}
+
+/**
+ * 	Write exactly `len` bytes at `offset`
+ */
+static void encfile_pwrite(int fd, byte_t const *buf, size_t len, off_t offset) {
+	while (len) {
+		ssize_t put = pwrite(fd, buf, len, offset);
+		if (put <= 0) {
+			fprintf(stderr, "Could not write the output\n");
+			exit(EXIT_FAILURE);
+		}
+		buf += put;
+		len -= put;
+		offset += put;
+	}
+}
+
+/**
+ * 	Open a file or exit
+ */
+static int encfile_open(char * const path, int flags) {
+	int fd = open(path, flags, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Could not open \"%s\" for %s\n", path, flags & (O_WRONLY | O_RDWR) ? "writing" : "reading");
+		exit(EXIT_FAILURE);
+	}
+	return fd;
+}
+
+/**
+ * 	Size of an open file
+ */
+static size_t encfile_size(int fd) {
+	struct stat st;
+	if (fstat(fd, &st)) {
+		fprintf(stderr, "Could not stat a file\n");
+		exit(EXIT_FAILURE);
+	}
+	return st.st_size;
+}
+
+/**
+ * 	Read the header of an encrypted file
+ *
+ * 	@return Whether the file starts with a header
+ */
+static int encfile_head(int fd, word_t *head) {
+	byte_t buf[ENCFILE_HEAD];
+	if (encfile_size(fd) < ENCFILE_HEAD)
+		return 0;
+	encfile_pread(fd, buf, ENCFILE_HEAD, 0);
+	memcpy(head, buf + ENCFILE_MAGICLEN, 3 * sizeof(word_t));
+	return !memcmp(buf, ENCFILE_MAGIC, ENCFILE_MAGICLEN);
+}
+
+/**
+ * 	Encrypt or decrypt a group of records with the context of a worker
+ */
+static void encfile_group(void *arg, size_t item, int worker) {
+	encfile_run_t *run = arg;
+	size_t first = run->first + item * ENCFILE_GROUP;
+	size_t count = encfile_min(ENCFILE_GROUP, run->first + run->count - first);
+
+	if (!run->ready[worker]) {
+		rsa_ctx_init(run->ctxs[worker], run->key);
+		run->ready[worker] = 1;
+	}
+
+	arena_begin();
+
+	/* Bytes of the group in the plaintext and in the encrypted file */
+	off_t plainoff = first * OAEP_MSGLEN, cipheroff = ENCFILE_HEAD + first * run->clen;
+	size_t plainlen = encfile_min(count * OAEP_MSGLEN, run->size - plainoff);
+	size_t cipherlen = count * run->clen;
+
+	byte_t *plain = arena_alloc(count * OAEP_MSGLEN), *cipher = arena_alloc(cipherlen);
+	bytestream_t *ins = arena_alloc(2 * count * sizeof(bytestream_t)), *outs = ins + count;
+
+	/* Read the records */
+	if (run->dec)
+		encfile_pread(run->in, cipher, cipherlen, cipheroff);
+	else
+		encfile_pread(run->in, plain, plainlen, plainoff);
+	for (size_t i = 0; i < count; i++) {
+		bs_init(ins[i]);
+		bs_init(outs[i]);
+		if (run->dec)
+			bs_set_view(ins[i], bs_view_b(cipher + i * run->clen, run->clen));
+		else
+			bs_set_view(ins[i], bs_view_b(plain + i * OAEP_MSGLEN, encfile_min(OAEP_MSGLEN, plainlen - i * OAEP_MSGLEN)));
+	}
+
+	/* Write them encrypted or decrypted, the last record without its padding */
+	if (run->dec) {
+		rsa_dec_batch_ctx(outs, ins, count, run->ctxs[worker]);
+		for (size_t i = 0; i < count; i++)
+			memcpy(plain + i * OAEP_MSGLEN, outs[i][0]->_data, OAEP_MSGLEN);
+		encfile_pwrite(run->out, plain, plainlen, plainoff);
+	} else {
+		rsa_enc_batch_ctx(outs, ins, count, run->ctxs[worker]);
+		for (size_t i = 0; i < count; i++)
+			memcpy(cipher + i * run->clen, outs[i][0]->_data, run->clen);
+		encfile_pwrite(run->out, cipher, cipherlen, cipheroff);
+	}
+
+	/* Clear */
+	for (size_t i = 0; i < count; i++) {
+		bs_clear(ins[i]);
+		bs_clear(outs[i]);
+	}
+
+	arena_end();
+}
+
+/**
+ * 	Run records `start` to `total` a batch at a time
+ */
+static size_t encfile_run(encfile_run_t *run, size_t start, size_t total, int threads) {
+	run->ctxs = malloc(threads * sizeof(rsa_ctx_t));
+	run->ready = calloc(threads, 1);
+
+	for (run->first = start; run->first < total; run->first += ENCFILE_BATCH) {
+		run->count = encfile_min(ENCFILE_BATCH, total - run->first);
+		pool_run(encfile_group, run, (run->count + ENCFILE_GROUP - 1) / ENCFILE_GROUP, threads);
+	}
+
+	/* Clear */
+	for (int i = 0; i < threads; i++)
+		if (run->ready[i])
+			rsa_ctx_clear(run->ctxs[i]);
+	free(run->ctxs);
+	free(run->ready);
+
+	return total - start;
+}
+
+/**
+ * 	First record to run again when the output holds `done` records
+ * 	Records of the batch the output reaches into may be missing, those of
+ * 	the batches before it were all written
+ */
+static size_t encfile_resume(size_t done) {
+	return done ? (done - 1) / ENCFILE_BATCH * ENCFILE_BATCH : 0;
+}
+
+size_t encfile_encrypt(char * const outpath, char * const filepath, rsa_key_t const key, int threads, int resume) {
+	encfile_run_t run = {0};
+	run.key = key;
+	run.in = encfile_open(filepath, O_RDONLY);
+	run.out = encfile_open(outpath, O_RDWR | O_CREAT | (resume ? 0 : O_TRUNC));
+	run.size = encfile_size(run.in);
+	run.clen = (mpz_sizeinbase(key.mod, 2) + 7) / 8;
+
+	/* Plaintext length, record length and cipher length */
+	word_t head[3] = {run.size, OAEP_MSGLEN, run.clen};
+	size_t total = encfile_records(run.size), start = 0;
+
+	size_t outsize = encfile_size(run.out);
+	if (resume && outsize) {
+		word_t old[3];
+		if (!encfile_head(run.out, old) || memcmp(old, head, sizeof(head))) {
+			fprintf(stderr, "Could not resume: \"%s\" is not encrypted from \"%s\" with this key\n", outpath, filepath);
+			exit(EXIT_FAILURE);
+		}
+		start = encfile_resume(encfile_min(total, (outsize - ENCFILE_HEAD) / run.clen));
+	} else {
+		encfile_pwrite(run.out, (byte_t *) ENCFILE_MAGIC, ENCFILE_MAGICLEN, 0);
+		encfile_pwrite(run.out, (byte_t *) head, sizeof(head), ENCFILE_MAGICLEN);
+	}
+
+	size_t count = encfile_run(&run, start, total, threads);
+
+	/* Drop whatever a longer output had past the last record */
+	if (ftruncate(run.out, ENCFILE_HEAD + total * run.clen)) {
+		fprintf(stderr, "Could not truncate \"%s\"\n", outpath);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Clear */
+	close(run.in);
+	close(run.out);
+
+	return count;
+}
+
+size_t encfile_decrypt(char * const outpath, char * const filepath, rsa_key_t const key, int threads, int resume) {
+	encfile_run_t run = {0};
+	run.dec = 1;
+	run.key = key;
+	run.in = encfile_open(filepath, O_RDONLY);
+	run.clen = (mpz_sizeinbase(key.mod, 2) + 7) / 8;
+
+	/* Plaintext length, record length and cipher length */
+	word_t head[3];
+	size_t insize = encfile_size(run.in);
+	if (!encfile_head(run.in, head) ||
+		head[1] != OAEP_MSGLEN || head[2] != run.clen ||
+		(insize - ENCFILE_HEAD) / run.clen != encfile_records(head[0]) ||
+		(insize - ENCFILE_HEAD) % run.clen) {
+		fprintf(stderr, "Invalid encrypted file \"%s\" for this key\n", filepath);
+		exit(EXIT_FAILURE);
+	}
+	run.size = head[0];
+
+	run.out = encfile_open(outpath, O_WRONLY | O_CREAT | (resume ? 0 : O_TRUNC));
+	size_t total = encfile_records(run.size);
+	size_t start = resume ? encfile_resume(encfile_min(total, encfile_size(run.out) / OAEP_MSGLEN)) : 0;
+
+	size_t count = encfile_run(&run, start, total, threads);
+
+	/* Drop whatever a longer output had past the plaintext */
+	if (ftruncate(run.out, run.size)) {
+		fprintf(stderr, "Could not truncate \"%s\"\n", outpath);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Clear */
+	close(run.in);
+	close(run.out);
+
+	return count;
+}
@@ -0,0 +1,198 @@
+#define _GNU_SOURCE
+#include "../include/input.h"
+#include "../include/rsa.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Backend names, by backend */
+static char const *input_names[INPUT_BACKENDS] = {"stdio", "mmap", "pread", "direct"};
+
+/* Backend of `input_file` */
+static int input_default = INPUT_STDIO;
+
+int input_backend(char const *name) {
+	for (int i = 0; i < INPUT_BACKENDS; i++)
+		if (!strcmp(name, input_names[i]))
+			return i;
+	return -1;
+}
+
+char const *input_name(int backend) {
+	return input_names[backend];
+}
+
+void input_set_backend(int backend) {
+	input_default = backend;
+}
+
+/**
+ * 	Open a file for reading with open flags `flags`, exiting on failure
+ * 	but for EINVAL, returned as -1
+ */
+static int input_open(char * const filepath, int flags) {
+	int fd = open(filepath, O_RDONLY | flags);
+	if (fd < 0 && errno != EINVAL) {
+		fprintf(stderr, "Could not open \"%s\" for reading\n", filepath);
+		exit(EXIT_FAILURE);
+	}
+	return fd;
+}
+
+/**
+ * 	Exit on a failed read
+ */
+static void input_fail(char const *filepath) {
+	fprintf(stderr, "Could not read \"%s\"\n", filepath);
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * 	Read a file with fread through a buffer of IOBUFSIZE bytes
+ */
+static void input_stdio(char * const filepath, input_fn fn, void *arg) {
+	FILE *file = fopen(filepath, "rb");
+	if (!file) {
+		fprintf(stderr, "Could not open \"%s\" for reading\n", filepath);
+		exit(EXIT_FAILURE);
+	}
+
+	byte_t buf[IOBUFSIZE];
+	size_t n;
+	while ((n = fread(buf, 1, IOBUFSIZE, file)) > 0)
+		fn(arg, buf, n);
+	if (ferror(file))
+		input_fail(filepath);
+
+	fclose(file);
+}
+
+/**
+ * 	Map a file and hand it over in one piece, or read it with stdio if it
+ * 	is not a regular file, whose size does not tell how much it holds
+ */
+static void input_mmap(char * const filepath, input_fn fn, void *arg) {
+	int fd = input_open(filepath, 0);
+	struct stat st;
+	if (fstat(fd, &st))
+		input_fail(filepath);
+	if (!S_ISREG(st.st_mode)) {
+		close(fd);
+		input_stdio(filepath, fn, arg);
+		return;
+	}
+
+	/* Nothing to map in an empty file */
+	if (st.st_size) {
+		byte_t *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+			input_fail(filepath);
+		madvise(data, st.st_size, MADV_SEQUENTIAL);
+		fn(arg, data, st.st_size);
+		munmap(data, st.st_size);
+	}
+
+	close(fd);
+}
+
+/**
+ * 	Read a file from `fd` through `buf` of INPUT_BUFSIZE bytes
+ */
+static void input_loop(char * const filepath, int fd, byte_t *buf, input_fn fn, void *arg) {
+	off_t offset = 0;
+	ssize_t n;
+	while ((n = pread(fd, buf, INPUT_BUFSIZE, offset)) > 0) {
+		fn(arg, buf, n);
+		offset += n;
+	}
+	if (n < 0)
+		input_fail(filepath);
+}
+
+/**
+ * 	Read a file with pread through a buffer of INPUT_BUFSIZE bytes
+ */
+static void input_pread(char * const filepath, input_fn fn, void *arg) {
+	int fd = input_open(filepath, 0);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	byte_t *buf = malloc(INPUT_BUFSIZE);
+	input_loop(filepath, fd, buf, fn, arg);
+
+	free(buf);
+	close(fd);
+}
+
+/**
+ * 	Read a file with O_DIRECT into an aligned buffer
+ */
+static void input_direct(char * const filepath, input_fn fn, void *arg) {
+	int fd = input_open(filepath, O_DIRECT);
+	if (fd < 0) {
+		input_pread(filepath, fn, arg);
+		return;
+	}
+
+	/**
+	 * Reads of INPUT_BUFSIZE bytes at aligned offsets, only the last one
+	 * is short
+	 */
+	void *buf;
+	if (posix_memalign(&buf, INPUT_ALIGN, INPUT_BUFSIZE)) {
+		fprintf(stderr, "Could not allocate an aligned buffer\n");
+		exit(EXIT_FAILURE);
+	}
+	input_loop(filepath, fd, buf, fn, arg);
+
+	free(buf);
+	close(fd);
+}
+
+/**
+ * 	Read the standard input with read through a buffer of INPUT_BUFSIZE
+ * 	bytes
+ */
+static void input_stdin(input_fn fn, void *arg) {
+	byte_t *buf = malloc(INPUT_BUFSIZE);
+	ssize_t n;
+	while ((n = read(STDIN_FILENO, buf, INPUT_BUFSIZE)) != 0) {
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			input_fail("standard input");
+		fn(arg, buf, n);
+	}
+
+	free(buf);
+}
+
+void input_read(char * const filepath, int backend, input_fn fn, void *arg) {
+	/* Pipes can only be read in order */
+	if (!strcmp(filepath, STDIOPATH)) {
+		input_stdin(fn, arg);
+		return;
+	}
+
+	switch (backend) {
+		case INPUT_MMAP:
+			input_mmap(filepath, fn, arg);
+			break;
+		case INPUT_PREAD:
+			input_pread(filepath, fn, arg);
+			break;
+		case INPUT_DIRECT:
+			input_direct(filepath, fn, arg);
+			break;
+		default:
+			input_stdio(filepath, fn, arg);
+	}
+}
+
+void input_file(char * const filepath, input_fn fn, void *arg) {
+	input_read(filepath, input_default, fn, arg);
+}
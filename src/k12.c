@@ -0,0 +1,120 @@
+#include "../include/k12.h"
+#include <string.h>
+
+/**
+ * 	KangarooTwelve padding bytes
+ *
+ * 	K12_PAD_SINGLE: Final node of S up to K12_CHUNK bytes
+ * 	K12_PAD_FINAL: Final node of a tree
+ * 	K12_PAD_LEAF: Chunk of a tree
+ */
+#define K12_PAD_SINGLE 0x07
+#define K12_PAD_FINAL 0x06
+#define K12_PAD_LEAF 0x0b
+
+/**
+ * 	Write the length encoding of `x`: its big endian bytes without leading
+ * 	zeros, then their number
+ *
+ * 	@return Number of bytes written, at most 9
+ */
+static size_t k12_length_encode(byte_t *out, uint64_t x) {
+	size_t n = 0;
+	for (uint64_t v = x; v; v >>= 8)
+		n++;
+	for (size_t i = 0; i < n; i++)
+		out[i] = x >> (8 * (n - 1 - i));
+	out[n] = n;
+	return n + 1;
+}
+
+/**
+ * 	Hash `size` bytes of chunks, the last one possibly shorter, and absorb
+ * 	their chaining values into the final node
+ */
+static void k12_chunks(k12_ctx_t ctx, const byte_t *data, size_t size) {
+	byte_t cvs[SHA3_XN_MAXLANES * K12_CVLEN], *outs[SHA3_XN_MAXLANES];
+	bs_view_t views[SHA3_XN_MAXLANES];
+	size_t count = 0;
+
+	for (size_t off = 0; off < size; off += K12_CHUNK, count++) {
+		views[count] = bs_view_b((byte_t *) data + off, size - off < K12_CHUNK ? size - off : K12_CHUNK);
+		outs[count] = cvs + count * K12_CVLEN;
+	}
+
+	turboshake128_xn(outs, views, count, K12_CVLEN * 8, K12_PAD_LEAF);
+	sha3_update(ctx->_node, cvs, count * K12_CVLEN);
+	ctx->_nchunks += count;
+}
+
+void k12_init(k12_ctx_t ctx, size_t len) {
+	turboshake128_init(ctx->_node, len, K12_PAD_SINGLE);
+	ctx->_chunklen = 0;
+	ctx->_absorbed = 0;
+	ctx->_nchunks = 0;
+}
+
+void k12_update(k12_ctx_t ctx, const void *data, size_t size) {
+	const byte_t *in = data;
+
+	/* The first chunk goes to the final node */
+	if (ctx->_absorbed < K12_CHUNK) {
+		size_t n = K12_CHUNK - ctx->_absorbed < size ? K12_CHUNK - ctx->_absorbed : size;
+		sha3_update(ctx->_node, in, n);
+		ctx->_absorbed += n;
+		in += n;
+		size -= n;
+	}
+	if (!size)
+		return;
+
+	/* S is longer than a chunk: the first one is followed by 0x03 and 7 zero bytes */
+	if (ctx->_absorbed == K12_CHUNK) {
+		const byte_t marker[8] = {0x03};
+		sha3_update(ctx->_node, marker, sizeof(marker));
+	}
+	ctx->_absorbed += size;
+
+	/* Hash whole batches straight from the input while nothing is buffered */
+	for (; !ctx->_chunklen && size >= K12_BATCH; in += K12_BATCH, size -= K12_BATCH)
+		k12_chunks(ctx, in, K12_BATCH);
+
+	/* Buffer the rest, hashing the buffer whenever it is full */
+	while (size) {
+		size_t n = K12_BATCH - ctx->_chunklen < size ? K12_BATCH - ctx->_chunklen : size;
+		memcpy(ctx->_chunks + ctx->_chunklen, in, n);
+		ctx->_chunklen += n;
+		in += n;
+		size -= n;
+		if (ctx->_chunklen == K12_BATCH) {
+			k12_chunks(ctx, ctx->_chunks, K12_BATCH);
+			ctx->_chunklen = 0;
+		}
+	}
+}
+
+void k12_final(bytestream_t hash, k12_ctx_t ctx, bs_view_t custom) {
+	byte_t enc[9];
+	k12_update(ctx, custom.data, custom.len);
+	k12_update(ctx, enc, k12_length_encode(enc, custom.len));
+
+	if (ctx->_absorbed > K12_CHUNK) {
+		if (ctx->_chunklen)
+			k12_chunks(ctx, ctx->_chunks, ctx->_chunklen);
+		sha3_update(ctx->_node, enc, k12_length_encode(enc, ctx->_nchunks));
+		sha3_update(ctx->_node, (byte_t []) {0xff, 0xff}, 2);
+		ctx->_node->_pad = K12_PAD_FINAL;
+	}
+
+	sha3_final(hash, ctx->_node);
+	ctx->_chunklen = 0;
+	ctx->_absorbed = 0;
+	ctx->_nchunks = 0;
+}
+
+void k12(bytestream_t hash, bs_view_t msg, bs_view_t custom, size_t len) {
+	k12_ctx_t ctx;
+	k12_init(ctx, len);
+	k12_update(ctx, msg.data, msg.len);
+	k12_final(hash, ctx, custom);
+}
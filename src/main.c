@@ -5,6 +5,14 @@
 #include <string.h>
 #include <getopt.h>
 #include "../include/rsa.h"
+#include "../include/manifest.h"
+#include "../include/signtree.h"
+#include "../include/encfile.h"
+#include "../include/treehash.h"
+#include "../include/chunkidx.h"
+#include "../include/pool.h"
+#include "../include/pipeline.h"
+#include "../include/input.h"
 
 /* Executable name */
 #define PROGRAMNAME "rsa"
@@ -13,6 +21,13 @@
 #define GENKEYS "genkeys"
 #define SIGN "sign"
 #define VERIFY "verify"
+#define SIGNAPPEND "sign-append"
+#define SIGNBATCH "sign-batch"
+#define VERIFYMANIFEST "verify-manifest"
+#define SIGNTREE "sign-tree"
+#define ENCRYPT "encrypt"
+#define DECRYPT "decrypt"
+#define VERIFYRANGE "verify-range"
 
 /* Command line arguments */
 #define HELPA "h"
@@ -20,37 +35,129 @@
 #define KEYA "k"
 #define FILEA "f"
 #define SIGNA "s"
+#define STATEA "t"
+#define PRIMESA "p"
+#define THREADSA "j"
+#define SLOTSA "r"
+#define INPUTA "i"
+#define OUTPUTA "o"
+#define RESUMEA "u"
+#define LEAFA "l"
+#define HASHA "a"
+#define INDEXA "x"
+#define OFFSETA "b"
+#define LENGTHA "n"
 
 #define HELPO 'h'
 #define CMDO 'c'
 #define KEYO 'k'
 #define FILEO 'f'
 #define SIGNO 's'
+#define STATEO 't'
+#define PRIMESO 'p'
+#define THREADSO 'j'
+#define SLOTSO 'r'
+#define INPUTO 'i'
+#define OUTPUTO 'o'
+#define RESUMEO 'u'
+#define LEAFO 'l'
+#define HASHO 'a'
+#define INDEXO 'x'
+#define OFFSETO 'b'
+#define LENGTHO 'n'
 
 #define print_usage() \
-fprintf(stderr, "Usage: "PROGRAMNAME" -"CMDA" COMMAND OPTIONS\n"); \
-fprintf(stderr, "\t -"CMDA" Available commands are: "GENKEYS"|"SIGN"|"VERIFY"\n"); \
+fprintf(stderr, "Usage: "PROGRAMNAME" -"CMDA" COMMAND OPTIONS [FILES]\n"); \
+fprintf(stderr, "\t -"CMDA" Available commands are: "GENKEYS"|"SIGN"|"VERIFY"|"SIGNAPPEND"|"SIGNBATCH"|"VERIFYMANIFEST"|"SIGNTREE"|"ENCRYPT"|"DECRYPT"|"VERIFYRANGE"\n"); \
+fprintf(stderr, "\t -"INPUTA" Backend files are read with: stdio|mmap|pread|direct (optional, default stdio)\n"); \
 fprintf(stderr, "Commands:\n"); \
 fprintf(stderr, "\t "GENKEYS" Generate a key pair\n"); \
 fprintf(stderr, "\t Options:\n"); \
 fprintf(stderr, "\t\t -"FILEA" File name prefix to save public key ("PKSUFFIX") and secret key ("SKSUFFIX")\n"); \
+fprintf(stderr, "\t\t -"PRIMESA" Number of prime factors of the modulo, 2 to %d (optional, default %d)\n", MAXPRIMES, PRIMES); \
 fprintf(stderr, "\t "SIGN" Sign a file\n"); \
 fprintf(stderr, "\t Options:\n"); \
-fprintf(stderr, "\t\t -"FILEA" File to sign\n"); \
+fprintf(stderr, "\t\t -"FILEA" File to sign, "STDIOPATH" for the standard input\n"); \
 fprintf(stderr, "\t\t -"KEYA" Key file\n"); \
-fprintf(stderr, "\t\t -"SIGNA" File name prefix to save signature ("SIGNSUFFIX")\n"); \
+fprintf(stderr, "\t\t -"SIGNA" File name prefix to save signature ("SIGNSUFFIX"), "STDIOPATH" for the standard output (optional with -"FILEA" "STDIOPATH")\n"); \
+fprintf(stderr, "\t\t -"LEAFA" Hash the file as a tree of leaves of this many bytes, with a K, M or G suffix, at least %d (optional)\n", TREEHASH_MINLEAF); \
+fprintf(stderr, "\t\t -"HASHA" Hash algorithm, saved with the signature: shake256|k12 (optional, default shake256 with no header)\n"); \
+fprintf(stderr, "\t\t -"INDEXA" Sign an index of content-defined chunks of %d to %d bytes, so byte ranges can be checked with "VERIFYRANGE" (optional)\n", CHUNKIDX_MIN, CHUNKIDX_MAX); \
+fprintf(stderr, "\t\t -"THREADSA" Number of threads hashing the leaves of a tree (optional, default %d)\n", pool_threads()); \
 fprintf(stderr, "\t "VERIFY" Verify a file\n"); \
 fprintf(stderr, "\t Options:\n"); \
+fprintf(stderr, "\t\t -"FILEA" File to verify, "STDIOPATH" for the standard input\n"); \
+fprintf(stderr, "\t\t -"KEYA" Key file\n"); \
+fprintf(stderr, "\t\t -"SIGNA" Signature file, "STDIOPATH" for the standard input\n"); \
+fprintf(stderr, "\t\t -"THREADSA" Number of threads hashing the leaves of a tree (optional, default %d)\n", pool_threads()); \
+fprintf(stderr, "\t "VERIFYRANGE" Verify a byte range of a file, reading only the chunks covering it if signed with -"INDEXA"\n"); \
+fprintf(stderr, "\t Options:\n"); \
 fprintf(stderr, "\t\t -"FILEA" File to verify\n"); \
 fprintf(stderr, "\t\t -"KEYA" Key file\n"); \
-fprintf(stderr, "\t\t -"SIGNA" Signature file\n")
+fprintf(stderr, "\t\t -"SIGNA" Signature file, "STDIOPATH" for the standard input\n"); \
+fprintf(stderr, "\t\t -"OFFSETA" First byte of the range, with a K, M or G suffix (optional, default 0)\n"); \
+fprintf(stderr, "\t\t -"LENGTHA" Bytes of the range, with a K, M or G suffix\n"); \
+fprintf(stderr, "\t "SIGNAPPEND" Sign a file that only grows, hashing only what was appended since the last call\n"); \
+fprintf(stderr, "\t Options:\n"); \
+fprintf(stderr, "\t\t -"FILEA" File to sign\n"); \
+fprintf(stderr, "\t\t -"KEYA" Key file\n"); \
+fprintf(stderr, "\t\t -"SIGNA" File name prefix to save signature ("SIGNSUFFIX")\n"); \
+fprintf(stderr, "\t\t -"STATEA" Hashing state file, created if missing and updated on every call\n"); \
+fprintf(stderr, "\t "SIGNBATCH" Sign many files with one secret key operation, verified with "VERIFY"\n"); \
+fprintf(stderr, "\t Options:\n"); \
+fprintf(stderr, "\t\t -"KEYA" Key file\n"); \
+fprintf(stderr, "\t\t -"SLOTSA" Read and hash the files in a pipeline with a ring of this many slots of %d bytes, printing the utilization of every stage (optional)\n", PIPELINE_SLOTSIZE); \
+fprintf(stderr, "\t\t -"THREADSA" Number of hashing threads of the pipeline (optional, default %d)\n", pool_threads()); \
+fprintf(stderr, "\t\t FILES Files to sign, each signature is saved next to its file ("SIGNSUFFIX")\n"); \
+fprintf(stderr, "\t "VERIFYMANIFEST" Verify every file of a manifest, exits with failure if any is invalid\n"); \
+fprintf(stderr, "\t Options:\n"); \
+fprintf(stderr, "\t\t -"FILEA" Manifest file, with a file, its signature file and a key file per entry\n"); \
+fprintf(stderr, "\t\t -"THREADSA" Number of threads (optional, default %d)\n", pool_threads()); \
+fprintf(stderr, "\t\t -"SLOTSA" Read and hash the files in a pipeline with a ring of this many slots of %d bytes, printing the utilization of every stage (optional)\n", PIPELINE_SLOTSIZE); \
+fprintf(stderr, "\t "SIGNTREE" Sign every regular file under a directory, each signature is saved next to its file ("SIGNSUFFIX")\n"); \
+fprintf(stderr, "\t Options:\n"); \
+fprintf(stderr, "\t\t -"FILEA" Directory to sign\n"); \
+fprintf(stderr, "\t\t -"KEYA" Key file\n"); \
+fprintf(stderr, "\t\t -"THREADSA" Number of threads (optional, default %d)\n", pool_threads()); \
+fprintf(stderr, "\t "ENCRYPT" Encrypt a file in records of %d bytes\n", OAEP_MSGLEN); \
+fprintf(stderr, "\t Options:\n"); \
+fprintf(stderr, "\t\t -"FILEA" File to encrypt\n"); \
+fprintf(stderr, "\t\t -"KEYA" Key file\n"); \
+fprintf(stderr, "\t\t -"OUTPUTA" Encrypted file\n"); \
+fprintf(stderr, "\t\t -"THREADSA" Number of threads (optional, default %d)\n", pool_threads()); \
+fprintf(stderr, "\t\t -"RESUMEA" Resume an interrupted run, keeping the records already in the output (optional)\n"); \
+fprintf(stderr, "\t "DECRYPT" Decrypt a file made by "ENCRYPT"\n"); \
+fprintf(stderr, "\t Options:\n"); \
+fprintf(stderr, "\t\t -"FILEA" Encrypted file\n"); \
+fprintf(stderr, "\t\t -"KEYA" Key file\n"); \
+fprintf(stderr, "\t\t -"OUTPUTA" Decrypted file\n"); \
+fprintf(stderr, "\t\t -"THREADSA" Number of threads (optional, default %d)\n", pool_threads()); \
+fprintf(stderr, "\t\t -"RESUMEA" Resume an interrupted run, keeping the records already in the output (optional)\n")
+
+/**
+ * 	Number of bytes with an optional K, M or G suffix, 0 if invalid
+ */
+static size_t parse_size(char const *arg) {
+	char *end;
+	unsigned long long size = strtoull(arg, &end, 10);
+	switch (*end) {
+		case 'G': size <<= 10; /* fall through */
+		case 'M': size <<= 10; /* fall through */
+		case 'K': size <<= 10; end++;
+	}
+	return *end || end == arg ? 0 : size;
+}
 
 int main (int argc, char **argv) {
-	char *cmd = NULL, *keyfile = NULL, *file = NULL, *sign = NULL;
+	char *cmd = NULL, *keyfile = NULL, *file = NULL, *sign = NULL, *state = NULL, *output = NULL;
+	int nprimes = PRIMES, threads = pool_threads(), slots = 0, resume = 0;
+	size_t leafsize = 0;
+	int algo = -1, index = 0;
+	size_t offset = 0, length = 0;
 
 	/* Read command line arguments */
 	int c;
-	while ((c = getopt(argc, argv, HELPA CMDA":" KEYA ":" FILEA ":" SIGNA ":")) != -1)
+	while ((c = getopt(argc, argv, HELPA CMDA":" KEYA ":" FILEA ":" SIGNA ":" STATEA ":" PRIMESA ":" THREADSA ":" SLOTSA ":" INPUTA ":" OUTPUTA ":" RESUMEA LEAFA ":" HASHA ":" INDEXA OFFSETA ":" LENGTHA ":")) != -1)
 		switch (c) {
 			case CMDO:
 				cmd = optarg;
@@ -64,6 +171,66 @@ int main (int argc, char **argv) {
 			case SIGNO:
 				sign = optarg;
 				break;
+			case STATEO:
+				state = optarg;
+				break;
+			case OUTPUTO:
+				output = optarg;
+				break;
+			case RESUMEO:
+				resume = 1;
+				break;
+			case LEAFO:
+				leafsize = parse_size(optarg);
+				if (leafsize < TREEHASH_MINLEAF) {
+					fprintf(stderr, "Invalid leaf size: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case HASHO:
+				algo = rsa_hash_algo(optarg);
+				if (algo < 0) {
+					fprintf(stderr, "Invalid hash algorithm: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case INDEXO:
+				index = 1;
+				break;
+			case OFFSETO:
+				offset = parse_size(optarg);
+				if (!offset && strcmp(optarg, "0")) {
+					fprintf(stderr, "Invalid offset: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case LENGTHO:
+				length = parse_size(optarg);
+				if (!length) {
+					fprintf(stderr, "Invalid length: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case PRIMESO:
+				nprimes = atoi(optarg);
+				break;
+			case THREADSO:
+				threads = atoi(optarg);
+				break;
+			case INPUTO:
+				if (input_backend(optarg) < 0) {
+					fprintf(stderr, "Invalid input backend: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				input_set_backend(input_backend(optarg));
+				break;
+			case SLOTSO:
+				slots = atoi(optarg);
+				if (slots < 1) {
+					fprintf(stderr, "Invalid number of slots: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
 			default:
 				fprintf(stderr, "Bad arguments\n");
 			case HELPO:
@@ -77,6 +244,10 @@ int main (int argc, char **argv) {
 		exit(EXIT_FAILURE);
 	}
 
+	/* Signatures of the standard input go to the standard output */
+	if (cmd && !strcmp(SIGN, cmd) && file && !strcmp(file, STDIOPATH) && !sign)
+		sign = STDIOPATH;
+
 	/* Check if GENKEYS command is well-formed */
 	if (!strcmp(GENKEYS, cmd) && !file) {
 		fprintf(stderr, "Missing argument: -"FILEA"\n");
@@ -88,11 +259,65 @@ int main (int argc, char **argv) {
 	) {
 		fprintf(stderr, "Missing argument: -"FILEA" OR -"KEYA" OR -"SIGN"\n");
 		exit(EXIT_FAILURE);
+	/* Check if SIGNAPPEND command is well-formed */
+	} else if (
+		!strcmp(SIGNAPPEND, cmd) &&
+		(!file || !keyfile || !sign || !state)
+	) {
+		fprintf(stderr, "Missing argument: -"FILEA" OR -"KEYA" OR -"SIGNA" OR -"STATEA"\n");
+		exit(EXIT_FAILURE);
+	/* Check if SIGNBATCH command is well-formed */
+	} else if (
+		!strcmp(SIGNBATCH, cmd) &&
+		(!keyfile || optind == argc)
+	) {
+		fprintf(stderr, "Missing argument: -"KEYA" OR FILES\n");
+		exit(EXIT_FAILURE);
+	/* Check if VERIFYMANIFEST command is well-formed */
+	} else if (!strcmp(VERIFYMANIFEST, cmd) && !file) {
+		fprintf(stderr, "Missing argument: -"FILEA"\n");
+		exit(EXIT_FAILURE);
+	/* Check if SIGNTREE command is well-formed */
+	} else if (!strcmp(SIGNTREE, cmd) && (!file || !keyfile)) {
+		fprintf(stderr, "Missing argument: -"FILEA" OR -"KEYA"\n");
+		exit(EXIT_FAILURE);
+	/* Check if ENCRYPT or DECRYPT command is well-formed */
+	} else if (
+		(!strcmp(ENCRYPT, cmd) || !strcmp(DECRYPT, cmd)) &&
+		(!file || !keyfile || !output)
+	) {
+		fprintf(stderr, "Missing argument: -"FILEA" OR -"KEYA" OR -"OUTPUTA"\n");
+		exit(EXIT_FAILURE);
+	/* Check if VERIFYRANGE command is well-formed */
+	} else if (!strcmp(VERIFYRANGE, cmd) && (!file || !keyfile || !sign || !length)) {
+		fprintf(stderr, "Missing argument: -"FILEA" OR -"KEYA" OR -"SIGNA" OR -"LENGTHA"\n");
+		exit(EXIT_FAILURE);
+	/* Check if a tree hash reads a file */
+	} else if (leafsize && (strcmp(SIGN, cmd) || !strcmp(file, STDIOPATH))) {
+		fprintf(stderr, "Only "SIGN" of a file takes -"LEAFA"\n");
+		exit(EXIT_FAILURE);
+	/* Check if a hash algorithm is given to a plain SIGN */
+	} else if (algo >= 0 && (strcmp(SIGN, cmd) || leafsize)) {
+		fprintf(stderr, "Only "SIGN" without -"LEAFA" takes -"HASHA"\n");
+		exit(EXIT_FAILURE);
+	/* Check if a chunk index is asked of a plain SIGN */
+	} else if (index && (strcmp(SIGN, cmd) || leafsize || algo >= 0)) {
+		fprintf(stderr, "Only "SIGN" without -"LEAFA" or -"HASHA" takes -"INDEXA"\n");
+		exit(EXIT_FAILURE);
+	/* Check if VERIFY reads the standard input only once */
+	} else if (!strcmp(VERIFY, cmd) && !strcmp(file, STDIOPATH) && !strcmp(sign, STDIOPATH)) {
+		fprintf(stderr, "Only one of -"FILEA" and -"SIGNA" can be "STDIOPATH"\n");
+		exit(EXIT_FAILURE);
+	} else if (threads < 1) {
+		fprintf(stderr, "Invalid number of threads: %d\n", threads);
+		exit(EXIT_FAILURE);
 	}
 
+	treehash_set_threads(threads);
+
 	/* Run command */
 	if (!strcmp(GENKEYS, cmd)) {
-		keypair_t keys = rsa_gen_keypair();
+		keypair_t keys = rsa_gen_keypair_primes(nprimes);
 
 		char file_ext[strlen(file) + KEYSUFFIXLEN + 1];
 		strcpy(file_ext, file);
@@ -105,13 +330,95 @@ int main (int argc, char **argv) {
 		rsa_clear_keys(keys);
 	} else if (!strcmp(SIGN, cmd)) {
 		rsa_key_t key = rsa_load_key(keyfile);
-		rsa_sign_file(sign, file, key);
+		rsa_ctx_t ctx;
+		rsa_ctx_init(ctx, key);
+		if (leafsize)
+			rsa_sign_file_tree_ctx(sign, file, leafsize, ctx);
+		else if (algo >= 0)
+			rsa_sign_file_hash_ctx(sign, file, algo, ctx);
+		else if (index)
+			rsa_sign_file_index_ctx(sign, file, ctx);
+		else
+			rsa_sign_file_ctx(sign, file, ctx);
 
+		rsa_ctx_clear(ctx);
 		rsa_clear_key(key);
 	} else if (!strcmp(VERIFY, cmd)) {
 		rsa_key_t key = rsa_load_key(keyfile);
 		printf("%s\n", rsa_verify_file(sign, file, key) ? "Valid" : "Invalid");
 
+		rsa_clear_key(key);
+	} else if (!strcmp(VERIFYRANGE, cmd)) {
+		rsa_key_t key = rsa_load_key(keyfile);
+		printf("%s\n", rsa_verify_file_range(sign, file, offset, length, key) ? "Valid" : "Invalid");
+
+		rsa_clear_key(key);
+	} else if (!strcmp(SIGNAPPEND, cmd)) {
+		rsa_key_t key = rsa_load_key(keyfile);
+		rsa_ctx_t ctx;
+		rsa_ctx_init(ctx, key);
+		rsa_sign_append_ctx(sign, file, state, ctx);
+
+		rsa_ctx_clear(ctx);
+		rsa_clear_key(key);
+	} else if (!strcmp(SIGNBATCH, cmd)) {
+		rsa_key_t key = rsa_load_key(keyfile);
+		if (slots) {
+			size_t count = argc - optind;
+			bytestream_t *digests = malloc(count * sizeof(bytestream_t));
+			for (size_t i = 0; i < count; i++)
+				bs_init_size(digests[i], BITLEN / 8);
+
+			pipeline_stats_t stats;
+			pipeline_digests(&stats, digests, argv + optind, count, slots, threads);
+			rsa_sign_batch_digests(argv + optind, digests, count, key);
+			pipeline_print(stderr, &stats);
+
+			for (size_t i = 0; i < count; i++)
+				bs_clear(digests[i]);
+			free(digests);
+		} else {
+			rsa_sign_batch(argv + optind, argc - optind, key);
+		}
+
+		rsa_clear_key(key);
+	} else if (!strcmp(VERIFYMANIFEST, cmd)) {
+		manifest_t manifest;
+		manifest_load(manifest, file);
+
+		int *valid = malloc(manifest->count * sizeof(int));
+		pipeline_stats_t stats;
+		size_t nvalid = slots ?
+			manifest_verify_pipeline(valid, &stats, manifest, slots, threads) :
+			manifest_verify(valid, manifest, threads);
+		size_t nerrors = 0;
+		for (size_t i = 0; i < manifest->count; i++) {
+			printf("%s: %s\n", manifest->files[i], valid[i] < 0 ? "Error" : valid[i] ? "Valid" : "Invalid");
+			nerrors += valid[i] < 0;
+		}
+		printf("%zu of %zu valid, %zu could not be read\n", nvalid, manifest->count, nerrors);
+		if (slots)
+			pipeline_print(stderr, &stats);
+
+		int ok = nvalid == manifest->count;
+		free(valid);
+		manifest_clear(manifest);
+		if (!ok)
+			exit(EXIT_FAILURE);
+	} else if (!strcmp(SIGNTREE, cmd)) {
+		rsa_key_t key = rsa_load_key(keyfile);
+		printf("%zu files signed\n", signtree_sign(file, key, threads));
+
+		rsa_clear_key(key);
+	} else if (!strcmp(ENCRYPT, cmd)) {
+		rsa_key_t key = rsa_load_key(keyfile);
+		printf("%zu records encrypted\n", encfile_encrypt(output, file, key, threads, resume));
+
+		rsa_clear_key(key);
+	} else if (!strcmp(DECRYPT, cmd)) {
+		rsa_key_t key = rsa_load_key(keyfile);
+		printf("%zu records decrypted\n", encfile_decrypt(output, file, key, threads, resume));
+
 		rsa_clear_key(key);
 	} else {
 		fprintf(stderr, "Invalid command: \"%s\"\n", cmd);
@@ -0,0 +1,179 @@
+#include "../include/manifest.h"
+#include "../include/pool.h"
+#include "../include/arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * 	Read the next path of a manifest, skipping comments
+ *
+ * 	@return 1 if a path was read, 0 at the end of the file
+ */
+static int manifest_read_path(FILE *file, char *path, char * const filepath) {
+	for (;;) {
+		if (fscanf(file, "%4095s", path) != 1)
+			return 0;
+		if (strlen(path) == MANIFEST_MAXPATH - 1) {
+			fprintf(stderr, "Path too long in manifest \"%s\"\n", filepath);
+			exit(EXIT_FAILURE);
+		}
+		if (path[0] != '#')
+			return 1;
+		if (fscanf(file, "%*[^\n]") == EOF)
+			return 0;
+	}
+}
+
+/**
+ * 	Copy of a string
+ */
+static char *manifest_copy(char const *str) {
+	return strcpy(malloc(strlen(str) + 1), str);
+}
+
+/**
+ * 	Index of the key at `keypath`, loading it on its first use
+ */
+static size_t manifest_key(manifest_t manifest, char * const keypath) {
+	for (size_t i = 0; i < manifest->_nkeys; i++)
+		if (!strcmp(manifest->_keypaths[i], keypath))
+			return i;
+
+	size_t i = manifest->_nkeys++;
+	manifest->_keys = realloc(manifest->_keys, manifest->_nkeys * sizeof(rsa_key_t));
+	manifest->_keypaths = realloc(manifest->_keypaths, manifest->_nkeys * sizeof(char *));
+	manifest->_keys[i] = rsa_load_key(keypath);
+	manifest->_keypaths[i] = manifest_copy(keypath);
+	return i;
+}
+
+void manifest_load(manifest_t manifest, char * const filepath) {
+	FILE *file = fopen(filepath, "r");
+	if (!file) {
+		fprintf(stderr, "Could not open \"%s\" for reading\n", filepath);
+		exit(EXIT_FAILURE);
+	}
+
+	memset(manifest, 0, sizeof(manifest_t));
+	char path[3][MANIFEST_MAXPATH];
+	size_t avail = 0;
+	while (manifest_read_path(file, path[0], filepath)) {
+		if (!manifest_read_path(file, path[1], filepath) || !manifest_read_path(file, path[2], filepath)) {
+			fprintf(stderr, "Incomplete entry in manifest \"%s\"\n", filepath);
+			exit(EXIT_FAILURE);
+		}
+
+		if (manifest->count == avail) {
+			avail = avail ? 2 * avail : 64;
+			manifest->files = realloc(manifest->files, avail * sizeof(char *));
+			manifest->signs = realloc(manifest->signs, avail * sizeof(char *));
+			manifest->keys = realloc(manifest->keys, avail * sizeof(size_t));
+		}
+		manifest->files[manifest->count] = manifest_copy(path[0]);
+		manifest->signs[manifest->count] = manifest_copy(path[1]);
+		manifest->keys[manifest->count] = manifest_key(manifest, path[2]);
+		manifest->count++;
+	}
+
+	fclose(file);
+}
+
+void manifest_clear(manifest_t manifest) {
+	for (size_t i = 0; i < manifest->count; i++) {
+		free(manifest->files[i]);
+		free(manifest->signs[i]);
+	}
+	for (size_t i = 0; i < manifest->_nkeys; i++) {
+		rsa_clear_key(manifest->_keys[i]);
+		free(manifest->_keypaths[i]);
+	}
+	free(manifest->files);
+	free(manifest->signs);
+	free(manifest->keys);
+	free(manifest->_keys);
+	free(manifest->_keypaths);
+}
+
+/**
+ * 	State of a verification run
+ */
+typedef struct _manifest_run_t {
+	struct _manifest_t const *manifest; /* Entries */
+	int *valid; /* Results, -1 for entries that could not be read */
+	rsa_ctx_t *ctxs; /* Key context of key k for worker w at w * nkeys + k */
+	char *ready; /* Whether each context is initialized */
+} manifest_run_t;
+
+/**
+ * 	Verify one entry with the contexts of a worker
+ */
+static void manifest_verify_entry(void *arg, size_t item, int worker) {
+	manifest_run_t *run = arg;
+	struct _manifest_t const *manifest = run->manifest;
+	size_t k = worker * manifest->_nkeys + manifest->keys[item];
+
+	if (!run->ready[k]) {
+		rsa_ctx_init(run->ctxs[k], manifest->_keys[manifest->keys[item]]);
+		run->ready[k] = 1;
+	}
+	arena_begin();
+	run->valid[item] = rsa_verify_file_ctx(manifest->signs[item], manifest->files[item], run->ctxs[k]);
+	arena_end();
+}
+
+/**
+ * 	Verify the signature of an entry whose file is hashed, in the final
+ * 	stage of a pipeline with one context per key
+ */
+static void manifest_verify_digest(void *arg, size_t item, bytestream_t const digest) {
+	manifest_run_t *run = arg;
+	struct _manifest_t const *manifest = run->manifest;
+	size_t k = manifest->keys[item];
+
+	if (!run->ready[k]) {
+		rsa_ctx_init(run->ctxs[k], manifest->_keys[k]);
+		run->ready[k] = 1;
+	}
+	if (!digest) {
+		run->valid[item] = -1;
+		return;
+	}
+	arena_begin();
+	run->valid[item] = rsa_verify_file_digest_ctx(manifest->signs[item], manifest->files[item], digest, run->ctxs[k]);
+	arena_end();
+}
+
+/**
+ * 	Clear the contexts of a run and count the valid entries
+ */
+static size_t manifest_run_clear(manifest_run_t *run, size_t nctxs) {
+	for (size_t k = 0; k < nctxs; k++)
+		if (run->ready[k])
+			rsa_ctx_clear(run->ctxs[k]);
+	free(run->ctxs);
+	free(run->ready);
+
+	size_t nvalid = 0;
+	for (size_t i = 0; i < run->manifest->count; i++)
+		nvalid += run->valid[i] == 1;
+	return nvalid;
+}
+
+size_t manifest_verify(int *valid, manifest_t const manifest, int threads) {
+	size_t nctxs = threads * manifest->_nkeys;
+	manifest_run_t run = {manifest, valid, malloc(nctxs * sizeof(rsa_ctx_t)), calloc(nctxs, 1)};
+
+	pool_run(manifest_verify_entry, &run, manifest->count, threads);
+
+	return manifest_run_clear(&run, nctxs);
+}
+
+size_t manifest_verify_pipeline(int *valid, pipeline_stats_t *stats, manifest_t const manifest, int slots, int threads) {
+	size_t nctxs = manifest->_nkeys;
+	manifest_run_t run = {manifest, valid, malloc(nctxs * sizeof(rsa_ctx_t)), calloc(nctxs, 1)};
+
+	pipeline_run(stats, manifest->files, manifest->count, manifest_verify_digest, &run, slots, threads);
+
+	return manifest_run_clear(&run, nctxs);
+}
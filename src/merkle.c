@@ -0,0 +1,124 @@
+#include "../include/merkle.h"
+#include "../include/sha3.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Prefixes of leaves, inner nodes and the root */
+#define MERKLE_LEAF 0
+#define MERKLE_NODE 1
+#define MERKLE_ROOT 2
+
+/* cSHAKE256 customization string of every hash of the tree */
+#define merkle_custom() bs_view_b((byte_t *) MERKLE_CUSTOM, strlen(MERKLE_CUSTOM))
+
+/* Number of nodes in the level above one of `n` nodes */
+#define merkle_up(n) (((n) + 1) / 2)
+
+/**
+ * 	Set `bs` to a prefix byte followed by one or two nodes
+ */
+static void merkle_input(bytestream_t bs, byte_t prefix, bytestream_t const left, bytestream_t const right) {
+	bs_set_b(bs, &prefix, 1);
+	bs_concat(bs, bs, left);
+	if (right)
+		bs_concat(bs, bs, right);
+}
+
+void merkle_init(merkle_t tree, bytestream_t *digests, size_t count, size_t len) {
+	if (!count) {
+		fprintf(stderr, "A Merkle tree needs at least one leaf\n");
+		exit(EXIT_FAILURE);
+	}
+
+	tree->_count = count;
+	tree->_len = len;
+	tree->_nnodes = count;
+	for (size_t n = count; n > 1; n = merkle_up(n))
+		tree->_nnodes += merkle_up(n);
+	tree->_nodes = malloc(tree->_nnodes * sizeof(bytestream_t));
+	for (size_t i = 0; i < tree->_nnodes; i++)
+		bs_init_size(tree->_nodes[i], 1 + 2 * len / 8);
+
+	/* Leaves */
+	bytestream_t *level = tree->_nodes;
+	for (size_t i = 0; i < count; i++)
+		merkle_input(level[i], MERKLE_LEAF, digests[i], NULL);
+	cshake256_xn(level, level, count, len, merkle_custom());
+
+	/* Every pair of nodes of a level at once, the odd one out goes up as is */
+	for (size_t n = count; n > 1; n = merkle_up(n)) {
+		bytestream_t *next = level + n;
+		for (size_t i = 0; i < n / 2; i++)
+			merkle_input(next[i], MERKLE_NODE, level[2 * i], level[2 * i + 1]);
+		cshake256_xn(next, next, n / 2, len, merkle_custom());
+		if (n % 2)
+			bs_set(next[n / 2], level[n - 1]);
+		level = next;
+	}
+}
+
+void merkle_clear(merkle_t tree) {
+	for (size_t i = 0; i < tree->_nnodes; i++)
+		bs_clear(tree->_nodes[i]);
+	free(tree->_nodes);
+}
+
+/**
+ * 	Hash a prefix byte followed by one or two nodes, where they are
+ */
+static void merkle_hash(bytestream_t node, byte_t prefix, bs_view_t left, bs_view_t right, size_t len) {
+	sha3_ctx_t ctx;
+	cshake256_init(ctx, len, merkle_custom());
+	sha3_update(ctx, &prefix, 1);
+	sha3_update(ctx, left.data, left.len);
+	if (right.len)
+		sha3_update(ctx, right.data, right.len);
+	sha3_final(node, ctx);
+}
+
+/**
+ * 	Root committed to by a tree of `count` leaves with top node `top`
+ */
+static void merkle_commit(bytestream_t root, bytestream_t const top, size_t count, size_t len) {
+	byte_t buf[8];
+	for (int k = 0; k < 8; k++)
+		buf[k] = (uint64_t) count >> (8 * k);
+
+	merkle_hash(root, MERKLE_ROOT, bs_view_b(buf, sizeof(buf)), bs_view(top), len);
+}
+
+void merkle_root(bytestream_t root, merkle_t const tree) {
+	merkle_commit(root, tree->_nodes[tree->_nnodes - 1], tree->_count, tree->_len);
+}
+
+size_t merkle_path_len(size_t index, size_t count) {
+	size_t len = 0;
+	for (size_t n = count; n > 1; n = merkle_up(n), index /= 2)
+		len += (index ^ 1) < n;
+	return len;
+}
+
+void merkle_path(bytestream_t *path, merkle_t const tree, size_t index) {
+	bytestream_t *level = tree->_nodes;
+	for (size_t n = tree->_count; n > 1; level += n, n = merkle_up(n), index /= 2)
+		if ((index ^ 1) < n)
+			bs_set(*path++, level[index ^ 1]);
+}
+
+void merkle_root_path(bytestream_t root, bytestream_t const digest, size_t index, size_t count, bs_view_t *path, size_t len) {
+	bytestream_t node;
+	bs_init_size(node, len / 8);
+
+	merkle_hash(node, MERKLE_LEAF, bs_view(digest), bs_view_b(NULL, 0), len);
+	for (size_t n = count; n > 1; n = merkle_up(n), index /= 2) {
+		if ((index ^ 1) >= n)
+			continue;
+		if (index % 2)
+			merkle_hash(node, MERKLE_NODE, *path++, bs_view(node), len);
+		else
+			merkle_hash(node, MERKLE_NODE, bs_view(node), *path++, len);
+	}
+
+	merkle_commit(root, node, count, len);
+	bs_clear(node);
+}
@@ -0,0 +1,413 @@
+#include "../include/mont.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MONT_SIMD
+#include <immintrin.h>
+#endif
+
+/* Force inlining, so sizes given as constants specialize the code */
+#ifdef __GNUC__
+#define MONT_INLINE static inline __attribute__((always_inline))
+#else
+#define MONT_INLINE static inline
+#endif
+
+/* Functions using AVX-512 IFMA */
+#define MONT_IFMA __attribute__((target("avx512f,avx512ifma")))
+
+/**
+ * 	Digits of the IFMA representation
+ *
+ * 	MONT_DIGITBITS: Bits per digit, in 64-bit words
+ * 	MONT_DIGITS: Digits for a modulo of n limbs, so that R = 2 ^ (52 * digits) > 4m
+ * 	MONT_VECS: 512-bit vectors holding those digits
+ */
+#define MONT_DIGITBITS 52
+#define MONT_DIGITMASK (((mp_limb_t) 1 << MONT_DIGITBITS) - 1)
+#define MONT_DIGITS(n) ((64 * (n) + 2 + MONT_DIGITBITS - 1) / MONT_DIGITBITS)
+#define MONT_VECS(n) ((MONT_DIGITS(n) + 7) / 8)
+
+/* Product of two numbers in the representation used, rp = ap * bp / R mod m */
+typedef void (*mont_mul_fn)(struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp);
+
+#ifdef MONT_SIMD
+/* Double limb type */
+__extension__ typedef unsigned __int128 dlimb_t;
+#endif
+
+/**
+ * 	Copy a GMP integer into `n` limbs, zero padded
+ */
+static void mont_set_mpz(mp_limb_t *rp, mpz_t const op, mp_size_t n) {
+	mp_size_t size = mpz_size(op);
+	memcpy(rp, mpz_limbs_read(op), size * sizeof(mp_limb_t));
+	memset(rp + size, 0, (n - size) * sizeof(mp_limb_t));
+}
+
+/**
+ * 	Set a GMP integer from `n` limbs
+ */
+static void mpz_set_mont(mpz_t rop, const mp_limb_t *op, mp_size_t n) {
+	memcpy(mpz_limbs_write(rop, n), op, n * sizeof(mp_limb_t));
+	mpz_limbs_finish(rop, n);
+}
+
+/**
+ * 	Split `n` limbs into `w` digits of MONT_DIGITBITS bits
+ */
+MONT_INLINE void mont_to_digits(mp_limb_t *rp, const mp_limb_t *xp, mp_size_t n, mp_size_t w) {
+	for (mp_size_t j = 0; j < w; j++) {
+		mp_size_t limb = j * MONT_DIGITBITS / 64, shift = j * MONT_DIGITBITS % 64;
+		mp_limb_t digit = limb < n ? xp[limb] >> shift : 0;
+		if (shift > 64 - MONT_DIGITBITS && limb + 1 < n)
+			digit |= xp[limb + 1] << (64 - shift);
+		rp[j] = digit & MONT_DIGITMASK;
+	}
+}
+
+/**
+ * 	Join `w` digits of MONT_DIGITBITS bits into `n` limbs, dropping higher bits
+ */
+MONT_INLINE void mont_from_digits(mp_limb_t *rp, const mp_limb_t *xp, mp_size_t n, mp_size_t w) {
+	memset(rp, 0, n * sizeof(mp_limb_t));
+	for (mp_size_t j = 0; j < w; j++) {
+		mp_size_t limb = j * MONT_DIGITBITS / 64, shift = j * MONT_DIGITBITS % 64;
+		if (limb < n)
+			rp[limb] |= xp[j] << shift;
+		if (shift > 64 - MONT_DIGITBITS && limb + 1 < n)
+			rp[limb + 1] |= xp[j] >> (64 - shift);
+	}
+}
+
+/**
+ * 	Montgomery reduction of `2n` limbs, rp = tp / R mod m
+ * 	Row carries are kept in the limbs each row clears and added at once.
+ * 	The final subtraction is done with a conditional swap, so timing does
+ * 	not depend on the operands
+ */
+MONT_INLINE void mont_redc_n(mp_size_t n, struct _mont_t *m, mp_limb_t *rp, mp_limb_t *tp) {
+	const mp_limb_t *mp = m->_mod;
+	mp_limb_t d[MONT_MAXLIMBS];
+
+	for (mp_size_t i = 0; i < n; i++)
+		tp[i] = mpn_addmul_1(tp + i, mp, n, tp[i] * m->_minv);
+	mp_limb_t cy = mpn_add_n(rp, tp + n, tp, n);
+
+	/* rp < 2m, keep rp - m unless it borrows */
+	mp_limb_t borrow = mpn_sub_n(d, rp, mp, n);
+	mpn_cnd_swap(cy | (borrow ^ 1), rp, d, n);
+}
+
+/**
+ * 	Montgomery product of `n` limbs, rp = ap * bp / R mod m with R = 2 ^ (64 * n)
+ * 	Operands and result are less than m
+ */
+MONT_INLINE void mont_mul_n(mp_size_t n, struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) {
+	mp_limb_t t[2 * MONT_MAXLIMBS];
+	if (ap == bp)
+		mpn_sec_sqr(t, ap, n, m->_scratch);
+	else
+		mpn_sec_mul(t, ap, n, bp, n, m->_scratch);
+	mont_redc_n(n, m, rp, t);
+}
+
+#ifdef MONT_SIMD
+/**
+ * 	Almost Montgomery product of a modulo of `n` limbs in digits of
+ * 	MONT_DIGITBITS bits, rp = ap * bp / R mod m with R = 2 ^ (52 * digits)
+ * 	Operands and result are less than 2m
+ *
+ * 	Digit j of the accumulator is lane j of the vectors. Each step adds
+ * 	the low halves of a * b[i] and y * m, shifts down one digit and adds
+ * 	the high halves. The lowest digit, that sets y, is tracked exactly in
+ * 	a scalar from the next digit of the vectors, so the vectors never wait
+ * 	on their own carries
+ */
+MONT_INLINE MONT_IFMA void mont_amm_n(mp_size_t n, struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) {
+	const int vecs = MONT_VECS(n), digits = MONT_DIGITS(n);
+	const mp_limb_t *mp = m->_mod, k0 = m->_minv & MONT_DIGITMASK;
+	__m512i a[MONT_VECS(MONT_MAXLIMBS)], mv[MONT_VECS(MONT_MAXLIMBS)], acc[MONT_VECS(MONT_MAXLIMBS)];
+
+#pragma GCC unroll 16
+	for (int k = 0; k < vecs; k++) {
+		a[k] = _mm512_loadu_si512(ap + 8 * k);
+		mv[k] = _mm512_loadu_si512(mp + 8 * k);
+		acc[k] = _mm512_setzero_si512();
+	}
+
+	mp_limb_t acc0 = 0;
+	for (int i = 0; i < digits; i++) {
+		mp_limb_t bi = bp[i];
+
+		/* y such that acc + a * b[i] + y * m = 0 mod 2 ^ 52 */
+		dlimb_t ab = (dlimb_t) ap[0] * bi;
+		acc0 += (mp_limb_t) ab & MONT_DIGITMASK;
+		mp_limb_t y = acc0 * k0 & MONT_DIGITMASK;
+		dlimb_t ym = (dlimb_t) mp[0] * y;
+		acc0 += (mp_limb_t) ym & MONT_DIGITMASK;
+
+		/* Next lowest digit */
+		acc0 = (acc0 >> MONT_DIGITBITS)
+			+ _mm_extract_epi64(_mm512_castsi512_si128(acc[0]), 1)
+			+ (ap[1] * bi & MONT_DIGITMASK) + (mp[1] * y & MONT_DIGITMASK)
+			+ (mp_limb_t) (ab >> MONT_DIGITBITS) + (mp_limb_t) (ym >> MONT_DIGITBITS);
+
+		__m512i b = _mm512_set1_epi64(bi), vy = _mm512_set1_epi64(y);
+#pragma GCC unroll 16
+		for (int k = 0; k < vecs; k++) {
+			acc[k] = _mm512_madd52lo_epu64(acc[k], a[k], b);
+			acc[k] = _mm512_madd52lo_epu64(acc[k], mv[k], vy);
+		}
+#pragma GCC unroll 16
+		for (int k = 0; k < vecs - 1; k++)
+			acc[k] = _mm512_alignr_epi64(acc[k + 1], acc[k], 1);
+		acc[vecs - 1] = _mm512_alignr_epi64(_mm512_setzero_si512(), acc[vecs - 1], 1);
+#pragma GCC unroll 16
+		for (int k = 0; k < vecs; k++) {
+			acc[k] = _mm512_madd52hi_epu64(acc[k], a[k], b);
+			acc[k] = _mm512_madd52hi_epu64(acc[k], mv[k], vy);
+		}
+	}
+
+	/* Back to digits of MONT_DIGITBITS bits, the vectors lack the carries of digit 0 */
+	mp_limb_t t[8 * MONT_VECS(MONT_MAXLIMBS)], carry = 0;
+#pragma GCC unroll 16
+	for (int k = 0; k < vecs; k++)
+		_mm512_storeu_si512(t + 8 * k, acc[k]);
+	t[0] = acc0;
+	for (int j = 0; j < 8 * vecs; j++) {
+		mp_limb_t digit = t[j] + carry;
+		rp[j] = digit & MONT_DIGITMASK;
+		carry = digit >> MONT_DIGITBITS;
+	}
+}
+#endif
+
+/**
+ * 	Copy table entry `digit` of `w` words into `rp` reading every entry
+ */
+MONT_INLINE void mont_select_n(mp_size_t w, mp_limb_t *rp, const mp_limb_t *table, mp_limb_t digit) {
+	memset(rp, 0, w * sizeof(mp_limb_t));
+	for (mp_limb_t i = 0; i < 1 << MONT_WINDOW; i++) {
+		mp_limb_t diff = i ^ digit, mask = ((diff | -diff) >> 63) - 1;
+		for (mp_size_t j = 0; j < w; j++)
+			rp[j] |= table[i * w + j] & mask;
+	}
+}
+
+/**
+ * 	Exponentiation of numbers of `w` words in the representation of `mul`,
+ * 	leaving xp ^ exp mod m in `m->_y`
+ *
+ * 	Without `exp`, uses the recoded exponent with a fixed window: every
+ * 	digit costs MONT_WINDOW squarings and one multiplication by a table
+ * 	entry, including zero digits. With `exp`, squares and multiplies by the
+ * 	base on set bits
+ */
+MONT_INLINE void mont_exp_n(mp_size_t w, struct _mont_t *m, const mp_limb_t *xp, mpz_srcptr exp, mont_mul_fn mul) {
+	mp_limb_t *table = m->_table, *acc = m->_y, *sel = m->_t;
+
+	if (exp) {
+		/* x = base * R, left-to-right square and multiply, R for a zero exponent */
+		mul(m, m->_x, xp, m->_r2);
+		if (mpz_sgn(exp))
+			memcpy(acc, m->_x, w * sizeof(mp_limb_t));
+		else
+			mul(m, acc, m->_r2, m->_one);
+		for (mp_bitcnt_t i = mpz_sizeinbase(exp, 2) - 1; i-- > 0;) {
+			mul(m, acc, acc, acc);
+			if (mpz_tstbit(exp, i))
+				mul(m, acc, acc, m->_x);
+		}
+	} else {
+		/* table[i] = x ^ i * R */
+		mul(m, table, m->_r2, m->_one);
+		mul(m, table + w, xp, m->_r2);
+		for (int i = 2; i < 1 << MONT_WINDOW; i++)
+			mul(m, table + i * w, table + (i - 1) * w, table + w);
+
+		mont_select_n(w, acc, table, m->_digits[0]);
+		for (size_t k = 1; k < m->_ndigits; k++) {
+			for (int s = 0; s < MONT_WINDOW; s++)
+				mul(m, acc, acc, acc);
+			mont_select_n(w, sel, table, m->_digits[k]);
+			mul(m, acc, acc, sel);
+		}
+	}
+
+	/* Out of Montgomery form */
+	mul(m, acc, acc, m->_one);
+}
+
+/**
+ * 	Exponentiation of `n` limbs in limbs
+ */
+MONT_INLINE void mont_powm_n(mp_size_t n, struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *xp, mpz_srcptr exp, mont_mul_fn mul) {
+	mont_exp_n(n, m, xp, exp, mul);
+	memcpy(rp, m->_y, n * sizeof(mp_limb_t));
+}
+
+#ifdef MONT_SIMD
+/**
+ * 	Exponentiation of `n` limbs in digits, with the final subtraction of
+ * 	the almost Montgomery product done with a conditional swap
+ */
+MONT_INLINE MONT_IFMA void mont_powm_ifma_n(mp_size_t n, struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *xp, mpz_srcptr exp, mont_mul_fn mul) {
+	mp_limb_t d[MONT_MAXLIMBS];
+	mont_to_digits(m->_x, xp, n, 8 * MONT_VECS(n));
+	mont_exp_n(8 * MONT_VECS(n), m, m->_x, exp, mul);
+	mont_from_digits(rp, m->_y, n, 8 * MONT_VECS(n));
+
+	mp_limb_t borrow = mpn_sub_n(d, rp, mpz_limbs_read(m->_m), n);
+	mpn_cnd_swap(borrow ^ 1, rp, d, n);
+}
+#endif
+
+/* Functions specialized for a modulo of N limbs */
+#define MONT_DEFINE(N) \
+static void mont_mul_##N(struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) { \
+	mont_mul_n(N, m, rp, ap, bp); \
+} \
+static void mont_powm_##N(struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *xp, mpz_srcptr exp) { \
+	mont_powm_n(N, m, rp, xp, exp, mont_mul_##N); \
+}
+MONT_SIZES(MONT_DEFINE)
+
+/* Functions for any other size */
+static void mont_mul_any(struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) {
+	mont_mul_n(m->_n, m, rp, ap, bp);
+}
+static void mont_powm_any(struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *xp, mpz_srcptr exp) {
+	mont_powm_n(m->_n, m, rp, xp, exp, mont_mul_any);
+}
+
+#ifdef MONT_SIMD
+/* IFMA functions specialized for a modulo of N limbs */
+#define MONT_DEFINE_IFMA(N) \
+static MONT_IFMA void mont_amm_##N(struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) { \
+	mont_amm_n(N, m, rp, ap, bp); \
+} \
+static MONT_IFMA void mont_powm_ifma_##N(struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *xp, mpz_srcptr exp) { \
+	mont_powm_ifma_n(N, m, rp, xp, exp, mont_amm_##N); \
+}
+MONT_SIZES(MONT_DEFINE_IFMA)
+
+/* IFMA functions for any other size */
+static MONT_IFMA void mont_amm_any(struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) {
+	mont_amm_n(m->_n, m, rp, ap, bp);
+}
+static MONT_IFMA void mont_powm_ifma_any(struct _mont_t *m, mp_limb_t *rp, const mp_limb_t *xp, mpz_srcptr exp) {
+	mont_powm_ifma_n(m->_n, m, rp, xp, exp, mont_amm_any);
+}
+
+/* The IFMA function if the CPU has IFMA, else the limb one */
+#define MONT_PICK(f_ifma, f) (ifma ? f_ifma : f)
+#else
+#define MONT_PICK(f_ifma, f) (f)
+#endif
+
+/**
+ * 	Set `m->_w` words of the representation used from a GMP integer less than m
+ */
+static void mont_import(struct _mont_t *m, mp_limb_t *rp, mpz_t const op) {
+	mp_limb_t xp[MONT_MAXLIMBS];
+	mont_set_mpz(xp, op, m->_n);
+	if (m->_w == m->_n)
+		memcpy(rp, xp, m->_n * sizeof(mp_limb_t));
+	else
+		mont_to_digits(rp, xp, m->_n, m->_w);
+}
+
+void mont_init(mont_t m, mpz_t const mod, mpz_t const exp) {
+	mp_size_t n = mpz_size(mod);
+	if (n > MONT_MAXLIMBS) {
+		fprintf(stderr, "Modulo too long\n");
+		exit(EXIT_FAILURE);
+	}
+#ifdef MONT_SIMD
+	__builtin_cpu_init();
+	int ifma = __builtin_cpu_supports("avx512ifma");
+#else
+	int ifma = 0;
+#endif
+	m->_n = n;
+	m->_w = ifma ? 8 * MONT_VECS(n) : n;
+
+	/* Pick the code for this size */
+	switch (n) {
+#define MONT_CASE(N) \
+		case N: \
+			m->_powm = MONT_PICK(mont_powm_ifma_##N, mont_powm_##N); \
+			break;
+		MONT_SIZES(MONT_CASE)
+		default:
+			m->_powm = MONT_PICK(mont_powm_ifma_any, mont_powm_any);
+	}
+
+	/* All words in one block */
+	mp_size_t w = m->_w, itch = mpn_sec_mul_itch(n, n);
+	if (mpn_sec_sqr_itch(n) > itch)
+		itch = mpn_sec_sqr_itch(n);
+	m->_mod = malloc(sizeof(mp_limb_t) * (w * (6 + (1 << MONT_WINDOW)) + itch));
+	m->_r2 = m->_mod + w;
+	m->_one = m->_r2 + w;
+	m->_x = m->_one + w;
+	m->_y = m->_x + w;
+	m->_t = m->_y + w;
+	m->_table = m->_t + w;
+	m->_scratch = m->_table + (w << MONT_WINDOW);
+	mpz_init_set(m->_m, mod);
+	mont_import(m, m->_mod, mod);
+	memset(m->_one, 0, w * sizeof(mp_limb_t));
+	m->_one[0] = 1;
+	m->_xn = NULL;
+
+	/* -m ^ -1 mod 2 ^ 64 by Newton iteration, each step doubles the correct bits */
+	mp_limb_t inv = mpz_getlimbn(mod, 0);
+	for (int i = 0; i < 5; i++)
+		inv *= 2 - mpz_getlimbn(mod, 0) * inv;
+	m->_minv = -inv;
+
+	/* R ^ 2 mod m */
+	mp_bitcnt_t rbits = ifma ? MONT_DIGITBITS * MONT_DIGITS(n) : 64 * n;
+	mpz_init2(m->_base, 2 * rbits + 1);
+	mpz_setbit(m->_base, 2 * rbits);
+	mpz_mod(m->_base, m->_base, mod);
+	mont_import(m, m->_r2, m->_base);
+
+	/* Recode the exponent, most significant digit first */
+	m->_ndigits = (mpz_sizeinbase(exp, 2) + MONT_WINDOW - 1) / MONT_WINDOW;
+	m->_digits = malloc(m->_ndigits);
+	for (size_t k = 0; k < m->_ndigits; k++) {
+		size_t low = (m->_ndigits - 1 - k) * MONT_WINDOW;
+		m->_digits[k] = 0;
+		for (int b = MONT_WINDOW - 1; b >= 0; b--)
+			m->_digits[k] = m->_digits[k] << 1 | mpz_tstbit(exp, low + b);
+	}
+}
+
+void mont_clear(mont_t m) {
+	free(m->_mod);
+	free(m->_digits);
+	free(m->_xn);
+	mpz_clears(m->_m, m->_base, NULL);
+}
+
+void mont_powm(mpz_t rop, mpz_t const base, mpz_t const exp, mont_t m) {
+	mp_limb_t xp[MONT_MAXLIMBS], rp[MONT_MAXLIMBS];
+	mpz_mod(m->_base, base, m->_m);
+	mont_set_mpz(xp, m->_base, m->_n);
+	m->_powm(m, rp, xp, exp);
+	mpz_set_mont(rop, rp, m->_n);
+}
+
+void mont_powm_sec(mpz_t rop, mpz_t const base, mont_t m) {
+	mp_limb_t xp[MONT_MAXLIMBS], rp[MONT_MAXLIMBS];
+	mpz_mod(m->_base, base, m->_m);
+	mont_set_mpz(xp, m->_base, m->_n);
+	m->_powm(m, rp, xp, NULL);
+	mpz_set_mont(rop, rp, m->_n);
+}
@@ -0,0 +1,332 @@
+#include "../include/mont.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MONT_XN_SIMD
+#include <immintrin.h>
+#endif
+
+/**
+ * 	Multi-lane number layout
+ *
+ * 	A group of W numbers of the same modulo is split into digits of B bits
+ * 	and interleaved digit by digit: digit j of number k is stored at index
+ * 	j * W + k, so one vector load fetches digit j of every number in the
+ * 	group. Every number in a group is raised to the same exponent.
+ *
+ * 	MONT_XN_DIGITS: Digits of B bits for a modulo of n limbs, so that
+ * 	R = 2 ^ (B * digits) > 4m, rounded up to an even number
+ */
+#define MONT_XN_DIGITS(n, bits) (((64 * (n) + 2 + 2 * (bits) - 1) / (2 * (bits))) * 2)
+
+/* Almost Montgomery product of W interleaved numbers, rp = ap * bp / R mod m */
+typedef void (*amm_xn_t)(mp_size_t digits, const mp_limb_t *mp, mp_limb_t k0, mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp);
+
+#ifdef MONT_XN_SIMD
+#define AVX2_LD(p, j) _mm256_loadu_si256((__m256i *) ((p) + (j) * 4))
+#define AVX2_ST(p, j, v) _mm256_storeu_si256((__m256i *) ((p) + (j) * 4), v)
+
+/**
+ * 	Almost Montgomery product of 4 interleaved numbers in digits of 26 bits
+ * 	Digit products are exact in 64 bits and the accumulator digits are
+ * 	only normalized at the end. Digits i and i + 1 of b are done in the same
+ * 	pass over the accumulator, so its digits are loaded and stored half as
+ * 	often
+ */
+__attribute__((target("avx2")))
+static void mont_amm_x4(mp_size_t digits, const mp_limb_t *mp, mp_limb_t k0, mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) {
+	__m256i acc[2 * MONT_XN_DIGITS(MONT_MAXLIMBS, 26)];
+	const __m256i mask = _mm256_set1_epi64x((1 << 26) - 1), vk0 = _mm256_set1_epi64x(k0);
+	const __m256i a0 = AVX2_LD(ap, 0), m0 = _mm256_set1_epi64x(mp[0]);
+
+	for (mp_size_t j = 0; j < 2 * digits; j++)
+		acc[j] = _mm256_setzero_si256();
+
+	for (mp_size_t i = 0; i < digits; i += 2) {
+		__m256i *t = acc + i, b0 = AVX2_LD(bp, i), b1 = AVX2_LD(bp, i + 1);
+
+		/* y0 and y1 such that t + a * b[i] + y0 * m = 0 mod 2 ^ 26 and so on */
+		__m256i t0 = _mm256_add_epi64(t[0], _mm256_mul_epu32(a0, b0));
+		__m256i y0 = _mm256_and_si256(_mm256_mul_epu32(_mm256_and_si256(t0, mask), vk0), mask);
+		t0 = _mm256_add_epi64(t0, _mm256_mul_epu32(m0, y0));
+
+		__m256i aj = AVX2_LD(ap, 1), mj = _mm256_set1_epi64x(mp[1]);
+		__m256i t1 = _mm256_add_epi64(_mm256_add_epi64(t[1], _mm256_srli_epi64(t0, 26)), _mm256_add_epi64(
+			_mm256_add_epi64(_mm256_mul_epu32(aj, b0), _mm256_mul_epu32(mj, y0)),
+			_mm256_mul_epu32(a0, b1)));
+		__m256i y1 = _mm256_and_si256(_mm256_mul_epu32(_mm256_and_si256(t1, mask), vk0), mask);
+		t1 = _mm256_add_epi64(t1, _mm256_mul_epu32(m0, y1));
+		t[2] = _mm256_add_epi64(t[2], _mm256_srli_epi64(t1, 26));
+
+#pragma GCC unroll 8
+		for (mp_size_t j = 2; j < digits; j++) {
+			__m256i ak = aj, mk = mj;
+			aj = AVX2_LD(ap, j);
+			mj = _mm256_set1_epi64x(mp[j]);
+			t[j] = _mm256_add_epi64(t[j], _mm256_add_epi64(
+				_mm256_add_epi64(_mm256_mul_epu32(aj, b0), _mm256_mul_epu32(mj, y0)),
+				_mm256_add_epi64(_mm256_mul_epu32(ak, b1), _mm256_mul_epu32(mk, y1))));
+		}
+		t[digits] = _mm256_add_epi64(t[digits], _mm256_add_epi64(_mm256_mul_epu32(aj, b1), _mm256_mul_epu32(mj, y1)));
+	}
+
+	__m256i carry = _mm256_setzero_si256();
+	for (mp_size_t j = 0; j < digits; j++) {
+		__m256i digit = _mm256_add_epi64(acc[digits + j], carry);
+		AVX2_ST(rp, j, _mm256_and_si256(digit, mask));
+		carry = _mm256_srli_epi64(digit, 26);
+	}
+}
+
+#define AVX512_LD(p, j) _mm512_loadu_si512((p) + (j) * 8)
+#define AVX512_ST(p, j, v) _mm512_storeu_si512((p) + (j) * 8, v)
+
+/**
+ * 	Almost Montgomery product of 8 interleaved numbers in digits of 52 bits
+ * 	IFMA gives the low and high 52 bits of digit products, so every step
+ * 	adds the low halves of a * b[i] and y * m to their digits and the high
+ * 	halves to the next ones
+ */
+__attribute__((target("avx512f,avx512ifma")))
+static void mont_amm_x8(mp_size_t digits, const mp_limb_t *mp, mp_limb_t k0, mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) {
+	__m512i acc[2 * MONT_XN_DIGITS(MONT_MAXLIMBS, 52)];
+	const __m512i zero = _mm512_setzero_si512(), mask = _mm512_set1_epi64((1ULL << 52) - 1), vk0 = _mm512_set1_epi64(k0);
+
+	for (mp_size_t j = 0; j < 2 * digits; j++)
+		acc[j] = zero;
+
+	for (mp_size_t i = 0; i < digits; i++) {
+		__m512i *t = acc + i, b = AVX512_LD(bp, i), a0 = AVX512_LD(ap, 0), m0 = _mm512_set1_epi64(mp[0]);
+
+		/* y such that t + a * b[i] + y * m = 0 mod 2 ^ 52 */
+		t[0] = _mm512_madd52lo_epu64(t[0], a0, b);
+		__m512i y = _mm512_madd52lo_epu64(zero, t[0], vk0);
+		t[0] = _mm512_madd52lo_epu64(t[0], m0, y);
+
+		/* High halves go one digit up */
+		__m512i hi = _mm512_srli_epi64(t[0], 52);
+		hi = _mm512_madd52hi_epu64(_mm512_madd52hi_epu64(hi, a0, b), m0, y);
+#pragma GCC unroll 8
+		for (mp_size_t j = 1; j < digits; j++) {
+			__m512i aj = AVX512_LD(ap, j), mj = _mm512_set1_epi64(mp[j]);
+			t[j] = _mm512_madd52lo_epu64(_mm512_madd52lo_epu64(_mm512_add_epi64(t[j], hi), aj, b), mj, y);
+			hi = _mm512_madd52hi_epu64(_mm512_madd52hi_epu64(zero, aj, b), mj, y);
+		}
+		t[digits] = _mm512_add_epi64(t[digits], hi);
+	}
+
+	__m512i carry = zero;
+	for (mp_size_t j = 0; j < digits; j++) {
+		__m512i digit = _mm512_add_epi64(acc[digits + j], carry);
+		AVX512_ST(rp, j, _mm512_and_si512(digit, mask));
+		carry = _mm512_srli_epi64(digit, 52);
+	}
+}
+#endif
+
+/**
+ * 	Pick the widest kernel the CPU supports, with its digit size
+ */
+static amm_xn_t mont_xn_kernel(int *lanes, int *bits) {
+#ifdef MONT_XN_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512ifma")) {
+		*lanes = 8;
+		*bits = 52;
+		return mont_amm_x8;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		*lanes = 4;
+		*bits = 26;
+		return mont_amm_x4;
+	}
+#endif
+	*lanes = 1;
+	*bits = 64;
+	return NULL;
+}
+
+int mont_xn_lanes() {
+	int lanes, bits;
+	mont_xn_kernel(&lanes, &bits);
+	return lanes;
+}
+
+/**
+ * 	Split `n` limbs into digit j * lanes of `rp`, for j < digits
+ */
+static void mont_xn_split(mp_limb_t *rp, int lanes, int bits, mp_size_t digits, const mp_limb_t *xp, mp_size_t n) {
+	mp_limb_t mask = ((mp_limb_t) 1 << bits) - 1;
+	for (mp_size_t j = 0; j < digits; j++) {
+		mp_size_t limb = j * bits / 64, shift = j * bits % 64;
+		mp_limb_t digit = limb < n ? xp[limb] >> shift : 0;
+		if (shift > 64 - bits && limb + 1 < n)
+			digit |= xp[limb + 1] << (64 - shift);
+		rp[j * lanes] = digit & mask;
+	}
+}
+
+/**
+ * 	Join digit j * lanes of `xp`, for j < digits, into `n` limbs
+ */
+static void mont_xn_join(mp_limb_t *rp, mp_size_t n, const mp_limb_t *xp, int lanes, int bits, mp_size_t digits) {
+	memset(rp, 0, n * sizeof(mp_limb_t));
+	for (mp_size_t j = 0; j < digits; j++) {
+		mp_size_t limb = j * bits / 64, shift = j * bits % 64;
+		if (limb < n)
+			rp[limb] |= xp[j * lanes] << shift;
+		if (shift > 64 - bits && limb + 1 < n)
+			rp[limb + 1] |= xp[j * lanes] >> (64 - shift);
+	}
+}
+
+/**
+ * 	Limbs of a GMP integer less than m, zero padded to `n`
+ */
+static void mont_xn_limbs(mp_limb_t *rp, mpz_t const op, mp_size_t n) {
+	mp_size_t size = mpz_size(op);
+	memcpy(rp, mpz_limbs_read(op), size * sizeof(mp_limb_t));
+	memset(rp + size, 0, (n - size) * sizeof(mp_limb_t));
+}
+
+/**
+ * 	Multi-lane buffers of a Montgomery object, in words
+ * 	Modulo digits, then R ^ 2 mod m, 1, base, accumulator, selected entry
+ * 	and 2 ^ MONT_WINDOW table entries of `lanes * digits` words each
+ */
+static mp_limb_t *mont_xn_buffers(struct _mont_t *m, int lanes, int bits, mp_size_t digits) {
+	if (m->_xn)
+		return m->_xn;
+
+	mp_size_t n = m->_n, w = lanes * digits;
+	mp_limb_t xp[MONT_MAXLIMBS];
+	m->_xn = malloc(sizeof(mp_limb_t) * (digits + w * (5 + (1 << MONT_WINDOW))));
+	mp_limb_t *r2 = m->_xn + digits, *one = r2 + w;
+
+	mont_xn_limbs(xp, m->_m, n);
+	mont_xn_split(m->_xn, 1, bits, digits, xp, n);
+
+	/* R ^ 2 mod m and 1 in every lane */
+	mpz_t r;
+	mpz_init(r);
+	mpz_setbit(r, 2 * bits * digits);
+	mpz_mod(r, r, m->_m);
+	mont_xn_limbs(xp, r, n);
+	memset(one, 0, w * sizeof(mp_limb_t));
+	for (int k = 0; k < lanes; k++) {
+		mont_xn_split(r2 + k, lanes, bits, digits, xp, n);
+		one[k] = 1;
+	}
+	mpz_clear(r);
+
+	return m->_xn;
+}
+
+/**
+ * 	Exponentiation of a group of interleaved numbers, as in `mont_powm` and
+ * 	`mont_powm_sec` for one number, leaving the result in the accumulator
+ */
+static void mont_exp_xn(struct _mont_t *m, amm_xn_t amm, int lanes, int bits, mp_size_t digits, mpz_srcptr exp) {
+	mp_size_t w = lanes * digits;
+	mp_limb_t *mp = m->_xn, *r2 = mp + digits, *one = r2 + w, *x = one + w, *acc = x + w,
+		*sel = acc + w, *table = sel + w, k0 = m->_minv & (((mp_limb_t) 1 << bits) - 1);
+
+	if (exp) {
+		amm(digits, mp, k0, x, x, r2);
+		if (mpz_sgn(exp))
+			memcpy(acc, x, w * sizeof(mp_limb_t));
+		else
+			amm(digits, mp, k0, acc, r2, one);
+		for (mp_bitcnt_t i = mpz_sizeinbase(exp, 2) - 1; i-- > 0;) {
+			amm(digits, mp, k0, acc, acc, acc);
+			if (mpz_tstbit(exp, i))
+				amm(digits, mp, k0, acc, acc, x);
+		}
+	} else {
+		amm(digits, mp, k0, table, r2, one);
+		amm(digits, mp, k0, table + w, x, r2);
+		for (int i = 2; i < 1 << MONT_WINDOW; i++)
+			amm(digits, mp, k0, table + i * w, table + (i - 1) * w, table + w);
+
+		/* Every lane reads the same entry, still every entry is read */
+		for (size_t k = 0; k < m->_ndigits; k++) {
+			if (k)
+				for (int s = 0; s < MONT_WINDOW; s++)
+					amm(digits, mp, k0, acc, acc, acc);
+			memset(sel, 0, w * sizeof(mp_limb_t));
+			for (mp_limb_t i = 0; i < 1 << MONT_WINDOW; i++) {
+				mp_limb_t diff = i ^ m->_digits[k], mask = ((diff | -diff) >> 63) - 1;
+				for (mp_size_t j = 0; j < w; j++)
+					sel[j] |= table[i * w + j] & mask;
+			}
+			if (k)
+				amm(digits, mp, k0, acc, acc, sel);
+			else
+				memcpy(acc, sel, w * sizeof(mp_limb_t));
+		}
+	}
+
+	/* Out of Montgomery form, less than or equal to m */
+	amm(digits, mp, k0, acc, acc, one);
+}
+
+/**
+ * 	Exponentiation of many bases, by `exp` or by the recoded exponent if NULL
+ */
+static void mont_powm_xn_any(mpz_t *rops, mpz_t *bases, size_t count, mpz_srcptr exp, struct _mont_t *m) {
+	int lanes, bits;
+	amm_xn_t amm = mont_xn_kernel(&lanes, &bits);
+
+	/**
+	 * A group costs about as much as `lanes` / 2 single exponentiations,
+	 * so a last group filling less than half of the lanes goes one by one,
+	 * as do all bases without SIMD
+	 */
+	size_t grouped = count - count % lanes;
+	if (count % lanes >= (size_t) (lanes + 1) / 2)
+		grouped = count;
+	if (!amm)
+		grouped = 0;
+	for (size_t i = grouped; i < count; i++) {
+		if (exp)
+			mont_powm(rops[i], bases[i], exp, m);
+		else
+			mont_powm_sec(rops[i], bases[i], m);
+	}
+	if (!grouped)
+		return;
+
+	mp_size_t n = m->_n, digits = MONT_XN_DIGITS(n, bits), w = lanes * digits;
+	mp_limb_t xp[MONT_MAXLIMBS], d[MONT_MAXLIMBS];
+	mp_limb_t *x = mont_xn_buffers(m, lanes, bits, digits) + digits + 2 * w, *acc = x + w;
+
+	for (size_t g = 0; g < grouped; g += lanes) {
+		for (int k = 0; k < lanes; k++) {
+			if (g + k < count) {
+				mpz_mod(m->_base, bases[g + k], m->_m);
+				mont_xn_limbs(xp, m->_base, n);
+			} else
+				memset(xp, 0, n * sizeof(mp_limb_t));
+			mont_xn_split(x + k, lanes, bits, digits, xp, n);
+		}
+
+		mont_exp_xn(m, amm, lanes, bits, digits, exp);
+
+		for (int k = 0; k < lanes && g + k < count; k++) {
+			mont_xn_join(xp, n, acc + k, lanes, bits, digits);
+			mp_limb_t borrow = mpn_sub_n(d, xp, mpz_limbs_read(m->_m), n);
+			mpn_cnd_swap(borrow ^ 1, xp, d, n);
+			memcpy(mpz_limbs_write(rops[g + k], n), xp, n * sizeof(mp_limb_t));
+			mpz_limbs_finish(rops[g + k], n);
+		}
+	}
+}
+
+void mont_powm_xn(mpz_t *rops, mpz_t *bases, size_t count, mpz_t const exp, mont_t m) {
+	mont_powm_xn_any(rops, bases, count, exp, m);
+}
+
+void mont_powm_sec_xn(mpz_t *rops, mpz_t *bases, size_t count, mont_t m) {
+	mont_powm_xn_any(rops, bases, count, NULL, m);
+}
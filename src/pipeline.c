@@ -0,0 +1,291 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/pipeline.h"
+#include "../include/rsa.h"
+#include "../include/sha3.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Slot states */
+#define PIPELINE_FREE 0
+#define PIPELINE_READING 1
+#define PIPELINE_FILLED 2
+#define PIPELINE_HASHING 3
+
+/**
+ * 	Hashing state of a file being read
+ */
+typedef struct _pipeline_file_t {
+	sha3_ctx_t ctx; /* SHA3 state */
+	size_t next; /* Next chunk to absorb */
+	int busy; /* Whether a hasher is absorbing a chunk */
+	int failed; /* Whether the file could not be read */
+	bytestream_t digest; /* Digest, once the last chunk is absorbed */
+} pipeline_file_t;
+
+/**
+ * 	Slot of the ring, holding chunk `seq` of file `item`
+ */
+typedef struct _pipeline_slot_t {
+	byte_t *data; /* PIPELINE_SLOTSIZE bytes */
+	size_t len; /* Bytes read */
+	size_t item; /* File */
+	size_t seq; /* Chunk of the file */
+	int last; /* Whether it is the last chunk of the file */
+	int state; /* Free, being read, filled or being hashed */
+	size_t order; /* When it was filled, older slots are hashed first */
+} pipeline_slot_t;
+
+/**
+ * 	Shared state of a run
+ */
+typedef struct _pipeline_t {
+	char **paths; /* Files */
+	size_t count; /* Number of files */
+	pipeline_file_t **files; /* Hashing state of every file being read */
+	pipeline_slot_t *slots; /* Ring */
+	int nslots; /* Number of slots */
+	size_t nextfile; /* Next file to read */
+	size_t filled; /* Slots filled so far */
+	size_t *hashed; /* Files hashed, in order */
+	size_t nhashed; /* Number of files in `hashed` */
+	double busy[PIPELINE_STAGES]; /* Seconds every stage spent working */
+	double blocked; /* Seconds readers waited for a free slot */
+	pthread_mutex_t lock; /* Guards all of the above but slot data */
+	pthread_cond_t freed; /* A slot was freed */
+	pthread_cond_t ready; /* A slot may have become ready to hash */
+	pthread_cond_t done; /* A file was hashed */
+} pipeline_t;
+
+/* Seconds elapsed since `start` */
+static double pipeline_elapsed(struct timespec *start) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+/**
+ * 	Read files chunk by chunk into free slots
+ */
+static void *pipeline_read(void *arg) {
+	pipeline_t *pipe = arg;
+	double busy = 0, blocked = 0;
+	struct timespec start;
+
+	pthread_mutex_lock(&pipe->lock);
+	while (pipe->nextfile < pipe->count) {
+		size_t item = pipe->nextfile++;
+		pthread_mutex_unlock(&pipe->lock);
+
+		/**
+		 * A file that cannot be opened goes through as one empty chunk,
+		 * one that fails to read ends with the chunk that failed
+		 */
+		FILE *src = fopen(pipe->paths[item], "rb");
+		if (!src)
+			fprintf(stderr, "Could not open \"%s\" for reading\n", pipe->paths[item]);
+		pipeline_file_t *file = malloc(sizeof(pipeline_file_t));
+		shake256_init(file->ctx, BITLEN);
+		file->next = 0;
+		file->busy = 0;
+		file->failed = !src;
+		bs_init_size(file->digest, BITLEN / 8);
+
+		int last = 0;
+		pthread_mutex_lock(&pipe->lock);
+		pipe->files[item] = file;
+		pthread_mutex_unlock(&pipe->lock);
+
+		for (size_t seq = 0; !last; seq++) {
+			/* Wait for a free slot */
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			pthread_mutex_lock(&pipe->lock);
+			pipeline_slot_t *slot = NULL;
+			while (!slot) {
+				for (int i = 0; i < pipe->nslots && !slot; i++)
+					if (pipe->slots[i].state == PIPELINE_FREE)
+						slot = &pipe->slots[i];
+				if (!slot)
+					pthread_cond_wait(&pipe->freed, &pipe->lock);
+			}
+			slot->state = PIPELINE_READING;
+			pthread_mutex_unlock(&pipe->lock);
+			blocked += pipeline_elapsed(&start);
+
+			/* Fill it */
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			slot->len = src ? fread(slot->data, 1, PIPELINE_SLOTSIZE, src) : 0;
+			last = slot->len < PIPELINE_SLOTSIZE;
+			if (last && src && ferror(src)) {
+				fprintf(stderr, "Could not read \"%s\"\n", pipe->paths[item]);
+				file->failed = 1;
+			}
+			busy += pipeline_elapsed(&start);
+
+			pthread_mutex_lock(&pipe->lock);
+			slot->item = item;
+			slot->seq = seq;
+			slot->last = last;
+			slot->order = pipe->filled++;
+			slot->state = PIPELINE_FILLED;
+			pthread_cond_broadcast(&pipe->ready);
+			pthread_mutex_unlock(&pipe->lock);
+		}
+		if (src)
+			fclose(src);
+
+		pthread_mutex_lock(&pipe->lock);
+	}
+
+	pipe->busy[0] += busy;
+	pipe->blocked += blocked;
+	pthread_mutex_unlock(&pipe->lock);
+	return NULL;
+}
+
+/**
+ * 	Oldest filled slot holding the next chunk of a file no one is hashing
+ */
+static pipeline_slot_t *pipeline_next_slot(pipeline_t *pipe) {
+	pipeline_slot_t *next = NULL;
+	for (int i = 0; i < pipe->nslots; i++) {
+		pipeline_slot_t *slot = &pipe->slots[i];
+		if (slot->state != PIPELINE_FILLED)
+			continue;
+		pipeline_file_t *file = pipe->files[slot->item];
+		if (!file->busy && file->next == slot->seq && (!next || slot->order < next->order))
+			next = slot;
+	}
+	return next;
+}
+
+/**
+ * 	Absorb filled slots until every file is hashed
+ */
+static void *pipeline_hash(void *arg) {
+	pipeline_t *pipe = arg;
+	double busy = 0;
+	struct timespec start;
+
+	pthread_mutex_lock(&pipe->lock);
+	while (pipe->nhashed < pipe->count) {
+		pipeline_slot_t *slot = pipeline_next_slot(pipe);
+		if (!slot) {
+			pthread_cond_wait(&pipe->ready, &pipe->lock);
+			continue;
+		}
+		pipeline_file_t *file = pipe->files[slot->item];
+		slot->state = PIPELINE_HASHING;
+		file->busy = 1;
+		pthread_mutex_unlock(&pipe->lock);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		sha3_update(file->ctx, slot->data, slot->len);
+		if (slot->last)
+			sha3_final(file->digest, file->ctx);
+		busy += pipeline_elapsed(&start);
+
+		pthread_mutex_lock(&pipe->lock);
+		file->busy = 0;
+		file->next++;
+		slot->state = PIPELINE_FREE;
+		if (slot->last) {
+			pipe->hashed[pipe->nhashed++] = slot->item;
+			pthread_cond_signal(&pipe->done);
+		}
+		pthread_cond_broadcast(&pipe->freed);
+		pthread_cond_broadcast(&pipe->ready);
+	}
+
+	pipe->busy[1] += busy;
+	pthread_mutex_unlock(&pipe->lock);
+	return NULL;
+}
+
+void pipeline_run(pipeline_stats_t *stats, char **paths, size_t count, pipeline_fn fn, void *arg, int slots, int hashers) {
+	struct timespec begin, start;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	pipeline_t pipe = {paths, count, calloc(count, sizeof(pipeline_file_t *)), calloc(slots, sizeof(pipeline_slot_t)),
+		slots, 0, 0, malloc(count * sizeof(size_t)), 0};
+	for (int i = 0; i < slots; i++)
+		pipe.slots[i].data = malloc(PIPELINE_SLOTSIZE);
+	pthread_mutex_init(&pipe.lock, NULL);
+	pthread_cond_init(&pipe.freed, NULL);
+	pthread_cond_init(&pipe.ready, NULL);
+	pthread_cond_init(&pipe.done, NULL);
+
+	pthread_t tids[PIPELINE_READERS + hashers];
+	for (int i = 0; i < PIPELINE_READERS + hashers; i++)
+		if (pthread_create(&tids[i], NULL, i < PIPELINE_READERS ? pipeline_read : pipeline_hash, &pipe)) {
+			fprintf(stderr, "Could not create a thread\n");
+			exit(EXIT_FAILURE);
+		}
+
+	/* Final stage, in the order files are hashed */
+	double busy = 0;
+	for (size_t i = 0; i < count; i++) {
+		pthread_mutex_lock(&pipe.lock);
+		while (pipe.nhashed <= i)
+			pthread_cond_wait(&pipe.done, &pipe.lock);
+		size_t item = pipe.hashed[i];
+		pthread_mutex_unlock(&pipe.lock);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		fn(arg, item, pipe.files[item]->failed ? NULL : pipe.files[item]->digest);
+		busy += pipeline_elapsed(&start);
+
+		bs_clear(pipe.files[item]->digest);
+		free(pipe.files[item]);
+	}
+
+	for (int i = 0; i < PIPELINE_READERS + hashers; i++)
+		pthread_join(tids[i], NULL);
+
+	if (stats) {
+		stats->wall = pipeline_elapsed(&begin);
+		stats->slots = slots;
+		stats->threads[0] = PIPELINE_READERS;
+		stats->threads[1] = hashers;
+		stats->threads[2] = 1;
+		stats->busy[0] = pipe.busy[0];
+		stats->busy[1] = pipe.busy[1];
+		stats->busy[2] = busy;
+		stats->blocked = pipe.blocked;
+	}
+
+	/* Clear */
+	for (int i = 0; i < slots; i++)
+		free(pipe.slots[i].data);
+	free(pipe.slots);
+	free(pipe.files);
+	free(pipe.hashed);
+	pthread_mutex_destroy(&pipe.lock);
+	pthread_cond_destroy(&pipe.freed);
+	pthread_cond_destroy(&pipe.ready);
+	pthread_cond_destroy(&pipe.done);
+}
+
+/**
+ * 	Keep the digest of a file, exiting if it could not be read
+ */
+static void pipeline_keep(void *arg, size_t item, bytestream_t const digest) {
+	bytestream_t *digests = arg;
+	if (!digest)
+		exit(EXIT_FAILURE);
+	bs_set(digests[item], digest);
+}
+
+void pipeline_digests(pipeline_stats_t *stats, bytestream_t *digests, char **paths, size_t count, int slots, int hashers) {
+	pipeline_run(stats, paths, count, pipeline_keep, digests, slots, hashers);
+}
+
+void pipeline_print(FILE *file, pipeline_stats_t const *stats) {
+	static const char *names[PIPELINE_STAGES] = {"read", "hash", "final"};
+
+	fprintf(file, "%d slots of %d bytes, %.3f s\n", stats->slots, PIPELINE_SLOTSIZE, stats->wall);
+	for (int i = 0; i < PIPELINE_STAGES; i++)
+		fprintf(file, "%s: %d threads, %.1f%% busy\n", names[i], stats->threads[i],
+			100 * stats->busy[i] / (stats->wall * stats->threads[i]));
+	fprintf(file, "read: %.1f%% waiting for a free slot\n", 100 * stats->blocked / (stats->wall * stats->threads[0]));
+}
@@ -0,0 +1,222 @@
+#include "../include/pool.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * 	Shared state of a run
+ */
+typedef struct _pool_t {
+	pool_fn fn; /* Function run on every item */
+	void *arg; /* Its argument */
+	size_t count; /* Number of items */
+	size_t next; /* Next item not taken yet */
+	pthread_mutex_t lock; /* Guards `next` */
+} pool_t;
+
+/**
+ * 	Argument of a worker thread
+ */
+typedef struct _pool_worker_t {
+	pool_t *pool; /* Shared state */
+	int id; /* Worker number */
+} pool_worker_t;
+
+/**
+ * 	Run items until none is left
+ */
+static void *pool_work(void *arg) {
+	pool_worker_t *worker = arg;
+	pool_t *pool = worker->pool;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		size_t item = pool->next < pool->count ? pool->next++ : pool->count;
+		pthread_mutex_unlock(&pool->lock);
+		if (item == pool->count)
+			return NULL;
+
+		pool->fn(pool->arg, item, worker->id);
+	}
+}
+
+int pool_threads() {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? n : 1;
+}
+
+void pool_run(pool_fn fn, void *arg, size_t count, int threads) {
+	pool_t pool = {fn, arg, count, 0};
+	pthread_mutex_init(&pool.lock, NULL);
+
+	/* Workers 1 to threads - 1, then the calling thread as worker 0 */
+	pthread_t tids[threads];
+	pool_worker_t workers[threads];
+	for (int i = 0; i < threads; i++) {
+		workers[i].pool = &pool;
+		workers[i].id = i;
+		if (i && pthread_create(&tids[i], NULL, pool_work, &workers[i])) {
+			fprintf(stderr, "Could not create a thread\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	pool_work(&workers[0]);
+	for (int i = 1; i < threads; i++)
+		pthread_join(tids[i], NULL);
+
+	pthread_mutex_destroy(&pool.lock);
+}
+
+/**
+ * 	Deque of tasks of a worker, tasks `head` to `tail` - 1 of `tasks`
+ */
+typedef struct _pool_deque_t {
+	void **tasks; /* Array of `avail` tasks */
+	size_t head; /* Oldest task, taken by thieves */
+	size_t tail; /* One past the newest task, pushed and popped by the owner */
+	size_t avail; /* Size of `tasks` */
+	pthread_mutex_t lock; /* Guards the deque */
+} pool_deque_t;
+
+/**
+ * 	Shared state of a work-stealing run
+ */
+typedef struct _pool_steal_t {
+	pool_task_fn fn; /* Function run on every task */
+	void *arg; /* Its argument */
+	pool_deque_t *deques; /* Deque of every worker */
+	int threads; /* Number of workers */
+	size_t pending; /* Tasks pushed and not done yet */
+	size_t pushes; /* Tasks in the deques so far, to tell when one came */
+	pthread_mutex_t lock; /* Guards `pending` and `pushes` */
+	pthread_cond_t wake; /* Signaled on a push, broadcast when `pending` reaches 0 */
+} pool_steal_t;
+
+/**
+ * 	Argument of a work-stealing worker thread
+ */
+typedef struct _pool_thief_t {
+	pool_steal_t *pool; /* Shared state */
+	int id; /* Worker number */
+} pool_thief_t;
+
+void pool_push(pool_steal_t *pool, int worker, void *task) {
+	pthread_mutex_lock(&pool->lock);
+	pool->pending++;
+	pthread_mutex_unlock(&pool->lock);
+
+	pool_deque_t *deque = &pool->deques[worker];
+	pthread_mutex_lock(&deque->lock);
+	if (deque->tail == deque->avail) {
+		/* Reuse the room left by thieves, or grow */
+		if (deque->head > deque->avail / 2) {
+			memmove(deque->tasks, deque->tasks + deque->head, (deque->tail - deque->head) * sizeof(void *));
+			deque->tail -= deque->head;
+			deque->head = 0;
+		} else {
+			deque->avail = deque->avail ? 2 * deque->avail : 64;
+			deque->tasks = realloc(deque->tasks, deque->avail * sizeof(void *));
+		}
+	}
+	deque->tasks[deque->tail++] = task;
+	pthread_mutex_unlock(&deque->lock);
+
+	/* Wake an idle worker once the task can be taken */
+	pthread_mutex_lock(&pool->lock);
+	pool->pushes++;
+	pthread_cond_signal(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * 	Take the newest task of a deque if `own`, else the oldest one
+ *
+ * 	@return The task, NULL if the deque is empty
+ */
+static void *pool_take(pool_deque_t *deque, int own) {
+	void *task = NULL;
+	pthread_mutex_lock(&deque->lock);
+	if (deque->head < deque->tail)
+		task = own ? deque->tasks[--deque->tail] : deque->tasks[deque->head++];
+	pthread_mutex_unlock(&deque->lock);
+	return task;
+}
+
+/**
+ * 	Run own tasks, then stolen ones, until no task is pending
+ */
+static void *pool_steal_work(void *arg) {
+	pool_thief_t *thief = arg;
+	pool_steal_t *pool = thief->pool;
+
+	for (;;) {
+		/* Pushes seen before looking at the deques */
+		pthread_mutex_lock(&pool->lock);
+		size_t pushes = pool->pushes;
+		pthread_mutex_unlock(&pool->lock);
+
+		void *task = pool_take(&pool->deques[thief->id], 1);
+		for (int k = 1; !task && k < pool->threads; k++)
+			task = pool_take(&pool->deques[(thief->id + k) % pool->threads], 0);
+
+		if (task) {
+			pool->fn(pool, pool->arg, task, thief->id);
+			pthread_mutex_lock(&pool->lock);
+			if (!--pool->pending)
+				pthread_cond_broadcast(&pool->wake);
+			pthread_mutex_unlock(&pool->lock);
+			continue;
+		}
+
+		/**
+		 * Nothing to steal, done unless a running task may still push more.
+		 * Sleep until it does or every task is done
+		 */
+		pthread_mutex_lock(&pool->lock);
+		while (pool->pending && pool->pushes == pushes)
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		size_t pending = pool->pending;
+		pthread_mutex_unlock(&pool->lock);
+		if (!pending)
+			return NULL;
+	}
+}
+
+void pool_steal_run(pool_task_fn fn, void *arg, void **tasks, size_t count, int threads) {
+	pool_deque_t deques[threads];
+	pool_steal_t pool = {fn, arg, deques, threads, 0, 0};
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.wake, NULL);
+	for (int i = 0; i < threads; i++) {
+		deques[i] = (pool_deque_t) {NULL, 0, 0, 0};
+		pthread_mutex_init(&deques[i].lock, NULL);
+	}
+
+	/* Initial tasks dealt round robin */
+	for (size_t i = 0; i < count; i++)
+		pool_push(&pool, i % threads, tasks[i]);
+
+	pthread_t tids[threads];
+	pool_thief_t thieves[threads];
+	for (int i = 0; i < threads; i++) {
+		thieves[i].pool = &pool;
+		thieves[i].id = i;
+		if (i && pthread_create(&tids[i], NULL, pool_steal_work, &thieves[i])) {
+			fprintf(stderr, "Could not create a thread\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	pool_steal_work(&thieves[0]);
+	for (int i = 1; i < threads; i++)
+		pthread_join(tids[i], NULL);
+
+	/* Clear */
+	for (int i = 0; i < threads; i++) {
+		free(deques[i].tasks);
+		pthread_mutex_destroy(&deques[i].lock);
+	}
+	pthread_mutex_destroy(&pool.lock);
+	pthread_cond_destroy(&pool.wake);
+}
@@ -1,240 +1,825 @@
 #include "../include/rsa.h"
 #include "../include/sha3.h"
+#include "../include/mont.h"
+#include "../include/merkle.h"
+#include "../include/input.h"
+#include "../include/treehash.h"
+#include "../include/k12.h"
+#include "../include/chunkidx.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/random.h>
 
+/**
+ * 	Initialize every field of a key, with no prime factors
+ */
+static void rsa_init_key(rsa_key_t *key) {
+	mpz_inits(key->mod, key->exp, key->p, key->q, key->dp, key->dq, key->qinv, NULL);
+	for (int i = 0; i < MAXPRIMES - 2; i++)
+		mpz_inits(key->r[i], key->d[i], key->t[i], NULL);
+	key->nprimes = 0;
+}
+
+void rsa_clear_key(rsa_key_t key) {
+	mpz_clears(key.mod, key.exp, key.p, key.q, key.dp, key.dq, key.qinv, NULL);
+	for (int i = 0; i < MAXPRIMES - 2; i++)
+		mpz_clears(key.r[i], key.d[i], key.t[i], NULL);
+}
+
+/**
+ * 	Fill `len` bytes from the system random source
+ */
+static void rsa_random(void *buf, size_t len) {
+	for (size_t done = 0; done < len;) {
+		ssize_t got = getrandom((unsigned char *) buf + done, len - done, 0);
+		if (got < 0) {
+			fprintf(stderr, "Could not get random bytes\n");
+			exit(EXIT_FAILURE);
+		}
+		done += got;
+	}
+}
+
 keypair_t rsa_gen_keypair() {
+	return rsa_gen_keypair_primes(PRIMES);
+}
+
+keypair_t rsa_gen_keypair_primes(int nprimes) {
+	if (nprimes < 2 || nprimes > MAXPRIMES) {
+		fprintf(stderr, "Number of primes must be between 2 and %d\n", MAXPRIMES);
+		exit(EXIT_FAILURE);
+	}
+
 	gmp_randstate_t randstate;
 	gmp_randinit_default(randstate);
 	unsigned long seed;
 	getrandom(&seed, sizeof(unsigned long), GRND_RANDOM);
 	gmp_randseed_ui(randstate, seed);
 
-	mpz_t p, q, n, phi, e, d;
-
-	/* Generate p and q */
-	mpz_init2(p, BITLEN);
-	mpz_init2(q, BITLEN);
-
-	mpz_urandomb(p, randstate, BITLEN);
-	mpz_nextprime(p, p);
-
-	mpz_urandomb(q, randstate, BITLEN);
-	mpz_nextprime(q, q);
-
-	/* Compute modulo n */
-	mpz_init(n);
-	mpz_mul(n, p, q);
-
-	/* Compute phi */
-	mpz_init(phi);
-
-	mpz_sub_ui(p, p, 1);
-	mpz_sub_ui(q, q, 1);
-	mpz_lcm(phi, p, q);
-	mpz_add_ui(p, p, 1);
-	mpz_add_ui(q, q, 1);
+	mpz_t primes[MAXPRIMES], n, phi, e, d, aux;
+	mpz_inits(n, phi, e, d, aux, NULL);
 
 	/* Set exponent e */
-	mpz_init_set_ui(e, EXPONENT);
+	mpz_set_ui(e, EXPONENT);
+
+	/* Generate primes sharing the 2 * BITLEN bits of the modulo */
+	mpz_set_ui(n, 1);
+	mpz_set_ui(phi, 1);
+	for (int i = 0; i < nprimes; i++) {
+		int bits = 2 * BITLEN / nprimes + (i < 2 * BITLEN % nprimes);
+		mpz_init2(primes[i], bits);
+
+		/* Take primes with the top bit set, coprime to e and all distinct */
+		int again;
+		do {
+			mpz_urandomb(primes[i], randstate, bits);
+			mpz_setbit(primes[i], bits - 1);
+			mpz_nextprime(primes[i], primes[i]);
+
+			mpz_sub_ui(aux, primes[i], 1);
+			mpz_gcd(aux, aux, e);
+			again = mpz_cmp_ui(aux, 1);
+			for (int j = 0; j < i; j++)
+				again |= !mpz_cmp(primes[i], primes[j]);
+		} while (again);
+
+		/* Compute modulo n and phi */
+		mpz_mul(n, n, primes[i]);
+		mpz_sub_ui(aux, primes[i], 1);
+		mpz_lcm(phi, phi, aux);
+	}
 
 	/* Compute secret exponent d */
-	mpz_init(d);
 	if (!mpz_invert(d, e, phi))
 		exit(EXIT_FAILURE);
 
 	/* Create keys */
 	keypair_t keys;
-	mpz_init_set(keys.pk.mod, n);
-	mpz_init_set(keys.pk.exp, e);
-
-	mpz_init_set(keys.sk.mod, n);
-	mpz_init_set(keys.sk.exp, d);
+	rsa_init_key(&keys.pk);
+	mpz_set(keys.pk.mod, n);
+	mpz_set(keys.pk.exp, e);
+
+	rsa_init_key(&keys.sk);
+	mpz_set(keys.sk.mod, n);
+	mpz_set(keys.sk.exp, d);
+
+	/* Keep CRT parameters in the secret key */
+	keys.sk.nprimes = nprimes;
+	mpz_set(keys.sk.p, primes[0]);
+	mpz_set(keys.sk.q, primes[1]);
+	mpz_sub_ui(aux, primes[0], 1);
+	mpz_mod(keys.sk.dp, d, aux);
+	mpz_sub_ui(aux, primes[1], 1);
+	mpz_mod(keys.sk.dq, d, aux);
+	mpz_invert(keys.sk.qinv, primes[1], primes[0]);
+
+	/* Other primes, with the product of the previous ones in phi */
+	mpz_mul(phi, primes[0], primes[1]);
+	for (int i = 2; i < nprimes; i++) {
+		mpz_set(keys.sk.r[i - 2], primes[i]);
+		mpz_sub_ui(aux, primes[i], 1);
+		mpz_mod(keys.sk.d[i - 2], d, aux);
+		mpz_invert(keys.sk.t[i - 2], phi, primes[i]);
+		mpz_mul(phi, phi, primes[i]);
+	}
 
 	/* Clear environment */
 	gmp_randclear(randstate);
-	mpz_clears(p, q, n, phi, e, d, NULL);
+	for (int i = 0; i < nprimes; i++)
+		mpz_clear(primes[i]);
+	mpz_clears(n, phi, e, d, aux, NULL);
 	return keys;
 }
 
+void rsa_ctx_init(rsa_ctx_t ctx, rsa_key_t const key) {
+	ctx->_key = key;
+	ctx->_pub = mpz_sizeinbase(key.exp, 2) <= PUBEXPBITS;
+	mont_init(ctx->_mod, key.mod, key.exp);
+
+	/* Prime factors, with their exponents recoded once */
+	for (int i = 0; i < key.nprimes; i++) {
+		mpz_srcptr
+			prime = i == 0 ? key.p : i == 1 ? key.q : key.r[i - 2],
+			exp = i == 0 ? key.dp : i == 1 ? key.dq : key.d[i - 2];
+		mont_init(ctx->_primes[i], prime, exp);
+	}
+
+	/* Temporaries of the recombination, large enough not to grow */
+	mpz_init2(ctx->_m1, 2 * mpz_sizeinbase(key.mod, 2));
+	mpz_init2(ctx->_m2, 2 * mpz_sizeinbase(key.mod, 2));
+	mpz_init2(ctx->_R, 2 * mpz_sizeinbase(key.mod, 2));
+	for (int i = 0; i < key.nprimes; i++)
+		mpz_init2(ctx->_parts[i], mpz_sizeinbase(key.mod, 2));
+
+	if (ctx->_pub)
+		return;
+
+	/**
+	 * Blinding pair, made on first use. Allocated here at its full size so
+	 * operations in an arena scope never grow it, see arena.h
+	 */
+	mpz_init2(ctx->_e, mpz_sizeinbase(key.mod, 2));
+	mpz_init2(ctx->_blind, 2 * mpz_sizeinbase(key.mod, 2) + GMP_NUMB_BITS);
+	mpz_init2(ctx->_unblind, 2 * mpz_sizeinbase(key.mod, 2) + GMP_NUMB_BITS);
+	ctx->_blinduses = 0;
+
+	/**
+	 * Without prime factors e is unknown: take the one of generated keys,
+	 * until the first result proves it wrong
+	 */
+	mpz_set_ui(ctx->_e, EXPONENT);
+	ctx->_eknown = 0;
+
+	/* e = exp ^ -1 mod lcm(p - 1, q - 1, ...) */
+	if (key.nprimes) {
+		mpz_ptr lambda = ctx->_R, aux = ctx->_m1;
+		mpz_set_ui(lambda, 1);
+		for (int i = 0; i < key.nprimes; i++) {
+			mpz_sub_ui(aux, i == 0 ? key.p : i == 1 ? key.q : key.r[i - 2], 1);
+			mpz_lcm(lambda, lambda, aux);
+		}
+		if (!mpz_invert(ctx->_e, key.exp, lambda))
+			mpz_set_ui(ctx->_e, 0);
+		ctx->_eknown = 1;
+	}
+}
+
+void rsa_ctx_clear(rsa_ctx_t ctx) {
+	mont_clear(ctx->_mod);
+	for (int i = 0; i < ctx->_key.nprimes; i++)
+		mont_clear(ctx->_primes[i]);
+	for (int i = 0; i < ctx->_key.nprimes; i++)
+		mpz_clear(ctx->_parts[i]);
+	mpz_clears(ctx->_m1, ctx->_m2, ctx->_R, NULL);
+
+	if (!ctx->_pub)
+		mpz_clears(ctx->_e, ctx->_blind, ctx->_unblind, NULL);
+}
+
+/**
+ * 	Garner's recombination of the residues of an operand modulo every prime
+ * 	factor, the one modulo prime i being parts[i * stride]
+ */
+static void rsa_ctx_garner(mpz_t rop, mpz_t *parts, size_t stride, rsa_ctx_t ctx) {
+	rsa_key_t key = ctx->_key;
+
+	/**
+	 * m1 = op ^ dp % p
+	 * m2 = op ^ dq % q
+	 * rop = m2 + q * (qinv * (m1 - m2) % p)
+	 * For every other prime r[i], with R the product of the previous primes:
+	 * mi = op ^ d[i] % r[i]
+	 * rop = rop + R * (t[i] * (mi - rop) % r[i])
+	 */
+	mpz_ptr m1 = ctx->_m1, m2 = ctx->_m2, R = ctx->_R;
+
+	mpz_sub(m1, parts[0], parts[stride]);
+	mpz_mul(m1, m1, key.qinv);
+	mpz_mod(m1, m1, key.p);
+	mpz_mul(m1, m1, key.q);
+	mpz_add(m2, parts[stride], m1);
+
+	/* Other primes */
+	mpz_mul(R, key.p, key.q);
+	for (int i = 0; i < key.nprimes - 2; i++) {
+		mpz_sub(m1, parts[(i + 2) * stride], m2);
+		mpz_mul(m1, m1, key.t[i]);
+		mpz_mod(m1, m1, key.r[i]);
+		mpz_mul(m1, m1, R);
+		mpz_add(m2, m2, m1);
+		mpz_mul(R, R, key.r[i]);
+	}
+	mpz_set(rop, m2);
+}
+
+/**
+ * 	Secret exponentiation without blinding
+ */
+static void rsa_ctx_powm_sec(mpz_t rop, mpz_t const op, rsa_ctx_t ctx) {
+	rsa_key_t key = ctx->_key;
+
+	if (!key.nprimes) {
+		mont_powm_sec(rop, op, ctx->_mod);
+		return;
+	}
+
+	for (int i = 0; i < key.nprimes; i++)
+		mont_powm_sec(ctx->_parts[i], op, ctx->_primes[i]);
+	rsa_ctx_garner(rop, ctx->_parts, 1, ctx);
+}
+
+static void rsa_ctx_powm_sec_xn(mpz_t *rops, mpz_t *ops, size_t count, rsa_ctx_t ctx) {
+	rsa_key_t key = ctx->_key;
+
+	if (!key.nprimes) {
+		mont_powm_sec_xn(rops, ops, count, ctx->_mod);
+		return;
+	}
+
+	/* Residues of every operand modulo prime i in parts[i * count ...] */
+	mpz_t *parts = malloc(sizeof(mpz_t) * count * key.nprimes);
+	for (size_t j = 0; j < count * key.nprimes; j++)
+		mpz_init(parts[j]);
+
+	for (int i = 0; i < key.nprimes; i++)
+		mont_powm_sec_xn(parts + i * count, ops, count, ctx->_primes[i]);
+	for (size_t j = 0; j < count; j++)
+		rsa_ctx_garner(rops[j], parts + j, count, ctx);
+
+	for (size_t j = 0; j < count * key.nprimes; j++)
+		mpz_clear(parts[j]);
+	free(parts);
+}
+
+/**
+ * 	Next blinding pair (r ^ e, r ^ -1), for one secret exponentiation
+ * 	The previous pair is squared, which keeps it a valid pair, and a new
+ * 	random r is taken every BLINDUSES operations
+ */
+static void rsa_ctx_blind_next(rsa_ctx_t ctx) {
+	rsa_key_t key = ctx->_key;
+
+	if (ctx->_blinduses++ % BLINDUSES) {
+		mpz_mul(ctx->_blind, ctx->_blind, ctx->_blind);
+		mpz_mod(ctx->_blind, ctx->_blind, key.mod);
+		mpz_mul(ctx->_unblind, ctx->_unblind, ctx->_unblind);
+		mpz_mod(ctx->_unblind, ctx->_unblind, key.mod);
+		return;
+	}
+
+	/**
+	 * With e known, r is random and r ^ e is cheap. Otherwise r ^ e is
+	 * random and r = (r ^ e) ^ exp takes a secret exponentiation
+	 */
+	mp_size_t n = mpz_size(key.mod) + 1;
+	do {
+		/* One limb more than the modulo, so the reduction is uniform enough */
+		rsa_random(mpz_limbs_write(ctx->_blind, n), sizeof(mp_limb_t) * n);
+		mpz_limbs_finish(ctx->_blind, n);
+		mpz_mod(ctx->_blind, ctx->_blind, key.mod);
+		if (mpz_sgn(ctx->_e)) {
+			mpz_set(ctx->_unblind, ctx->_blind);
+			mont_powm(ctx->_blind, ctx->_blind, ctx->_e, ctx->_mod);
+		} else
+			rsa_ctx_powm_sec(ctx->_unblind, ctx->_blind, ctx);
+	} while (!mpz_invert(ctx->_unblind, ctx->_unblind, key.mod));
+}
+
+/**
+ * 	Check a secret key result against its operand reduced modulo the key
+ * 	modulo: res ^ e = op. A fault in one prime of the recombination would
+ * 	otherwise release a result that reveals that prime, so a mismatch with
+ * 	a known e exits. With a guessed e, a mismatch proves the guess wrong.
+ * 	An operand of 0 checks nothing, it is its own result for any e
+ *
+ * 	@return 0 if a guessed e is wrong, else 1
+ */
+static int rsa_ctx_check(mpz_t const res, mpz_t const op, rsa_ctx_t ctx) {
+	if (!mpz_sgn(ctx->_e))
+		return 1;
+
+	mont_powm(ctx->_m1, res, ctx->_e, ctx->_mod);
+	if (!mpz_cmp(ctx->_m1, op)) {
+		ctx->_eknown |= mpz_sgn(op) != 0;
+		return 1;
+	}
+	if (!ctx->_eknown)
+		return 0;
+
+	fprintf(stderr, "Secret key operation failed its check\n");
+	exit(EXIT_FAILURE);
+}
+
+void rsa_ctx_powm(mpz_t rop, mpz_t const op, rsa_ctx_t ctx) {
+	rsa_key_t key = ctx->_key;
+
+	/* Public exponents need no protection from timing */
+	if (ctx->_pub) {
+		mont_powm(rop, op, key.exp, ctx->_mod);
+		return;
+	}
+
+	/**
+	 * res = (op * r ^ e) ^ exp * r ^ -1 = op ^ exp
+	 * Computed in a temporary, `op` is needed to check it
+	 */
+	mpz_ptr res = ctx->_R;
+	rsa_ctx_blind_next(ctx);
+	mpz_mul(res, op, ctx->_blind);
+	mpz_mod(res, res, key.mod);
+	rsa_ctx_powm_sec(res, res, ctx);
+	mpz_mul(res, res, ctx->_unblind);
+	mpz_mod(res, res, key.mod);
+
+	/* A wrong guessed e is dropped, and pairs are made without it */
+	mpz_mod(ctx->_m2, op, key.mod);
+	if (!rsa_ctx_check(res, ctx->_m2, ctx)) {
+		mpz_set_ui(ctx->_e, 0);
+		ctx->_eknown = 1;
+		ctx->_blinduses = 0;
+		rsa_ctx_powm(rop, op, ctx);
+		return;
+	}
+	mpz_set(rop, res);
+}
+
+void rsa_ctx_powm_xn(mpz_t *rops, mpz_t *ops, size_t count, rsa_ctx_t ctx) {
+	rsa_key_t key = ctx->_key;
+
+	if (ctx->_pub) {
+		mont_powm_xn(rops, ops, count, key.exp, ctx->_mod);
+		return;
+	}
+
+	/* Results one at a time until one checks a guessed e */
+	while (!ctx->_eknown && count) {
+		rsa_ctx_powm(rops[0], ops[0], ctx);
+		rops++;
+		ops++;
+		count--;
+	}
+
+	/* Every operand gets its own blinding pair, and is kept for the check */
+	mpz_t *unblind = malloc(sizeof(mpz_t) * 2 * count), *orig = unblind + count;
+	for (size_t j = 0; j < count; j++) {
+		mpz_init(orig[j]);
+		mpz_mod(orig[j], ops[j], key.mod);
+		rsa_ctx_blind_next(ctx);
+		mpz_mul(rops[j], ops[j], ctx->_blind);
+		mpz_mod(rops[j], rops[j], key.mod);
+		mpz_init_set(unblind[j], ctx->_unblind);
+	}
+
+	rsa_ctx_powm_sec_xn(rops, rops, count, ctx);
+
+	for (size_t j = 0; j < count; j++) {
+		mpz_mul(rops[j], rops[j], unblind[j]);
+		mpz_mod(rops[j], rops[j], key.mod);
+		rsa_ctx_check(rops[j], orig[j], ctx);
+		mpz_clears(unblind[j], orig[j], NULL);
+	}
+	free(unblind);
+}
+
+void rsa_powm(mpz_t rop, mpz_t const op, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	rsa_ctx_powm(rop, op, ctx);
+	rsa_ctx_clear(ctx);
+}
+
+/**
+ * 	GMP integers of `count` bytestreams, cleared with `rsa_mpz_batch_clear`
+ */
+static mpz_t *rsa_mpz_batch(bytestream_t *bs, size_t count) {
+	mpz_t *ops = malloc(sizeof(mpz_t) * count);
+	for (size_t i = 0; i < count; i++) {
+		mpz_init(ops[i]);
+		mpz_set_bs(ops[i], bs[i]);
+	}
+	return ops;
+}
+
+static void rsa_mpz_batch_clear(mpz_t *ops, size_t count) {
+	for (size_t i = 0; i < count; i++)
+		mpz_clear(ops[i]);
+	free(ops);
+}
+
 void rsa_enc(bytestream_t cipher, bytestream_t const msg, rsa_key_t const key) {
+	/* A batch of one message */
+	bytestream_t batch_cipher[1], batch_msg[1];
+	batch_cipher[0][0] = cipher[0];
+	batch_msg[0][0] = msg[0];
+	rsa_enc_batch(batch_cipher, batch_msg, 1, key);
+}
+
+void rsa_enc_ctx(bytestream_t cipher, bytestream_t const msg, rsa_ctx_t ctx) {
+	byte_t encoded[OAEP_LEN];
 	mpz_t mpz_msg;
 	mpz_init(mpz_msg);
 
 	/* mpz_msg <- OAEP_Enc(msg) */
-	rsa_oaep_enc(cipher, msg);
-	mpz_set_bs(mpz_msg, cipher);
-	
+	rsa_oaep_enc_b(encoded, bs_view(msg));
+	mpz_set_view(mpz_msg, bs_view_b(encoded, OAEP_LEN));
+
 	/* cipher <- R(mpz_msg, key) */
-	mpz_powm_sec(mpz_msg, mpz_msg, key.exp, key.mod);
-	bs_set_mpz(cipher, mpz_msg);
+	rsa_ctx_powm(mpz_msg, mpz_msg, ctx);
+	bs_set_mpz_size(cipher, mpz_msg, rsa_ctx_bytes(ctx));
 
 	mpz_clear(mpz_msg);
 }
 
+void rsa_enc_batch(bytestream_t *ciphers, bytestream_t *msgs, size_t count, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	rsa_enc_batch_ctx(ciphers, msgs, count, ctx);
+	rsa_ctx_clear(ctx);
+}
+
+void rsa_enc_batch_ctx(bytestream_t *ciphers, bytestream_t *msgs, size_t count, rsa_ctx_t ctx) {
+	/* ciphers <- OAEP_Enc(msgs) */
+	rsa_oaep_enc_batch(ciphers, msgs, count);
+
+	/* ciphers <- R(ciphers, key) */
+	mpz_t *mpz_msgs = rsa_mpz_batch(ciphers, count);
+	rsa_ctx_powm_xn(mpz_msgs, mpz_msgs, count, ctx);
+	for (size_t i = 0; i < count; i++)
+		bs_set_mpz_size(ciphers[i], mpz_msgs[i], rsa_ctx_bytes(ctx));
+
+	rsa_mpz_batch_clear(mpz_msgs, count);
+}
+
 void rsa_dec(bytestream_t msg, bytestream_t const cipher, rsa_key_t const key) {
+	/* A batch of one message */
+	bytestream_t batch_msg[1], batch_cipher[1];
+	batch_msg[0][0] = msg[0];
+	batch_cipher[0][0] = cipher[0];
+	rsa_dec_batch(batch_msg, batch_cipher, 1, key);
+}
+
+void rsa_dec_ctx(bytestream_t msg, bytestream_t const cipher, rsa_ctx_t ctx) {
 	mpz_t mpz_cipher;
 	mpz_init(mpz_cipher);
 
 	/* mpz_cipher <- R(cipher, key) */
 	mpz_set_bs(mpz_cipher, cipher);
-	mpz_powm_sec(mpz_cipher, mpz_cipher, key.exp, key.mod);
+	rsa_ctx_powm(mpz_cipher, mpz_cipher, ctx);
 
 	/* msg <- OAEP_Dec(mpz_cipher) */
-	bs_set_mpz(msg, mpz_cipher);
-	rsa_oaep_dec(msg, msg);
-
-	/* -- Remove extra zeros to the right -----------*/
-	/* mpz_set_bs(mpz_cipher, msg);                  */
-	/* mp_bitcnt_t first = mpz_scan1(mpz_cipher, 0); */
-	/* mpz_div_2exp(mpz_cipher, mpz_cipher, first);  */
-	/* bs_set_mpz(msg, mpz_cipher);                  */
-	/* ----------------------------------------------*/
+	bs_set_mpz_size(msg, mpz_cipher, OAEP_LEN);
+	rsa_oaep_dec_b(msg[0]->_data);
+	msg[0]->_len = OAEP_MSGLEN;
 
 	mpz_clear(mpz_cipher);
 }
 
+void rsa_dec_batch(bytestream_t *msgs, bytestream_t *ciphers, size_t count, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	rsa_dec_batch_ctx(msgs, ciphers, count, ctx);
+	rsa_ctx_clear(ctx);
+}
+
+void rsa_dec_batch_ctx(bytestream_t *msgs, bytestream_t *ciphers, size_t count, rsa_ctx_t ctx) {
+	/* msgs <- R(ciphers, key) */
+	mpz_t *mpz_ciphers = rsa_mpz_batch(ciphers, count);
+	rsa_ctx_powm_xn(mpz_ciphers, mpz_ciphers, count, ctx);
+	for (size_t i = 0; i < count; i++)
+		bs_set_mpz_size(msgs[i], mpz_ciphers[i], OAEP_LEN);
+
+	/* msgs <- OAEP_Dec(msgs) */
+	rsa_oaep_dec_batch(msgs, msgs, count);
+
+	rsa_mpz_batch_clear(mpz_ciphers, count);
+}
+
+/**
+ * 	Full-domain hash of a message, BITLEN bits of SHAKE256
+ */
+static void rsa_hash(bytestream_t hash, bytestream_t const msg) {
+	/* Grow first, `msg` may be `hash` */
+	if (hash[0]->_avail < BITLEN / 8)
+		_bs_update(hash, BITLEN / 8);
+	shake256(hash[0]->_data, BITLEN / 8, bs_view(msg));
+	hash[0]->_len = BITLEN / 8;
+}
+
 void rsa_sign(bytestream_t sign, bytestream_t const msg, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	rsa_sign_ctx(sign, msg, ctx);
+	rsa_ctx_clear(ctx);
+}
+
+void rsa_sign_ctx(bytestream_t sign, bytestream_t const msg, rsa_ctx_t ctx) {
 	/**
-	 * Sign(msg, sk) = R(sha3(msg), sk)
+	 * Sign(msg, sk) = R(shake256(msg), sk)
 	 * R(a, k) = (a ^ k.exp) % k.mod
 	 */
 
-	/* sign <- sha3(msg) */
-	sha3(sign, msg, BITLEN);
+	/* sign <- shake256(msg) */
+	rsa_hash(sign, msg);
 
 	/* R(sign, sk) */
+	rsa_sign_digest_ctx(sign, sign, ctx);
+}
+
+void rsa_sign_digest(bytestream_t sign, bytestream_t const digest, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	rsa_sign_digest_ctx(sign, digest, ctx);
+	rsa_ctx_clear(ctx);
+}
+
+void rsa_sign_digest_ctx(bytestream_t sign, bytestream_t const digest, rsa_ctx_t ctx) {
 	mpz_t mpz_sign;
 	mpz_init(mpz_sign);
-	mpz_set_bs(mpz_sign, sign);
+	mpz_set_bs(mpz_sign, digest);
 
 	/* Compute signature */
-	mpz_powm_sec(mpz_sign, mpz_sign, key.exp, key.mod);
+	rsa_ctx_powm(mpz_sign, mpz_sign, ctx);
 	bs_set_mpz(sign, mpz_sign);
 	
 	mpz_clear(mpz_sign);
 }
 
 int rsa_verify(bytestream_t const sign, bytestream_t const msg, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	int ret = rsa_verify_ctx(sign, msg, ctx);
+	rsa_ctx_clear(ctx);
+
+	return ret;
+}
+
+int rsa_verify_ctx(bytestream_t const sign, bytestream_t const msg, rsa_ctx_t ctx) {
 	/**
-	 * Extract sign hash: sign ^ key.exp % key.mod
 	 * Hash msg
+	 * Compare with the hash extracted from sign
+	 */
+	bytestream_t aux;
+	bs_init_size(aux, BITLEN / 8);
+
+	/* Compute msg hash */
+	rsa_hash(aux, msg);
+	int ret = rsa_verify_digest_ctx(sign, aux, ctx);
+
+	bs_clear(aux);
+
+	return ret;
+}
+
+int rsa_verify_digest(bytestream_t const sign, bytestream_t const digest, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	int ret = rsa_verify_digest_ctx(sign, digest, ctx);
+	rsa_ctx_clear(ctx);
+
+	return ret;
+}
+
+/**
+ * 	Verify a signature of a digest, both read where they are
+ */
+static int rsa_verify_view(bs_view_t sign, bs_view_t digest, rsa_ctx_t ctx) {
+	/**
+	 * Extract sign hash: sign ^ key.exp % key.mod
 	 * Compare hashes
 	 */
 	mpz_t h0, h1;
 	mpz_inits(h0, h1, NULL);
 
-	bytestream_t aux;
-	bs_init_size(aux, BITLEN / 8);
-
 	/* Extract signature hash h0 */
-	mpz_set_bs(h0, sign);
-	mpz_powm_sec(h0, h0, key.exp, key.mod);
+	mpz_set_view(h0, sign);
+	rsa_ctx_powm(h0, h0, ctx);
 
-	/* Compute msg hash h1 */
-	sha3(aux, msg, BITLEN);
-	mpz_set_bs(h1, aux);
+	/* Message hash h1 */
+	mpz_set_view(h1, digest);
 
 	/* Compare hashes h1 and h2 */
 	int ret = mpz_cmp(h0, h1);
 
 	/* Clear environment */
-	bs_clear(aux);
 	mpz_clears(h0, h1, NULL);
 
 	return !ret;
 }
 
-void rsa_oaep_enc(bytestream_t encoded, bytestream_t const msg) {
-	size_t msg_len = (BITLEN - OAEP_K0) / 8;
-	if (bs_len(msg) > msg_len) {
-		fprintf(stderr, "Message too long\n");
-		exit(EXIT_FAILURE);
+int rsa_verify_digest_ctx(bytestream_t const sign, bytestream_t const digest, rsa_ctx_t ctx) {
+	return rsa_verify_view(bs_view(sign), bs_view(digest), ctx);
+}
+
+int rsa_verify_batch(int *valid, bytestream_t *signs, bytestream_t *msgs, size_t count, rsa_key_t const key) {
+	bytestream_t *hashes = malloc(sizeof(bytestream_t) * count);
+	for (size_t i = 0; i < count; i++)
+		bs_init_size(hashes[i], BITLEN / 8);
+
+	/* Hash every message */
+	shake256_xn(hashes, msgs, count, BITLEN);
+
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	int ret = rsa_verify_digest_batch_ctx(valid, signs, hashes, count, ctx);
+	rsa_ctx_clear(ctx);
+
+	for (size_t i = 0; i < count; i++)
+		bs_clear(hashes[i]);
+	free(hashes);
+
+	return ret;
+}
+
+/**
+ * 	Verify signatures of digests given as GMP integers, one by one
+ */
+static int rsa_verify_mpz_batch(int *valid, mpz_t *signs, mpz_t *digests, size_t count, rsa_ctx_t ctx) {
+	/* Extract every signature hash */
+	mpz_t *h0 = malloc(sizeof(mpz_t) * count);
+	for (size_t i = 0; i < count; i++)
+		mpz_init_set(h0[i], signs[i]);
+	rsa_ctx_powm_xn(h0, h0, count, ctx);
+
+	/* Compare with the message hashes */
+	int ret = 1;
+	for (size_t i = 0; i < count; i++) {
+		valid[i] = !mpz_cmp(h0[i], digests[i]);
+		ret &= valid[i];
 	}
 
-	gmp_randstate_t randstate;
-	gmp_randinit_default(randstate);
+	rsa_mpz_batch_clear(h0, count);
 
-	/* Initialization */
-	mpz_t r, X, Y, mpz_msg;
-	mpz_inits(r, X, Y, mpz_msg, NULL);
+	return ret;
+}
 
-	bytestream_t hr, hX, aux;
-	bs_init_size(hr, (BITLEN - OAEP_K0) / 8);
-	bs_init_size(hX, OAEP_K0 / 8);
-	bs_init_size(aux, bs_len(msg));
-	bs_set(aux, msg);
+int rsa_verify_digest_batch_ctx(int *valid, bytestream_t *signs, bytestream_t *digests, size_t count, rsa_ctx_t ctx) {
+	mpz_t *mpz_signs = rsa_mpz_batch(signs, count), *mpz_digests = rsa_mpz_batch(digests, count);
+	int ret = rsa_verify_mpz_batch(valid, mpz_signs, mpz_digests, count, ctx);
+	rsa_mpz_batch_clear(mpz_signs, count);
+	rsa_mpz_batch_clear(mpz_digests, count);
 
-	/* Pad msg with K1 zeros */
-	if (bs_len(aux) < msg_len)
-		bs_concat_zero(aux, aux, msg_len - bs_len(msg));
+	return ret;
+}
 
-	/* Generate r with K0 bits */
-	mpz_urandomb(r, randstate, OAEP_K0);
+void rsa_oaep_enc_b(byte_t *encoded, bs_view_t msg) {
+	if (msg.len > OAEP_MSGLEN) {
+		fprintf(stderr, "Message too long\n");
+		exit(EXIT_FAILURE);
+	}
 
-	/* Hash r with length BITLEN - OAEP_K0 */
-	bs_set_mpz(hr, r);
-	sha3(hr, hr, BITLEN - OAEP_K0);
+	/* X = msg padded with K1 zeros, Y = r with K0 random bits */
+	byte_t *X = encoded, *Y = encoded + OAEP_MSGLEN;
+	memmove(X, msg.data, msg.len);
+	memset(X + msg.len, 0, OAEP_MSGLEN - msg.len);
+	rsa_random(Y, OAEP_RLEN);
 
-	/* X = msg ^ hr */
-	mpz_set_bs(mpz_msg, aux);
-	mpz_set_bs(X, hr);
-	mpz_xor(X, mpz_msg, X);
+	/* X = X ^ G(r), then Y = r ^ H(X) */
+	shake256_mask(X, OAEP_MSGLEN, bs_view_b(Y, OAEP_RLEN));
+	shake256_mask(Y, OAEP_RLEN, bs_view_b(X, OAEP_MSGLEN));
+}
 
-	/* Hash x with length OAEP_K0 */
-	bs_set_mpz(hX, X);
-	sha3(hX, hX, OAEP_K0);
+void rsa_oaep_enc(bytestream_t encoded, bytestream_t const msg) {
+	if (encoded[0]->_avail < OAEP_LEN)
+		_bs_update(encoded, OAEP_LEN);
+	rsa_oaep_enc_b(encoded[0]->_data, bs_view(msg));
+	encoded[0]->_len = OAEP_LEN;
+}
 
-	/* Y = r ^ hX */
-	mpz_set_bs(Y, hX);
-	mpz_xor(Y, r, Y);
+void rsa_oaep_enc_batch(bytestream_t *encoded, bytestream_t *msgs, size_t count) {
+	byte_t **X = malloc(sizeof(byte_t *) * 2 * count), **Y = X + count;
+	bs_view_t *vX = malloc(sizeof(bs_view_t) * 2 * count), *vY = vX + count;
+
+	for (size_t i = 0; i < count; i++) {
+		if (bs_len(msgs[i]) > OAEP_MSGLEN) {
+			fprintf(stderr, "Message too long\n");
+			exit(EXIT_FAILURE);
+		}
+		if (encoded[i][0]->_avail < OAEP_LEN)
+			_bs_update(encoded[i], OAEP_LEN);
+		X[i] = encoded[i][0]->_data;
+		Y[i] = X[i] + OAEP_MSGLEN;
+		vX[i] = bs_view_b(X[i], OAEP_MSGLEN);
+		vY[i] = bs_view_b(Y[i], OAEP_RLEN);
+
+		/* X = msg padded with K1 zeros, Y = r with K0 random bits */
+		size_t len = bs_len(msgs[i]);
+		memmove(X[i], msgs[i][0]->_data, len);
+		memset(X[i] + len, 0, OAEP_MSGLEN - len);
+		rsa_random(Y[i], OAEP_RLEN);
+		encoded[i][0]->_len = OAEP_LEN;
+	}
 
-	/* X||Y */
-	bs_set_mpz(hr, X);
-	bs_set_mpz(hX, Y);
-	bs_concat(encoded, hr, hX);
+	/* Every X = X ^ G(r), then every Y = r ^ H(X) */
+	shake256_xn_mask(X, vY, count, BITLEN - OAEP_K0);
+	shake256_xn_mask(Y, vX, count, OAEP_K0);
 
-	bs_clear(hr);
-	bs_clear(hX);
-	bs_clear(aux);
-	mpz_clears(r, X, Y, mpz_msg, NULL);
+	free(X);
+	free(vX);
+}
+
+void rsa_oaep_dec_b(byte_t *encoded) {
+	/* r = Y ^ H(X), then msg = X ^ G(r) */
+	byte_t *X = encoded, *Y = encoded + OAEP_MSGLEN;
+	shake256_mask(Y, OAEP_RLEN, bs_view_b(X, OAEP_MSGLEN));
+	shake256_mask(X, OAEP_MSGLEN, bs_view_b(Y, OAEP_RLEN));
+}
+
+/**
+ * 	Set `msg` to the last OAEP_LEN bytes of `encoded`, with leading zero
+ * 	bytes if it is shorter
+ */
+static void rsa_oaep_load(bytestream_t msg, bytestream_t const encoded) {
+	if (msg[0]->_avail < OAEP_LEN)
+		_bs_update(msg, OAEP_LEN);
+
+	size_t len = bs_len(encoded) < OAEP_LEN ? bs_len(encoded) : OAEP_LEN;
+	memmove(msg[0]->_data + OAEP_LEN - len, encoded[0]->_data + bs_len(encoded) - len, len);
+	memset(msg[0]->_data, 0, OAEP_LEN - len);
 }
 
 void rsa_oaep_dec(bytestream_t msg, bytestream_t const encoded) {
-	mpz_t X, Y, r;
-	mpz_inits(X, Y, r, NULL);
+	rsa_oaep_load(msg, encoded);
+	rsa_oaep_dec_b(msg[0]->_data);
+	msg[0]->_len = OAEP_MSGLEN;
+}
 
-	bytestream_t hX, hr;
-	bs_init_size(hr, (BITLEN - OAEP_K0) / 8);
-	bs_init_size(hX, (BITLEN - OAEP_K0) / 8);
+void rsa_oaep_dec_batch(bytestream_t *msgs, bytestream_t *encoded, size_t count) {
+	byte_t **X = malloc(sizeof(byte_t *) * 2 * count), **Y = X + count;
+	bs_view_t *vX = malloc(sizeof(bs_view_t) * 2 * count), *vY = vX + count;
+
+	for (size_t i = 0; i < count; i++) {
+		rsa_oaep_load(msgs[i], encoded[i]);
+		X[i] = msgs[i][0]->_data;
+		Y[i] = X[i] + OAEP_MSGLEN;
+		vX[i] = bs_view_b(X[i], OAEP_MSGLEN);
+		vY[i] = bs_view_b(Y[i], OAEP_RLEN);
+		msgs[i][0]->_len = OAEP_MSGLEN;
+	}
 
-	/* Extract hX and X */
-	bs_trim(hX, encoded, OAEP_K0 / 8);
-	mpz_set_bs(X, hX);
-	sha3(hX, hX, OAEP_K0);
+	/* Every r = Y ^ H(X), then every msg = X ^ G(r) */
+	shake256_xn_mask(Y, vX, count, OAEP_K0);
+	shake256_xn_mask(X, vY, count, BITLEN - OAEP_K0);
 
-	/* Extract Y */
-	bs_trim(hr, encoded, -(BITLEN - OAEP_K0) / 8);
-	mpz_set_bs(Y, hr);
+	free(X);
+	free(vX);
+}
 
-	/* Calculate r */
-	mpz_set_bs(r, hX);
-	mpz_xor(r, Y, r);
+/**
+ * 	Write a GMP integer to a key file as its length followed by its bytes
+ */
+static void rsa_write_mpz(FILE *file, mpz_t const op) {
+	bytestream_t bs;
+	bs_init_size(bs, BITLEN / 8);
 
-	/* Hash r */
-	bs_set_mpz(hr, r);
-	sha3(hr, hr, BITLEN - OAEP_K0);
+	bs_set_mpz(bs, op);
+	word_t size = bs_len(bs);
+	fwrite(&size, sizeof(word_t), 1, file);
+	fwrite(bs[0]->_data, 1, bs_len(bs), file);
 
-	/* Calculate padded msg */
-	mpz_set_bs(r, hr);
-	mpz_xor(r, X, r);
-	bs_set_mpz(msg, r);
+	bs_clear(bs);
+}
+
+/**
+ * 	Read a GMP integer written with `rsa_write_mpz`
+ *
+ * 	@return 1 if a whole integer of at most KEYMPZMAX bytes was read, 0
+ * 	otherwise
+ */
+static int rsa_read_mpz(FILE *file, mpz_t rop) {
+	word_t size;
+	if (fread(&size, sizeof(word_t), 1, file) != 1 || size > KEYMPZMAX)
+		return 0;
 
-	mpz_clears(X, Y, r, NULL);
-	bs_clear(hX);
-	bs_clear(hr);
+	bytestream_t bs;
+	bs_init_size(bs, size);
+	int ok = fread(bs[0]->_data, 1, size, file) == size;
+	bs[0]->_len = size;
+	if (ok)
+		mpz_set_bs(rop, bs);
+
+	bs_clear(bs);
+	return ok;
 }
 
 void rsa_save_key(char * const filepath, rsa_key_t const key) {
@@ -244,26 +829,74 @@ void rsa_save_key(char * const filepath, rsa_key_t const key) {
 		exit(EXIT_FAILURE);
 	}
 
-	bytestream_t bs;
-	bs_init_size(bs, BITLEN / 8); /* TODO: wrong size */
-
-	/* Write modulo */
-	bs_set_mpz(bs, key.mod);
-	word_t size = bs_len(bs);
-	fwrite(&size, sizeof(word_t), 1, file);
-	fwrite(bs[0]->_data, 1, bs_len(bs), file);
-
-	/* Write exponent */
-	bs_set_mpz(bs, key.exp);
-	size = bs_len(bs);
-	fwrite(&size, sizeof(word_t), 1, file);
-	fwrite(bs[0]->_data, 1, bs_len(bs), file);
+	/* Write modulo and exponent */
+	rsa_write_mpz(file, key.mod);
+	rsa_write_mpz(file, key.exp);
+
+	/* Write CRT parameters */
+	if (key.nprimes) {
+		word_t nprimes = key.nprimes;
+		fwrite(&nprimes, sizeof(word_t), 1, file);
+		rsa_write_mpz(file, key.p);
+		rsa_write_mpz(file, key.q);
+		rsa_write_mpz(file, key.dp);
+		rsa_write_mpz(file, key.dq);
+		rsa_write_mpz(file, key.qinv);
+		for (int i = 0; i < key.nprimes - 2; i++) {
+			rsa_write_mpz(file, key.r[i]);
+			rsa_write_mpz(file, key.d[i]);
+			rsa_write_mpz(file, key.t[i]);
+		}
+	}
 
 	/* Clear */
-	bs_clear(bs);
 	fclose(file);
 }
 
+/**
+ * 	Check the CRT parameters of a secret key against its modulo and
+ * 	exponent, so a corrupt key file cannot make wrong signatures
+ *
+ * 	@return 1 if the primes multiply to the modulo, the exponents and
+ * 	coefficients match them and the exponent is invertible, 0 otherwise
+ */
+static int rsa_check_key(rsa_key_t const key) {
+	mpz_t prod, lambda, aux;
+	mpz_inits(prod, lambda, aux, NULL);
+	mpz_set_ui(prod, 1);
+	mpz_set_ui(lambda, 1);
+
+	int ok = 1;
+	for (int i = 0; ok && i < key.nprimes; i++) {
+		mpz_srcptr
+			prime = i == 0 ? key.p : i == 1 ? key.q : key.r[i - 2],
+			exp = i == 0 ? key.dp : i == 1 ? key.dq : key.d[i - 2];
+
+		/* exp mod (prime - 1) */
+		ok = mpz_cmp_ui(prime, 2) >= 0;
+		if (ok) {
+			mpz_sub_ui(aux, prime, 1);
+			mpz_mod(aux, key.exp, aux);
+			ok = !mpz_cmp(aux, exp);
+		}
+
+		/* q * qinv = 1 mod p and prod * t[i] = 1 mod r[i], prod of the previous primes */
+		if (ok && i) {
+			mpz_mul(aux, i == 1 ? key.qinv : key.t[i - 2], i == 1 ? key.q : prod);
+			mpz_mod(aux, aux, i == 1 ? key.p : prime);
+			ok = !mpz_cmp_ui(aux, 1);
+		}
+
+		mpz_mul(prod, prod, prime);
+		mpz_sub_ui(aux, prime, 1);
+		mpz_lcm(lambda, lambda, aux);
+	}
+	ok = ok && !mpz_cmp(prod, key.mod) && mpz_invert(aux, key.exp, lambda);
+
+	mpz_clears(prod, lambda, aux, NULL);
+	return ok;
+}
+
 rsa_key_t rsa_load_key(char * const filepath) {
 	FILE *file = fopen(filepath, "rb");
 	if (!file) {
@@ -273,49 +906,278 @@ rsa_key_t rsa_load_key(char * const filepath) {
 
 	/* Create and init key */
 	rsa_key_t key;
-	mpz_inits(key.exp, key.mod, NULL);
-	
-	word_t size;
-	void *data;
-	bytestream_t bs;
-
-	/* Read modulo length */
-	fread(&size, sizeof(word_t), 1, file);
-	data = malloc(size);
-	bs_init_size(bs, size);
-
-	/* Read modulo */
-	fread(data, 1, size, file);
-	bs_set_b(bs, data, size);
-
-	mpz_set_bs(key.mod, bs);
+	rsa_init_key(&key);
 
-	/* Read exponent length */
-	fread(&size, sizeof(word_t), 1, file);
-	data = realloc(data, size);
-	
-	/* Read exponent */
-	fread(data, 1, size, file);
-	bs_set_b(bs, data, size);
+	/* Read modulo and exponent, the modulo odd as Montgomery arithmetic needs */
+	if (!rsa_read_mpz(file, key.mod) || !rsa_read_mpz(file, key.exp) ||
+		mpz_cmp_ui(key.mod, 1) <= 0 || mpz_even_p(key.mod)) {
+		fprintf(stderr, "Invalid key file \"%s\"\n", filepath);
+		exit(EXIT_FAILURE);
+	}
 
-	mpz_set_bs(key.exp, bs);
+	/* Read CRT parameters, missing in old key files */
+	word_t nprimes;
+	if (fread(&nprimes, sizeof(word_t), 1, file) == 1) {
+		int ok =
+			nprimes >= 2 && nprimes <= MAXPRIMES &&
+			rsa_read_mpz(file, key.p) && rsa_read_mpz(file, key.q) &&
+			rsa_read_mpz(file, key.dp) && rsa_read_mpz(file, key.dq) &&
+			rsa_read_mpz(file, key.qinv);
+		for (int i = 0; ok && i < nprimes - 2; i++)
+			ok = rsa_read_mpz(file, key.r[i]) && rsa_read_mpz(file, key.d[i]) &&
+				rsa_read_mpz(file, key.t[i]);
+		key.nprimes = ok ? nprimes : 0;
+		if (!ok || !rsa_check_key(key)) {
+			fprintf(stderr, "Invalid key file \"%s\"\n", filepath);
+			exit(EXIT_FAILURE);
+		}
+	}
 
 	/* Clear */
-	bs_clear(bs);
 	fclose(file);
-	free(data);
 
 	return key;
 }
 
+/**
+ * 	Absorb the rest of a file by streaming it through a fixed-size buffer
+ */
+static void rsa_absorb_file(sha3_ctx_t ctx, FILE *file) {
+	byte_t buf[IOBUFSIZE];
+	size_t n;
+
+	while ((n = fread(buf, 1, IOBUFSIZE, file)) > 0)
+		sha3_update(ctx, buf, n);
+}
+
+/**
+ * 	Absorb bytes of a file read by an input backend
+ */
+static void rsa_absorb(void *ctx, const byte_t *data, size_t len) {
+	sha3_update(ctx, data, len);
+}
+
+/**
+ * 	Hash a file read with the input backend of the process
+ */
+static void rsa_hash_file(bytestream_t hash, char * const filepath) {
+	sha3_ctx_t ctx;
+	shake256_init(ctx, BITLEN);
+	input_file(filepath, rsa_absorb, ctx);
+	sha3_final(hash, ctx);
+}
+
+/**
+ * 	Hash a chunk index to be signed
+ */
+static void rsa_hash_index(bytestream_t hash, bs_view_t index) {
+	sha3_ctx_t ctx;
+	cshake256_init(ctx, BITLEN, bs_view_b((byte_t *) CHUNKIDX_CUSTOM, strlen(CHUNKIDX_CUSTOM)));
+	sha3_update(ctx, index.data, index.len);
+	sha3_final(hash, ctx);
+}
+
+/* Hash algorithm names, by algorithm */
+static char const *rsa_hash_names[HASH_ALGOS] = {"shake256", "k12"};
+
+int rsa_hash_algo(char const *name) {
+	for (int i = 0; i < HASH_ALGOS; i++)
+		if (!strcmp(name, rsa_hash_names[i]))
+			return i;
+	return -1;
+}
+
+/**
+ * 	Absorb bytes of a file read by an input backend into a KangarooTwelve
+ * 	context
+ */
+static void rsa_absorb_k12(void *ctx, const byte_t *data, size_t len) {
+	k12_update(ctx, data, len);
+}
+
+/**
+ * 	Hash a file with an algorithm, see `rsa_hash_file`
+ */
+static void rsa_hash_file_algo(bytestream_t hash, char * const filepath, int algo) {
+	if (algo != HASH_K12) {
+		rsa_hash_file(hash, filepath);
+		return;
+	}
+
+	/* Chunks buffered in the context make it too large for the stack */
+	k12_ctx_t *ctx = malloc(sizeof(k12_ctx_t));
+	k12_init(*ctx, BITLEN);
+	input_file(filepath, rsa_absorb_k12, *ctx);
+	k12_final(hash, *ctx, bs_view_b(NULL, 0));
+	free(ctx);
+}
+
 void rsa_sign_file(char * const signpath, char * const filepath, rsa_key_t const key) {
-	FILE *src, *dst;
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	rsa_sign_file_ctx(signpath, filepath, ctx);
+	rsa_ctx_clear(ctx);
+}
+
+/**
+ * 	Save a signature after a header to `signpath` with SIGNSUFFIX, or to
+ * 	the standard output if it is STDIOPATH
+ */
+static void rsa_save_sign(char * const signpath, bs_view_t head, bytestream_t const sign) {
+	FILE *dst = stdout;
+	char signpath_suffix[strlen(signpath) + strlen(SIGNSUFFIX) + 1];
+	strcpy(signpath_suffix, signpath);
+	strcat(signpath_suffix, SIGNSUFFIX);
+	if (strcmp(signpath, STDIOPATH) && !(dst = fopen(signpath_suffix, "wb"))) {
+		fprintf(stderr, "Could not open \"%s\" for writting\n", signpath);
+		exit(EXIT_FAILURE);
+	}
+
+	if (head.len)
+		fwrite(head.data, 1, head.len, dst);
+	fwrite(sign[0]->_data, 1, bs_len(sign), dst);
+
+	if (dst == stdout)
+		fflush(dst);
+	else
+		fclose(dst);
+}
+
+void rsa_sign_file_ctx(char * const signpath, char * const filepath, rsa_ctx_t ctx) {
+	/* Hash source */
+	bytestream_t sign;
+	bs_init_size(sign, BITLEN / 8);
+	rsa_hash_file(sign, filepath);
+
+	/* Sign message digest */
+	rsa_sign_digest_ctx(sign, sign, ctx);
+
+	/* Save signature to file */
+	rsa_save_sign(signpath, bs_view_b(NULL, 0), sign);
+
+	/* Clear */
+	bs_clear(sign);
+}
+
+void rsa_sign_file_tree(char * const signpath, char * const filepath, size_t leafsize, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	rsa_sign_file_tree_ctx(signpath, filepath, leafsize, ctx);
+	rsa_ctx_clear(ctx);
+}
+
+void rsa_sign_file_tree_ctx(char * const signpath, char * const filepath, size_t leafsize, rsa_ctx_t ctx) {
+	/* Hash source as a tree */
+	bytestream_t sign;
+	bs_init_size(sign, BITLEN / 8);
+	treehash_file(sign, filepath, leafsize, BITLEN);
+
+	/* Sign the root */
+	rsa_sign_digest_ctx(sign, sign, ctx);
+
+	/* Save the mode and leaf size, then the signature */
+	byte_t head[TREEMAGICLEN + sizeof(word_t)];
+	word_t leaf = leafsize;
+	memcpy(head, TREEMAGIC, TREEMAGICLEN);
+	memcpy(head + TREEMAGICLEN, &leaf, sizeof(word_t));
+	rsa_save_sign(signpath, bs_view_b(head, sizeof(head)), sign);
+
+	/* Clear */
+	bs_clear(sign);
+}
+
+void rsa_sign_file_index(char * const signpath, char * const filepath, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	rsa_sign_file_index_ctx(signpath, filepath, ctx);
+	rsa_ctx_clear(ctx);
+}
+
+void rsa_sign_file_index_ctx(char * const signpath, char * const filepath, rsa_ctx_t ctx) {
+	/* Index the chunks of the source */
+	bytestream_t index, sign;
+	bs_init(index);
+	bs_init_size(sign, BITLEN / 8);
+	chunkidx_file(index, filepath);
+
+	/* Sign the index */
+	rsa_hash_index(sign, bs_view(index));
+	rsa_sign_digest_ctx(sign, sign, ctx);
+
+	/* Save the index, then the signature */
+	rsa_save_sign(signpath, bs_view(index), sign);
+
+	/* Clear */
+	bs_clear(index);
+	bs_clear(sign);
+}
+
+void rsa_sign_file_hash(char * const signpath, char * const filepath, int algo, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	rsa_sign_file_hash_ctx(signpath, filepath, algo, ctx);
+	rsa_ctx_clear(ctx);
+}
+
+void rsa_sign_file_hash_ctx(char * const signpath, char * const filepath, int algo, rsa_ctx_t ctx) {
+	/* Hash source with the algorithm */
+	bytestream_t sign;
+	bs_init_size(sign, BITLEN / 8);
+	rsa_hash_file_algo(sign, filepath, algo);
+
+	/* Sign message digest */
+	rsa_sign_digest_ctx(sign, sign, ctx);
+
+	/* Save the algorithm, then the signature */
+	byte_t head[HASHMAGICLEN + sizeof(word_t)];
+	word_t id = algo;
+	memcpy(head, HASHMAGIC, HASHMAGICLEN);
+	memcpy(head + HASHMAGICLEN, &id, sizeof(word_t));
+	rsa_save_sign(signpath, bs_view_b(head, sizeof(head)), sign);
+
+	/* Clear */
+	bs_clear(sign);
+}
+
+void rsa_sign_append(char * const signpath, char * const filepath, char * const statepath, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	rsa_sign_append_ctx(signpath, filepath, statepath, ctx);
+	rsa_ctx_clear(ctx);
+}
+
+void rsa_sign_append_ctx(char * const signpath, char * const filepath, char * const statepath, rsa_ctx_t ctx) {
+	FILE *src, *dst, *state;
 	src = fopen(filepath, "rb");
 	if (!src) {
 		fprintf(stderr, "Could not open \"%s\" for reading\n", filepath);
 		exit(EXIT_FAILURE);
 	}
 
+	/* Resume from the saved state, if any */
+	sha3_ctx_t hash;
+	if ((state = fopen(statepath, "rb"))) {
+		fclose(state);
+		sha3_load(hash, statepath);
+		if (hash->_len != BITLEN || hash->_pad != SHAKE_PAD) {
+			fprintf(stderr, "Invalid SHA3 state \"%s\"\n", statepath);
+			exit(EXIT_FAILURE);
+		}
+	} else {
+		shake256_init(hash, BITLEN);
+	}
+
+	/* Skip what was already hashed */
+	if (fseek(src, 0, SEEK_END) || ftell(src) < sha3_absorbed(hash)) {
+		fprintf(stderr, "\"%s\" is shorter than when \"%s\" was saved\n", filepath, statepath);
+		exit(EXIT_FAILURE);
+	}
+	fseek(src, sha3_absorbed(hash), SEEK_SET);
+
+	/* Hash the appended bytes and save the state for the next call */
+	rsa_absorb_file(hash, src);
+	sha3_save(statepath, hash);
+
 	char signpath_suffix[strlen(signpath) + strlen(SIGNSUFFIX) + 1];
 	strcpy(signpath_suffix, signpath);
 	strcat(signpath_suffix, SIGNSUFFIX);
@@ -325,87 +1187,356 @@ void rsa_sign_file(char * const signpath, char * const filepath, rsa_key_t const
 		exit(EXIT_FAILURE);
 	}
 
-	/* Count bytes in source */
-	size_t size = 0;
-	while (fgetc(src) != EOF) size++;
-	fseek(src, 0, SEEK_SET);
-
-	/* Read source */
-	bytestream_t bs;
-	bs_init_size(bs, size);
-
-	void *data = malloc(size);
-	fread(data, 1, size, src);
-	bs_set_b(bs, data, size);
-	free(data);
-
-	/* Sign message */
+	/* Sign message digest */
 	bytestream_t sign;
 	bs_init_size(sign, BITLEN / 8);
-	rsa_sign(sign, bs, key);
+	sha3_final(sign, hash);
+	rsa_sign_digest_ctx(sign, sign, ctx);
 
 	/* Save signature to file */
 	fwrite(sign[0]->_data, 1, bs_len(sign), dst);
 
 	/* Clear */
 	bs_clear(sign);
-	bs_clear(bs);
 
 	fclose(src);
 	fclose(dst);
 }
 
+void rsa_sign_batch(char **filepaths, size_t count, rsa_key_t const key) {
+	/* Hash every file */
+	bytestream_t *digests = malloc(count * sizeof(bytestream_t));
+	for (size_t i = 0; i < count; i++) {
+		bs_init_size(digests[i], BITLEN / 8);
+		rsa_hash_file(digests[i], filepaths[i]);
+	}
+
+	rsa_sign_batch_digests(filepaths, digests, count, key);
+
+	/* Clear */
+	for (size_t i = 0; i < count; i++)
+		bs_clear(digests[i]);
+	free(digests);
+}
+
+void rsa_sign_batch_digests(char **filepaths, bytestream_t *digests, size_t count, rsa_key_t const key) {
+	/* Sign the root of the tree of digests */
+	merkle_t tree;
+	merkle_init(tree, digests, count, BITLEN);
+
+	bytestream_t sign, path[MERKLE_MAXPATH];
+	bs_init_size(sign, BITLEN / 8);
+	merkle_root(sign, tree);
+	rsa_sign_digest(sign, sign, key);
+	for (int i = 0; i < MERKLE_MAXPATH; i++)
+		bs_init_size(path[i], BITLEN / 8);
+
+	/* Save the signature and inclusion path of every file */
+	for (size_t i = 0; i < count; i++) {
+		char signpath[strlen(filepaths[i]) + strlen(SIGNSUFFIX) + 1];
+		strcpy(signpath, filepaths[i]);
+		strcat(signpath, SIGNSUFFIX);
+		FILE *dst = fopen(signpath, "wb");
+		if (!dst) {
+			fprintf(stderr, "Could not open \"%s\" for writting\n", signpath);
+			exit(EXIT_FAILURE);
+		}
+
+		word_t head[3] = {count, i, bs_len(sign)};
+		fwrite(PROOFMAGIC, 1, PROOFMAGICLEN, dst);
+		fwrite(head, sizeof(word_t), 3, dst);
+		fwrite(sign[0]->_data, 1, bs_len(sign), dst);
+
+		size_t len = merkle_path_len(i, count);
+		merkle_path(path, tree, i);
+		for (size_t j = 0; j < len; j++)
+			fwrite(path[j][0]->_data, 1, bs_len(path[j]), dst);
+
+		fclose(dst);
+	}
+
+	/* Clear */
+	for (int i = 0; i < MERKLE_MAXPATH; i++)
+		bs_clear(path[i]);
+	bs_clear(sign);
+	merkle_clear(tree);
+}
+
+/**
+ * 	Verify a signature written by `rsa_sign_batch` for a digest
+ */
+static int rsa_verify_proof(bytestream_t const proof, bytestream_t const digest, rsa_ctx_t ctx) {
+	byte_t *data = proof[0]->_data + PROOFMAGICLEN;
+	size_t left = bs_len(proof) - PROOFMAGICLEN;
+
+	/* Number of files, index and signature length */
+	word_t head[3];
+	if (left < sizeof(head))
+		return 0;
+	memcpy(head, data, sizeof(head));
+	data += sizeof(head);
+	left -= sizeof(head);
+
+	if (head[1] >= head[0] || head[2] > left ||
+		left - head[2] != merkle_path_len(head[1], head[0]) * (BITLEN / 8))
+		return 0;
+
+	/* Root signature and inclusion path, read where they are */
+	size_t len = merkle_path_len(head[1], head[0]);
+	bytestream_t root;
+	bs_view_t sign, path[MERKLE_MAXPATH];
+	bs_init_size(root, BITLEN / 8);
+	sign = bs_view_b(data, head[2]);
+	data += head[2];
+	for (size_t j = 0; j < len; j++, data += BITLEN / 8)
+		path[j] = bs_view_b(data, BITLEN / 8);
+
+	merkle_root_path(root, digest, head[1], head[0], path, BITLEN);
+	int ret = rsa_verify_view(sign, bs_view(root), ctx);
+
+	/* Clear */
+	bs_clear(root);
+
+	return ret;
+}
+
 int rsa_verify_file(char * const signpath, char * const filepath, rsa_key_t const key) {
-	FILE *file, *signature;
-	file = fopen(filepath, "rb");
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	int ret = rsa_verify_file_ctx(signpath, filepath, ctx);
+	rsa_ctx_clear(ctx);
+	if (ret < 0)
+		exit(EXIT_FAILURE);
+
+	return ret;
+}
+
+/**
+ * 	Read a whole signature file straight into a bytestream, STDIOPATH
+ * 	for the standard input
+ *
+ * 	@return 0 if it could not be opened, 1 otherwise
+ */
+static int rsa_read_sign(bytestream_t sign, char * const signpath) {
+	FILE *signature = stdin;
+	if (strcmp(signpath, STDIOPATH) && !(signature = fopen(signpath, "rb"))) {
+		fprintf(stderr, "Could not open \"%s\" for reading\n", signpath);
+		return 0;
+	}
+
+	size_t n;
+	do {
+		if (sign[0]->_avail == bs_len(sign))
+			_bs_update(sign, 0);
+		n = fread(sign[0]->_data + bs_len(sign), 1,
+			sign[0]->_avail - bs_len(sign), signature);
+		sign[0]->_len += n;
+	} while (n > 0);
+
+	if (signature != stdin)
+		fclose(signature);
+	return 1;
+}
+
+/**
+ * 	Whether a file to verify can be opened, so a missing one is reported
+ * 	without exiting
+ */
+static int rsa_can_read(char * const filepath) {
+	if (!strcmp(filepath, STDIOPATH))
+		return 1;
+	FILE *file = fopen(filepath, "rb");
 	if (!file) {
 		fprintf(stderr, "Could not open \"%s\" for reading\n", filepath);
+		return 0;
+	}
+	fclose(file);
+	return 1;
+}
+
+/**
+ * 	Whether a signature was made by `rsa_sign_file_tree`
+ */
+#define rsa_is_tree(sign) \
+	(bs_len(sign) >= TREEMAGICLEN + sizeof(word_t) && !memcmp(sign[0]->_data, TREEMAGIC, TREEMAGICLEN))
+
+/**
+ * 	Verify a signature made by `rsa_sign_file_tree` against the tree hash
+ * 	of a file
+ */
+static int rsa_verify_tree(bytestream_t const sign, char * const filepath, rsa_ctx_t ctx) {
+	word_t leafsize;
+	memcpy(&leafsize, sign[0]->_data + TREEMAGICLEN, sizeof(word_t));
+	if (leafsize < TREEHASH_MINLEAF)
+		return 0;
+	if (!strcmp(filepath, STDIOPATH)) {
+		fprintf(stderr, "Tree hash signatures need a file, not the standard input\n");
 		exit(EXIT_FAILURE);
 	}
 
-	signature = fopen(signpath, "rb");
-	if (!signature) {
-		fprintf(stderr, "Could not open \"%s\" for reading\n", signpath);
+	bytestream_t root;
+	bs_init_size(root, BITLEN / 8);
+	treehash_file(root, filepath, leafsize, BITLEN);
+
+	size_t head = TREEMAGICLEN + sizeof(word_t);
+	int ret = rsa_verify_view(bs_view_sub(bs_view(sign), head, bs_len(sign) - head), bs_view(root), ctx);
+
+	/* Clear */
+	bs_clear(root);
+
+	return ret;
+}
+
+/**
+ * 	Whether a signature was made by `rsa_sign_file_hash`
+ */
+#define rsa_is_hash(sign) \
+	(bs_len(sign) >= HASHMAGICLEN + sizeof(word_t) && !memcmp(sign[0]->_data, HASHMAGIC, HASHMAGICLEN))
+
+/**
+ * 	Verify a signature made by `rsa_sign_file_hash` against the hash of a
+ * 	file with the algorithm it holds
+ */
+static int rsa_verify_hash(bytestream_t const sign, char * const filepath, rsa_ctx_t ctx) {
+	word_t algo;
+	memcpy(&algo, sign[0]->_data + HASHMAGICLEN, sizeof(word_t));
+	if (algo >= HASH_ALGOS)
+		return 0;
+
+	bytestream_t digest;
+	bs_init_size(digest, BITLEN / 8);
+	rsa_hash_file_algo(digest, filepath, algo);
+
+	size_t head = HASHMAGICLEN + sizeof(word_t);
+	int ret = rsa_verify_view(bs_view_sub(bs_view(sign), head, bs_len(sign) - head), bs_view(digest), ctx);
+
+	/* Clear */
+	bs_clear(digest);
+
+	return ret;
+}
+
+/**
+ * 	Whether a signature was made by `rsa_sign_file_index`
+ */
+#define rsa_is_index(sign) \
+	(bs_len(sign) >= CHUNKIDX_MAGICLEN && !memcmp(sign[0]->_data, CHUNKIDX_MAGIC, CHUNKIDX_MAGICLEN))
+
+/**
+ * 	Verify a signature made by `rsa_sign_file_index`, then the chunks of
+ * 	a file covering a byte range, or every chunk if `whole` is set
+ */
+static int rsa_verify_index(bytestream_t const sign, char * const filepath, size_t offset, size_t length, int whole, rsa_ctx_t ctx) {
+	size_t len = chunkidx_len(bs_view(sign));
+	if (!len)
+		return 0;
+	if (!strcmp(filepath, STDIOPATH)) {
+		fprintf(stderr, "Chunk index signatures need a file, not the standard input\n");
 		exit(EXIT_FAILURE);
 	}
 
-	/* Count size in file */
-	size_t size = 0;
-	while (fgetc(file) != EOF) size++;
-	fseek(file, 0, SEEK_SET);
+	bytestream_t digest;
+	bs_init_size(digest, BITLEN / 8);
+	rsa_hash_index(digest, bs_view_sub(bs_view(sign), 0, len));
+	int ret = rsa_verify_view(bs_view_sub(bs_view(sign), len, bs_len(sign) - len), bs_view(digest), ctx);
 
-	/* Read source */
-	bytestream_t bs_file;
-	bs_init_size(bs_file, size);
+	/* Check the chunks only under a valid signature */
+	if (ret && whole) {
+		word_t size;
+		memcpy(&size, sign[0]->_data + CHUNKIDX_MAGICLEN, sizeof(word_t));
+		length = size;
+	}
+	if (ret)
+		ret = chunkidx_verify_range(bs_view_sub(bs_view(sign), 0, len), filepath, offset, length);
 
-	void *data = malloc(size);
-	fread(data, 1, size, file);
-	bs_set_b(bs_file, data, size);
+	/* Clear */
+	bs_clear(digest);
 
-	/* Count size in signature */
-	size = 0;
-	while (fgetc(signature) != EOF) size++;
-	fseek(signature, 0, SEEK_SET);
+	return ret;
+}
 
-	/* Read signature */
-	bytestream_t bs_signature;
-	bs_init_size(bs_signature, size);
+/**
+ * 	Verify a signature, or batch proof, read by `rsa_read_sign`
+ */
+static int rsa_verify_sign(bytestream_t const sign, bytestream_t const digest, rsa_ctx_t ctx) {
+	if (bs_len(sign) >= PROOFMAGICLEN && !memcmp(sign[0]->_data, PROOFMAGIC, PROOFMAGICLEN))
+		return rsa_verify_proof(sign, digest, ctx);
+	return rsa_verify_digest_ctx(sign, digest, ctx);
+}
 
-	data = realloc(data, size);
-	fread(data, 1, size, signature);
-	bs_set_b(bs_signature, data, size);
+/**
+ * 	Verify a whole file against a signature read by `rsa_read_sign`
+ */
+static int rsa_verify_read(bytestream_t const sign, char * const filepath, rsa_ctx_t ctx) {
+	/* Hash file, as a tree or with another algorithm if it was signed so */
+	int ret;
+	if (rsa_is_tree(sign)) {
+		ret = rsa_verify_tree(sign, filepath, ctx);
+	} else if (rsa_is_hash(sign)) {
+		ret = rsa_verify_hash(sign, filepath, ctx);
+	} else if (rsa_is_index(sign)) {
+		ret = rsa_verify_index(sign, filepath, 0, 0, 1, ctx);
+	} else {
+		bytestream_t digest;
+		bs_init_size(digest, BITLEN / 8);
+		rsa_hash_file(digest, filepath);
+		ret = rsa_verify_sign(sign, digest, ctx);
+		bs_clear(digest);
+	}
 
-	/* Verify signature */
-	int ret = rsa_verify(bs_signature, bs_file, key);
+	return ret;
+}
+
+int rsa_verify_file_ctx(char * const signpath, char * const filepath, rsa_ctx_t ctx) {
+	bytestream_t sign;
+	bs_init(sign);
+	int ret = rsa_read_sign(sign, signpath) && rsa_can_read(filepath) ?
+		rsa_verify_read(sign, filepath, ctx) : -1;
 
 	/* Clear */
-	bs_clear(bs_file);
-	bs_clear(bs_signature);
+	bs_clear(sign);
 
-	fclose(file);
-	fclose(signature);
+	return ret;
+}
+
+int rsa_verify_file_range(char * const signpath, char * const filepath, size_t offset, size_t length, rsa_key_t const key) {
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	bytestream_t sign;
+	bs_init(sign);
+	if (!rsa_read_sign(sign, signpath))
+		exit(EXIT_FAILURE);
+
+	/* Only the chunks of the range, else the whole file */
+	int ret = rsa_is_index(sign) ?
+		rsa_verify_index(sign, filepath, offset, length, 0, ctx) :
+		rsa_verify_read(sign, filepath, ctx);
 
-	free(data);
+	/* Clear */
+	bs_clear(sign);
+	rsa_ctx_clear(ctx);
+
+	return ret;
+}
+
+int rsa_verify_file_digest_ctx(char * const signpath, char * const filepath, bytestream_t const digest, rsa_ctx_t ctx) {
+	bytestream_t sign;
+	bs_init(sign);
+	if (!rsa_read_sign(sign, signpath) || !rsa_can_read(filepath)) {
+		bs_clear(sign);
+		return -1;
+	}
+
+	int ret = rsa_is_tree(sign) ?
+		rsa_verify_tree(sign, filepath, ctx) :
+		rsa_is_hash(sign) ?
+		rsa_verify_hash(sign, filepath, ctx) :
+		rsa_is_index(sign) ?
+		rsa_verify_index(sign, filepath, 0, 0, 1, ctx) :
+		rsa_verify_sign(sign, digest, ctx);
+
+	/* Clear */
+	bs_clear(sign);
 
 	return ret;
 }
@@ -1,7 +1,7 @@
 #include "../include/sha3.h"
 #include <string.h>
 
-static const word_t RC[] = {
+const word_t keccak_rc[SHA3_RNDS] = {
 	0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
 	0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
 	0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
@@ -12,120 +12,387 @@ static const word_t RC[] = {
 	0x8000000000008080, 0x0000000080000001, 0x8000000080008008
 };
 
-void state_init(state_t *st) {
-	st[0] = malloc(sizeof(word_t *) * 5);
-	for (int i = 0; i < 5; i++)
-		st[0][i] = calloc(5, sizeof(word_t));
+/**
+ * 	Keccak-p rounds `first` to SHA3_RNDS - 1
+ */
+static void keccak_rounds(state_t st, int first) {
+	word_t a00, a10, a20, a30, a40, a01, a11, a21, a31, a41, a02, a12, a22, a32, a42, a03, a13, a23, a33, a43, a04, a14, a24, a34, a44;
+	word_t b00, b10, b20, b30, b40, b01, b11, b21, b31, b41, b02, b12, b22, b32, b42, b03, b13, b23, b33, b43, b04, b14, b24, b34, b44;
+	word_t c0, c1, c2, c3, c4, d0, d1, d2, d3, d4;
+
+	/* Load lanes, aXY holds lane (x, y) */
+	a00 = st[0]; a10 = st[1]; a20 = st[2]; a30 = st[3]; a40 = st[4];
+	a01 = st[5]; a11 = st[6]; a21 = st[7]; a31 = st[8]; a41 = st[9];
+	a02 = st[10]; a12 = st[11]; a22 = st[12]; a32 = st[13]; a42 = st[14];
+	a03 = st[15]; a13 = st[16]; a23 = st[17]; a33 = st[18]; a43 = st[19];
+	a04 = st[20]; a14 = st[21]; a24 = st[22]; a34 = st[23]; a44 = st[24];
+
+	for (int r = first; r < SHA3_RNDS; r++) {
+		/* Theta */
+		c0 = a00 ^ a01 ^ a02 ^ a03 ^ a04;
+		c1 = a10 ^ a11 ^ a12 ^ a13 ^ a14;
+		c2 = a20 ^ a21 ^ a22 ^ a23 ^ a24;
+		c3 = a30 ^ a31 ^ a32 ^ a33 ^ a34;
+		c4 = a40 ^ a41 ^ a42 ^ a43 ^ a44;
+		d0 = c4 ^ ROT64(c1, 1);
+		d1 = c0 ^ ROT64(c2, 1);
+		d2 = c1 ^ ROT64(c3, 1);
+		d3 = c2 ^ ROT64(c4, 1);
+		d4 = c3 ^ ROT64(c0, 1);
+
+		/* Rho & Pi */
+		b00 = a00 ^ d0;
+		b13 = ROT64(a01 ^ d0, 36);
+		b21 = ROT64(a02 ^ d0, 3);
+		b34 = ROT64(a03 ^ d0, 41);
+		b42 = ROT64(a04 ^ d0, 18);
+		b02 = ROT64(a10 ^ d1, 1);
+		b10 = ROT64(a11 ^ d1, 44);
+		b23 = ROT64(a12 ^ d1, 10);
+		b31 = ROT64(a13 ^ d1, 45);
+		b44 = ROT64(a14 ^ d1, 2);
+		b04 = ROT64(a20 ^ d2, 62);
+		b12 = ROT64(a21 ^ d2, 6);
+		b20 = ROT64(a22 ^ d2, 43);
+		b33 = ROT64(a23 ^ d2, 15);
+		b41 = ROT64(a24 ^ d2, 61);
+		b01 = ROT64(a30 ^ d3, 28);
+		b14 = ROT64(a31 ^ d3, 55);
+		b22 = ROT64(a32 ^ d3, 25);
+		b30 = ROT64(a33 ^ d3, 21);
+		b43 = ROT64(a34 ^ d3, 56);
+		b03 = ROT64(a40 ^ d4, 27);
+		b11 = ROT64(a41 ^ d4, 20);
+		b24 = ROT64(a42 ^ d4, 39);
+		b32 = ROT64(a43 ^ d4, 8);
+		b40 = ROT64(a44 ^ d4, 14);
+
+		/* Chi */
+		a00 = b00 ^ (~b10 & b20);
+		a10 = b10 ^ (~b20 & b30);
+		a20 = b20 ^ (~b30 & b40);
+		a30 = b30 ^ (~b40 & b00);
+		a40 = b40 ^ (~b00 & b10);
+		a01 = b01 ^ (~b11 & b21);
+		a11 = b11 ^ (~b21 & b31);
+		a21 = b21 ^ (~b31 & b41);
+		a31 = b31 ^ (~b41 & b01);
+		a41 = b41 ^ (~b01 & b11);
+		a02 = b02 ^ (~b12 & b22);
+		a12 = b12 ^ (~b22 & b32);
+		a22 = b22 ^ (~b32 & b42);
+		a32 = b32 ^ (~b42 & b02);
+		a42 = b42 ^ (~b02 & b12);
+		a03 = b03 ^ (~b13 & b23);
+		a13 = b13 ^ (~b23 & b33);
+		a23 = b23 ^ (~b33 & b43);
+		a33 = b33 ^ (~b43 & b03);
+		a43 = b43 ^ (~b03 & b13);
+		a04 = b04 ^ (~b14 & b24);
+		a14 = b14 ^ (~b24 & b34);
+		a24 = b24 ^ (~b34 & b44);
+		a34 = b34 ^ (~b44 & b04);
+		a44 = b44 ^ (~b04 & b14);
+
+		/* Iota */
+		a00 ^= keccak_rc[r];
+	}
+
+	/* Store lanes */
+	st[0] = a00; st[1] = a10; st[2] = a20; st[3] = a30; st[4] = a40;
+	st[5] = a01; st[6] = a11; st[7] = a21; st[8] = a31; st[9] = a41;
+	st[10] = a02; st[11] = a12; st[12] = a22; st[13] = a32; st[14] = a42;
+	st[15] = a03; st[16] = a13; st[17] = a23; st[18] = a33; st[19] = a43;
+	st[20] = a04; st[21] = a14; st[22] = a24; st[23] = a34; st[24] = a44;
 }
 
-void state_clear(state_t *st) {
-	for (int i = 0; i < 5; i++)
-		free(st[0][i]);
-	free(st[0]);
-	st[0] = NULL;
+void keccak_f(state_t st) {
+	keccak_rounds(st, 0);
 }
 
-void keccak_f(state_t *st) {
-	state_t a = st[0];
-    for (int r = 0; r < SHA3_RNDS; r++) {
-		word_t *C = (word_t *) calloc(5, sizeof(word_t));
-		word_t *D = (word_t *) calloc(5, sizeof(word_t));
+void keccak_p12(state_t st) {
+	keccak_rounds(st, SHA3_RNDS - K12_RNDS);
+}
 
-		/* Theta */
-		for (int x = 0; x < 5; x++)
-			C[x] = a[x][0] ^ a[x][1] ^ a[x][2] ^ a[x][3] ^ a[x][4];
+/* Inlined into every caller, so constant arguments specialize its loops */
+#ifdef __GNUC__
+#define SHA3_INLINE static inline __attribute__((always_inline))
+#else
+#define SHA3_INLINE static inline
+#endif
 
-		for (int x = 0; x < 5; x++) {
-            D[x] = C[(x + 4) % 5] ^ ROT64(C[(x + 1) % 5], 1);
-            for (int y = 0; y < 5; y++)
-                a[x][y] ^= D[x];
-		}
+/**
+ * 	XOR one rate-sized block into the state and permute it with `rounds`
+ * 	rounds, SHA3_RNDS or K12_RNDS
+ */
+SHA3_INLINE void sha3_absorb_rounds(state_t st, const byte_t *block, size_t rate, int rounds) {
+	for (int j = 0; j < rate / sizeof(word_t); j++) {
+		word_t i64;
+		memcpy(&i64, block + j * sizeof(word_t), sizeof(word_t));
+		st[j] ^= i64;
+	}
+	if (rounds == K12_RNDS)
+		keccak_p12(st);
+	else
+		keccak_f(st);
+}
 
-		/* Rho & Phi */
-        int x = 1, y = 0, aux;
-		word_t current = a[x][y];
-		for (int t = 0; t < 24; t++) {
-            aux = x; x = y; y = (2 * aux + 3 * y) % 5;
-            word_t tmp = a[x][y];
+/* Absorb a block with the 24 rounds of SHA3 */
+#define sha3_absorb(st, block, rate) sha3_absorb_rounds(st, block, rate, SHA3_RNDS)
 
-            a[x][y] = ROT64(current, ((t + 1) * (t + 2) / 2) % 64);
+/**
+ * 	Pad the last `len` bytes of a message into a block and absorb it
+ */
+SHA3_INLINE void sha3_absorb_last(state_t st, const byte_t *data, size_t len, size_t rate, byte_t pad, int rounds) {
+	byte_t block[SHA3_B / 8];
+	memset(block, 0, rate);
+	memcpy(block, data, len);
+	block[len] ^= pad;
+	block[rate - 1] ^= 0x80;
+	sha3_absorb_rounds(st, block, rate, rounds);
+}
 
-            current = tmp;
+/**
+ * 	Write `outlen` bytes of output of an absorbed state to `out`, or XOR
+ * 	them into it if `xor` is set
+ * 	Lanes are stored little-endian, so every block is copied whole
+ */
+SHA3_INLINE void sha3_output(state_t st, byte_t *out, size_t outlen, size_t rate, int xor, int rounds) {
+	for (size_t off = 0; off < outlen; off += rate) {
+		size_t fill = outlen - off > rate ? rate : outlen - off;
+		const byte_t *lanes = (const byte_t *) st;
+		if (xor) {
+			size_t k = 0;
+			for (; k + sizeof(word_t) <= fill; k += sizeof(word_t)) {
+				word_t i64;
+				memcpy(&i64, out + off + k, sizeof(word_t));
+				i64 ^= st[k / sizeof(word_t)];
+				memcpy(out + off + k, &i64, sizeof(word_t));
+			}
+			for (; k < fill; k++)
+				out[off + k] ^= lanes[k];
+		} else {
+			memcpy(out + off, lanes, fill);
 		}
-
-		/* Chi */
-		for (int y = 0; y < 5; y++) {
-            memset(C, 0, 5 * sizeof(word_t));
-			for (int x = 0; x < 5; x++)
-                C[x] = a[x][y];
-			for (int x = 0; x < 5; x++)
-                a[x][y] = (C[x] ^ ((~C[(x + 1) % 5]) & C[(x + 2) % 5]));
+		if (off + rate < outlen) {
+			if (rounds == K12_RNDS)
+				keccak_p12(st);
+			else
+				keccak_f(st);
 		}
+	}
+}
 
-		/* Iota */
-        a[0][0] ^= RC[r];
+/**
+ * 	Hash a whole message with a fixed rate and padding
+ */
+SHA3_INLINE void sha3_sponge(byte_t *out, size_t outlen, bs_view_t msg, size_t rate, byte_t pad, int xor) {
+	state_t st = {0};
+	const byte_t *in = msg.data;
+	size_t len = msg.len;
+
+	for (; len >= rate; in += rate, len -= rate)
+		sha3_absorb(st, in, rate);
+	sha3_absorb_last(st, in, len, rate, pad, SHA3_RNDS);
+	sha3_output(st, out, outlen, rate, xor, SHA3_RNDS);
+}
+
+void sha3_224(byte_t *out, bs_view_t msg) {
+	sha3_sponge(out, 28, msg, SHA3_224_RATE, SHA3_PAD, 0);
+}
+
+void sha3_256(byte_t *out, bs_view_t msg) {
+	sha3_sponge(out, 32, msg, SHA3_256_RATE, SHA3_PAD, 0);
+}
+
+void sha3_384(byte_t *out, bs_view_t msg) {
+	sha3_sponge(out, 48, msg, SHA3_384_RATE, SHA3_PAD, 0);
+}
+
+void sha3_512(byte_t *out, bs_view_t msg) {
+	sha3_sponge(out, 64, msg, SHA3_512_RATE, SHA3_PAD, 0);
+}
+
+void shake128(byte_t *out, size_t outlen, bs_view_t msg) {
+	sha3_sponge(out, outlen, msg, SHAKE128_RATE, SHAKE_PAD, 0);
+}
+
+void shake256(byte_t *out, size_t outlen, bs_view_t msg) {
+	sha3_sponge(out, outlen, msg, SHAKE256_RATE, SHAKE_PAD, 0);
+}
 
-		free(C); free(D);
+void shake128_mask(byte_t *out, size_t outlen, bs_view_t msg) {
+	sha3_sponge(out, outlen, msg, SHAKE128_RATE, SHAKE_PAD, 1);
+}
+
+void shake256_mask(byte_t *out, size_t outlen, bs_view_t msg) {
+	sha3_sponge(out, outlen, msg, SHAKE256_RATE, SHAKE_PAD, 1);
+}
+
+void sha3_init(sha3_ctx_t ctx, size_t len) {
+	memset(ctx->_st, 0, sizeof(state_t));
+	ctx->_buflen = 0;
+	ctx->_rate = SHA3_RATE(len);
+	ctx->_len = len;
+	ctx->_pad = SHA3_PAD;
+	ctx->_rounds = SHA3_RNDS;
+	ctx->_absorbed = 0;
+}
+
+void shake256_init(sha3_ctx_t ctx, size_t len) {
+	sha3_init(ctx, len);
+	ctx->_rate = SHAKE256_RATE;
+	ctx->_pad = SHAKE_PAD;
+}
+
+void turboshake128_init(sha3_ctx_t ctx, size_t len, byte_t pad) {
+	sha3_init(ctx, len);
+	ctx->_rate = SHAKE128_RATE;
+	ctx->_pad = pad;
+	ctx->_rounds = K12_RNDS;
+}
+
+void cshake256_init(sha3_ctx_t ctx, size_t len, bs_view_t custom) {
+	shake256_init(ctx, len);
+	if (!custom.len)
+		return;
+	if (custom.len > SHAKE256_RATE - 8) {
+		fprintf(stderr, "cSHAKE customization string too long\n");
+		exit(EXIT_FAILURE);
 	}
+	ctx->_pad = CSHAKE_PAD;
+
+	/* bytepad(left_encode(rate) || encode_string("") || encode_string(custom), rate) */
+	size_t bits = custom.len * 8;
+	byte_t block[SHAKE256_RATE] = {1, SHAKE256_RATE, 1, 0}, *p = block + 4;
+	*p++ = bits > 0xff ? 2 : 1;
+	if (bits > 0xff)
+		*p++ = bits >> 8;
+	*p++ = bits;
+	memcpy(p, custom.data, custom.len);
+	sha3_absorb(ctx->_st, block, SHAKE256_RATE);
 }
 
-void sha3(bytestream_t hash, bytestream_t const msg, size_t len) {
-	const int
-#ifdef VARIABLE_CAPACITY
-		c = len > SHA3_MAXC ? SHA3_MAXC : len * 2, /* Capacity */
-#else
-		c = SHA3_C,
-#endif
-		r = SHA3_B - c, /* Rate */
-		q = (r / 8) - bs_len(msg) % (r / 8), /* Padding len */
-		w = SHA3_STTDEPTH, /* State depth */
-		blocksize = r / w * 8; /* Message block size */
-
-	state_t st;
-	state_init(&st);
-
-	/* Add padding to message */
-	bytestream_t aux;
-	bs_init_size(aux, bs_len(msg) + q);
-	bs_set(aux, msg);
-	if (q == 1) {
-		bs_concat_b(aux, aux, 0x86);
-	} else {
-		bs_concat_b(aux, aux, 0x06);
-		bs_concat_zero(aux, aux, q - 2);
-		bs_concat_b(aux, aux, 0x80);
+void sha3_update(sha3_ctx_t ctx, const void *data, size_t size) {
+	const byte_t *in = data;
+	size_t rate = ctx->_rate;
+	ctx->_absorbed += size;
+
+	/* Complete a previously buffered block */
+	if (ctx->_buflen) {
+		size_t fill = rate - ctx->_buflen;
+		if (fill > size)
+			fill = size;
+		memcpy(ctx->_buf + ctx->_buflen, in, fill);
+		ctx->_buflen += fill;
+		in += fill;
+		size -= fill;
+		if (ctx->_buflen < rate)
+			return;
+		sha3_absorb_rounds(ctx->_st, ctx->_buf, rate, ctx->_rounds);
+		ctx->_buflen = 0;
 	}
 
-	/* Absorb */
-	for (int i = 0; i < bs_len(aux); i += blocksize) {
-		/* Copy one block to state */
-		for (int j = 0; j < r / w; j++) {
-			word_t i64;
-			bs_save(&i64, aux, 8, i + j * 8, 1);
-			int x = j % 5, y = j / 5;
-			st[x][y] ^= i64;
-		}
-		keccak_f(&st);
+	/* Absorb whole blocks straight from the input, the usual rates specialized */
+	if (ctx->_rounds == K12_RNDS)
+		for (; size >= SHAKE128_RATE; in += SHAKE128_RATE, size -= SHAKE128_RATE)
+			sha3_absorb_rounds(ctx->_st, in, SHAKE128_RATE, K12_RNDS);
+	else if (rate == SHAKE256_RATE)
+		for (; size >= SHAKE256_RATE; in += SHAKE256_RATE, size -= SHAKE256_RATE)
+			sha3_absorb(ctx->_st, in, SHAKE256_RATE);
+	else
+		for (; size >= rate; in += rate, size -= rate)
+			sha3_absorb(ctx->_st, in, rate);
+
+	/* Keep the tail for the next call */
+	memcpy(ctx->_buf, in, size);
+	ctx->_buflen = size;
+}
+
+void sha3_final(bytestream_t hash, sha3_ctx_t ctx) {
+	size_t outlen = ctx->_len / 8;
+	if (hash[0]->_avail < outlen)
+		_bs_update(hash, outlen);
+	sha3_final_b(hash[0]->_data, ctx);
+	hash[0]->_len = outlen;
+}
+
+void sha3_final_b(byte_t *out, sha3_ctx_t ctx) {
+	sha3_absorb_last(ctx->_st, ctx->_buf, ctx->_buflen, ctx->_rate, ctx->_pad, ctx->_rounds);
+	sha3_output(ctx->_st, out, ctx->_len / 8, ctx->_rate, 0, ctx->_rounds);
+
+	memset(ctx->_st, 0, sizeof(state_t));
+	ctx->_buflen = 0;
+}
+
+void sha3_save(char * const filepath, sha3_ctx_t const ctx) {
+	FILE *file = fopen(filepath, "wb");
+	if (!file) {
+		fprintf(stderr, "Could not open \"%s\" for writting\n", filepath);
+		exit(EXIT_FAILURE);
 	}
 
-	/* Squeeze */
-	bs_set_b(aux, aux, 0);
-	bs_set_b(hash, hash, 0);
-	int off = 0;
-	while (bs_len(hash) < len / 8) {
-		int fill =
-			sizeof(word_t) + bs_len(hash) > len / 8 ?
-			len / 8 - bs_len(hash) :
-			sizeof(word_t);
-		bs_set_b(aux, &st[off % 5][off / 5], fill);
-		bs_concat(hash, hash, aux);
-		if (++off == 25) {
-			off = 0;
-			keccak_f(&st);
-		}
+	/* Write parameters */
+	word_t field = ctx->_len;
+	fwrite(&field, sizeof(word_t), 1, file);
+	field = ctx->_rate;
+	fwrite(&field, sizeof(word_t), 1, file);
+	field = ctx->_pad;
+	fwrite(&field, sizeof(word_t), 1, file);
+
+	/* Write lanes */
+	fwrite(ctx->_st, sizeof(word_t), 25, file);
+
+	/* Write absorbed length and partial block */
+	field = ctx->_absorbed;
+	fwrite(&field, sizeof(word_t), 1, file);
+	field = ctx->_buflen;
+	fwrite(&field, sizeof(word_t), 1, file);
+	fwrite(ctx->_buf, 1, ctx->_buflen, file);
+
+	fclose(file);
+}
+
+void sha3_load(sha3_ctx_t ctx, char * const filepath) {
+	FILE *file = fopen(filepath, "rb");
+	if (!file) {
+		fprintf(stderr, "Could not open \"%s\" for reading\n", filepath);
+		exit(EXIT_FAILURE);
+	}
+
+	word_t len, rate, pad, absorbed, buflen;
+	int ok =
+		fread(&len, sizeof(word_t), 1, file) == 1 &&
+		fread(&rate, sizeof(word_t), 1, file) == 1 &&
+		fread(&pad, sizeof(word_t), 1, file) == 1 &&
+		fread(ctx->_st, sizeof(word_t), 25, file) == 25 &&
+		fread(&absorbed, sizeof(word_t), 1, file) == 1 &&
+		fread(&buflen, sizeof(word_t), 1, file) == 1 &&
+		(pad == SHA3_PAD ? rate == SHA3_RATE(len) : (pad == SHAKE_PAD || pad == CSHAKE_PAD) && rate == SHAKE256_RATE) &&
+		buflen < rate &&
+		fread(ctx->_buf, 1, buflen, file) == buflen;
+	fclose(file);
+
+	if (!ok) {
+		fprintf(stderr, "Invalid SHA3 state \"%s\"\n", filepath);
+		exit(EXIT_FAILURE);
 	}
 
+	ctx->_len = len;
+	ctx->_rate = rate;
+	ctx->_pad = pad;
+	ctx->_rounds = SHA3_RNDS;
+	ctx->_absorbed = absorbed;
+	ctx->_buflen = buflen;
+}
+
+void sha3(bytestream_t hash, bytestream_t const msg, size_t len) {
+	sha3_view(hash, bs_view(msg), len);
+}
 
-	bs_clear(aux);
-	state_clear(&st);
+void sha3_view(bytestream_t hash, bs_view_t msg, size_t len) {
+	sha3_ctx_t ctx;
+	sha3_init(ctx, len);
+	sha3_update(ctx, msg.data, msg.len);
+	sha3_final(hash, ctx);
 }
@@ -0,0 +1,375 @@
+#include "../include/sha3.h"
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SHA3_XN_SIMD
+#include <immintrin.h>
+#endif
+
+/**
+ * 	Multi-buffer state layout
+ *
+ * 	A group of W states is interleaved lane by lane: lane j of state k is
+ * 	stored at index j * W + k, so one vector load fetches lane j of every
+ * 	state in the group.
+ */
+typedef void (*permute_t)(word_t *st);
+
+/* Declare the lanes used by KECCAK_ROUND */
+#define KECCAK_LANES(T) \
+	T a00, a10, a20, a30, a40, a01, a11, a21, a31, a41, a02, a12, a22, a32, a42, \
+		a03, a13, a23, a33, a43, a04, a14, a24, a34, a44; \
+	T b00, b10, b20, b30, b40, b01, b11, b21, b31, b41, b02, b12, b22, b32, b42, \
+		b03, b13, b23, b33, b43, b04, b14, b24, b34, b44; \
+	T c0, c1, c2, c3, c4, d0, d1, d2, d3, d4
+
+/* Load (and store) all lanes of an interleaved state with LD(lane index) */
+#define KECCAK_LOAD(LD) \
+	a00 = LD(0); a10 = LD(1); a20 = LD(2); a30 = LD(3); a40 = LD(4); \
+	a01 = LD(5); a11 = LD(6); a21 = LD(7); a31 = LD(8); a41 = LD(9); \
+	a02 = LD(10); a12 = LD(11); a22 = LD(12); a32 = LD(13); a42 = LD(14); \
+	a03 = LD(15); a13 = LD(16); a23 = LD(17); a33 = LD(18); a43 = LD(19); \
+	a04 = LD(20); a14 = LD(21); a24 = LD(22); a34 = LD(23); a44 = LD(24)
+#define KECCAK_STORE(ST) \
+	ST(0, a00); ST(1, a10); ST(2, a20); ST(3, a30); ST(4, a40); \
+	ST(5, a01); ST(6, a11); ST(7, a21); ST(8, a31); ST(9, a41); \
+	ST(10, a02); ST(11, a12); ST(12, a22); ST(13, a32); ST(14, a42); \
+	ST(15, a03); ST(16, a13); ST(17, a23); ST(18, a33); ST(19, a43); \
+	ST(20, a04); ST(21, a14); ST(22, a24); ST(23, a34); ST(24, a44)
+
+/**
+ * 	One Keccak round without Iota, written over vector operations
+ * 	XOR(a, b): a ^ b
+ * 	ANDN(a, b): ~a & b
+ * 	ROL(a, n): rotate every 64-bit element of a left by n bits
+ */
+#define KECCAK_ROUND(XOR, ANDN, ROL) { \
+	/* Theta */ \
+	c0 = XOR(XOR(XOR(XOR(a00, a01), a02), a03), a04); \
+	c1 = XOR(XOR(XOR(XOR(a10, a11), a12), a13), a14); \
+	c2 = XOR(XOR(XOR(XOR(a20, a21), a22), a23), a24); \
+	c3 = XOR(XOR(XOR(XOR(a30, a31), a32), a33), a34); \
+	c4 = XOR(XOR(XOR(XOR(a40, a41), a42), a43), a44); \
+	d0 = XOR(c4, ROL(c1, 1)); \
+	d1 = XOR(c0, ROL(c2, 1)); \
+	d2 = XOR(c1, ROL(c3, 1)); \
+	d3 = XOR(c2, ROL(c4, 1)); \
+	d4 = XOR(c3, ROL(c0, 1)); \
+	/* Rho & Pi */ \
+	b00 = XOR(a00, d0); \
+	b13 = ROL(XOR(a01, d0), 36); \
+	b21 = ROL(XOR(a02, d0), 3); \
+	b34 = ROL(XOR(a03, d0), 41); \
+	b42 = ROL(XOR(a04, d0), 18); \
+	b02 = ROL(XOR(a10, d1), 1); \
+	b10 = ROL(XOR(a11, d1), 44); \
+	b23 = ROL(XOR(a12, d1), 10); \
+	b31 = ROL(XOR(a13, d1), 45); \
+	b44 = ROL(XOR(a14, d1), 2); \
+	b04 = ROL(XOR(a20, d2), 62); \
+	b12 = ROL(XOR(a21, d2), 6); \
+	b20 = ROL(XOR(a22, d2), 43); \
+	b33 = ROL(XOR(a23, d2), 15); \
+	b41 = ROL(XOR(a24, d2), 61); \
+	b01 = ROL(XOR(a30, d3), 28); \
+	b14 = ROL(XOR(a31, d3), 55); \
+	b22 = ROL(XOR(a32, d3), 25); \
+	b30 = ROL(XOR(a33, d3), 21); \
+	b43 = ROL(XOR(a34, d3), 56); \
+	b03 = ROL(XOR(a40, d4), 27); \
+	b11 = ROL(XOR(a41, d4), 20); \
+	b24 = ROL(XOR(a42, d4), 39); \
+	b32 = ROL(XOR(a43, d4), 8); \
+	b40 = ROL(XOR(a44, d4), 14); \
+	/* Chi */ \
+	a00 = XOR(b00, ANDN(b10, b20)); \
+	a10 = XOR(b10, ANDN(b20, b30)); \
+	a20 = XOR(b20, ANDN(b30, b40)); \
+	a30 = XOR(b30, ANDN(b40, b00)); \
+	a40 = XOR(b40, ANDN(b00, b10)); \
+	a01 = XOR(b01, ANDN(b11, b21)); \
+	a11 = XOR(b11, ANDN(b21, b31)); \
+	a21 = XOR(b21, ANDN(b31, b41)); \
+	a31 = XOR(b31, ANDN(b41, b01)); \
+	a41 = XOR(b41, ANDN(b01, b11)); \
+	a02 = XOR(b02, ANDN(b12, b22)); \
+	a12 = XOR(b12, ANDN(b22, b32)); \
+	a22 = XOR(b22, ANDN(b32, b42)); \
+	a32 = XOR(b32, ANDN(b42, b02)); \
+	a42 = XOR(b42, ANDN(b02, b12)); \
+	a03 = XOR(b03, ANDN(b13, b23)); \
+	a13 = XOR(b13, ANDN(b23, b33)); \
+	a23 = XOR(b23, ANDN(b33, b43)); \
+	a33 = XOR(b33, ANDN(b43, b03)); \
+	a43 = XOR(b43, ANDN(b03, b13)); \
+	a04 = XOR(b04, ANDN(b14, b24)); \
+	a14 = XOR(b14, ANDN(b24, b34)); \
+	a24 = XOR(b24, ANDN(b34, b44)); \
+	a34 = XOR(b34, ANDN(b44, b04)); \
+	a44 = XOR(b44, ANDN(b04, b14)); \
+}
+
+#ifdef SHA3_XN_SIMD
+#define AVX2_LD(j) _mm256_loadu_si256((__m256i *) (st + (j) * 4))
+#define AVX2_ST(j, v) _mm256_storeu_si256((__m256i *) (st + (j) * 4), v)
+#define AVX2_ROL(a, n) _mm256_or_si256(_mm256_slli_epi64(a, n), _mm256_srli_epi64(a, 64 - (n)))
+
+/**
+ * 	Keccak-p rounds `first` to SHA3_RNDS - 1 on 4 interleaved states
+ */
+__attribute__((target("avx2")))
+static void keccak_rounds_x4(word_t *st, int first) {
+	KECCAK_LANES(__m256i);
+
+	KECCAK_LOAD(AVX2_LD);
+	for (int r = first; r < SHA3_RNDS; r++) {
+		KECCAK_ROUND(_mm256_xor_si256, _mm256_andnot_si256, AVX2_ROL);
+		a00 = _mm256_xor_si256(a00, _mm256_set1_epi64x(keccak_rc[r]));
+	}
+	KECCAK_STORE(AVX2_ST);
+}
+
+__attribute__((target("avx2")))
+static void keccak_f_x4(word_t *st) {
+	keccak_rounds_x4(st, 0);
+}
+
+__attribute__((target("avx2")))
+static void keccak_p12_x4(word_t *st) {
+	keccak_rounds_x4(st, SHA3_RNDS - K12_RNDS);
+}
+
+#define AVX512_LD(j) _mm512_loadu_si512(st + (j) * 8)
+#define AVX512_ST(j, v) _mm512_storeu_si512(st + (j) * 8, v)
+
+/**
+ * 	Keccak-p rounds `first` to SHA3_RNDS - 1 on 8 interleaved states
+ */
+__attribute__((target("avx512f")))
+static void keccak_rounds_x8(word_t *st, int first) {
+	KECCAK_LANES(__m512i);
+
+	KECCAK_LOAD(AVX512_LD);
+	for (int r = first; r < SHA3_RNDS; r++) {
+		KECCAK_ROUND(_mm512_xor_si512, _mm512_andnot_si512, _mm512_rol_epi64);
+		a00 = _mm512_xor_si512(a00, _mm512_set1_epi64(keccak_rc[r]));
+	}
+	KECCAK_STORE(AVX512_ST);
+}
+
+__attribute__((target("avx512f")))
+static void keccak_f_x8(word_t *st) {
+	keccak_rounds_x8(st, 0);
+}
+
+__attribute__((target("avx512f")))
+static void keccak_p12_x8(word_t *st) {
+	keccak_rounds_x8(st, SHA3_RNDS - K12_RNDS);
+}
+#endif
+
+/**
+ * 	Pick the widest kernel the CPU supports for `rounds` rounds, SHA3_RNDS
+ * 	or K12_RNDS
+ */
+static permute_t sha3_xn_kernel(int *lanes, int rounds) {
+#ifdef SHA3_XN_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		*lanes = 8;
+		return rounds == K12_RNDS ? keccak_p12_x8 : keccak_f_x8;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		*lanes = 4;
+		return rounds == K12_RNDS ? keccak_p12_x4 : keccak_f_x4;
+	}
+#endif
+	*lanes = 1;
+	return rounds == K12_RNDS ? keccak_p12 : keccak_f;
+}
+
+int sha3_xn_lanes() {
+	int lanes;
+	sha3_xn_kernel(&lanes, SHA3_RNDS);
+	return lanes;
+}
+
+/* Message index ordered by length */
+typedef struct {
+	size_t len;
+	size_t i;
+} sha3_xn_item_t;
+
+static int sha3_xn_cmp(const void *a, const void *b) {
+	size_t la = ((const sha3_xn_item_t *) a)->len, lb = ((const sha3_xn_item_t *) b)->len;
+	return (la > lb) - (la < lb);
+}
+
+/**
+ * 	Hash up to `lanes` messages with one interleaved state, with a sponge
+ * 	of `rate` bytes and domain padding `pad`, every lane starting from
+ * 	`init`, or zero if it is NULL
+ *
+ * 	Every state keeps being permuted until the longest message of the group
+ * 	is done. Once a state has absorbed its padded tail, those permutations
+ * 	are exactly its squeeze steps, so it reads its output blocks from them,
+ * 	written or XORed into its output if `xor` is set.
+ */
+static void sha3_xn_group(
+	byte_t **outs, bs_view_t *msgs, sha3_xn_item_t *items,
+	int n, size_t len, size_t rate, byte_t pad, const word_t *init, permute_t permute, int lanes, int xor
+) {
+	const size_t outlen = len / 8,
+		outblocks = outlen ? (outlen + rate - 1) / rate : 1;
+
+	word_t st[25 * SHA3_XN_MAXLANES];
+	byte_t tail[SHA3_XN_MAXLANES][SHA3_B / 8];
+	const byte_t *data[SHA3_XN_MAXLANES];
+	byte_t *out[SHA3_XN_MAXLANES];
+	size_t full[SHA3_XN_MAXLANES], steps = 0;
+
+	memset(st, 0, sizeof(word_t) * 25 * lanes);
+	if (init)
+		for (int j = 0; j < 25; j++)
+			for (int k = 0; k < lanes; k++)
+				st[j * lanes + k] = init[j];
+	for (int k = 0; k < n; k++) {
+		size_t i = items[k].i, tlen = items[k].len % rate;
+
+		data[k] = msgs[i].data;
+		out[k] = outs[i];
+
+		/* Pad the tail into its own block */
+		full[k] = items[k].len / rate;
+		memset(tail[k], 0, rate);
+		memcpy(tail[k], data[k] + full[k] * rate, tlen);
+		tail[k][tlen] ^= pad;
+		tail[k][rate - 1] ^= 0x80;
+
+		if (full[k] + outblocks > steps)
+			steps = full[k] + outblocks;
+	}
+
+	for (size_t b = 0; b < steps; b++) {
+		/* Absorb */
+		for (int k = 0; k < n; k++) {
+			const byte_t *block =
+				b < full[k] ? data[k] + b * rate : b == full[k] ? tail[k] : NULL;
+			if (!block)
+				continue;
+			for (int j = 0; j < rate / sizeof(word_t); j++) {
+				word_t i64;
+				memcpy(&i64, block + j * sizeof(word_t), sizeof(word_t));
+				st[j * lanes + k] ^= i64;
+			}
+		}
+
+		permute(st);
+
+		/* Squeeze */
+		for (int k = 0; k < n; k++) {
+			if (b < full[k] || b - full[k] >= outblocks)
+				continue;
+			size_t off = (b - full[k]) * rate,
+				fill = outlen - off > rate ? rate : outlen - off;
+			for (int j = 0; j * sizeof(word_t) < fill; j++) {
+				size_t m = fill - j * sizeof(word_t);
+				byte_t *dst = out[k] + off + j * sizeof(word_t), lane[sizeof(word_t)];
+				if (m > sizeof(word_t))
+					m = sizeof(word_t);
+				if (!xor) {
+					memcpy(dst, &st[j * lanes + k], m);
+					continue;
+				}
+				memcpy(lane, &st[j * lanes + k], sizeof(word_t));
+				for (size_t q = 0; q < m; q++)
+					dst[q] ^= lane[q];
+			}
+		}
+	}
+}
+
+/**
+ * 	Write, or XOR if `xor` is set, the hashes of `count` views into
+ * 	`outs`, a lane group at a time, permuting with `rounds` rounds
+ */
+static void sha3_xn_run(byte_t **outs, bs_view_t *msgs, size_t count, size_t len, size_t rate, byte_t pad, const word_t *init, int rounds, int xor) {
+	int lanes;
+	permute_t permute = sha3_xn_kernel(&lanes, rounds);
+
+	/* Group messages of similar length so lanes finish together */
+	sha3_xn_item_t *items = malloc(sizeof(sha3_xn_item_t) * count);
+	for (size_t i = 0; i < count; i++) {
+		items[i].len = msgs[i].len;
+		items[i].i = i;
+	}
+	qsort(items, count, sizeof(sha3_xn_item_t), sha3_xn_cmp);
+
+	for (size_t i = 0; i < count; i += lanes)
+		sha3_xn_group(outs, msgs, items + i,
+			count - i < lanes ? count - i : lanes, len, rate, pad, init, permute, lanes, xor);
+
+	free(items);
+}
+
+/**
+ * 	Hash `count` views into bytestreams, see `sha3_xn_run`
+ */
+static void sha3_xn_hash(bytestream_t *hashes, bs_view_t *msgs, size_t count, size_t len, size_t rate, byte_t pad, const word_t *init) {
+	byte_t **outs = malloc(sizeof(byte_t *) * count);
+	for (size_t i = 0; i < count; i++) {
+		if (hashes[i][0]->_avail < len / 8)
+			_bs_update(hashes[i], len / 8);
+		outs[i] = hashes[i][0]->_data;
+	}
+
+	sha3_xn_run(outs, msgs, count, len, rate, pad, init, SHA3_RNDS, 0);
+
+	for (size_t i = 0; i < count; i++)
+		hashes[i][0]->_len = len / 8;
+	free(outs);
+}
+
+/**
+ * 	Hash `count` bytestreams, see `sha3_xn_hash`
+ */
+static void sha3_xn_bs(bytestream_t *hashes, bytestream_t *msgs, size_t count, size_t len, size_t rate, byte_t pad, const word_t *init) {
+	/* Grow the outputs first, they may be the messages themselves */
+	bs_view_t *views = malloc(sizeof(bs_view_t) * count);
+	for (size_t i = 0; i < count; i++) {
+		if (hashes[i][0]->_avail < len / 8)
+			_bs_update(hashes[i], len / 8);
+		views[i] = bs_view(msgs[i]);
+	}
+
+	sha3_xn_hash(hashes, views, count, len, rate, pad, init);
+
+	free(views);
+}
+
+void sha3_xn(bytestream_t *hashes, bytestream_t *msgs, size_t count, size_t len) {
+	sha3_xn_bs(hashes, msgs, count, len, SHA3_RATE(len), SHA3_PAD, NULL);
+}
+
+void sha3_xn_view(bytestream_t *hashes, bs_view_t *msgs, size_t count, size_t len) {
+	sha3_xn_hash(hashes, msgs, count, len, SHA3_RATE(len), SHA3_PAD, NULL);
+}
+
+void shake256_xn(bytestream_t *hashes, bytestream_t *msgs, size_t count, size_t len) {
+	sha3_xn_bs(hashes, msgs, count, len, SHAKE256_RATE, SHAKE_PAD, NULL);
+}
+
+void cshake256_xn(bytestream_t *hashes, bytestream_t *msgs, size_t count, size_t len, bs_view_t custom) {
+	/* Every lane starts from the state after the customization block */
+	sha3_ctx_t ctx;
+	cshake256_init(ctx, len, custom);
+	sha3_xn_bs(hashes, msgs, count, len, SHAKE256_RATE, ctx->_pad, ctx->_st);
+}
+
+void shake256_xn_mask(byte_t **outs, bs_view_t *msgs, size_t count, size_t len) {
+	sha3_xn_run(outs, msgs, count, len, SHAKE256_RATE, SHAKE_PAD, NULL, SHA3_RNDS, 1);
+}
+
+void turboshake128_xn(byte_t **outs, bs_view_t *msgs, size_t count, size_t len, byte_t pad) {
+	sha3_xn_run(outs, msgs, count, len, SHAKE128_RATE, pad, NULL, K12_RNDS, 0);
+}
@@ -0,0 +1,125 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/signtree.h"
+#include "../include/pool.h"
+#include "../include/arena.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * 	Directory to list or file to sign
+ */
+typedef struct _signtree_task_t {
+	int dir; /* Whether `path` is a directory */
+	char path[]; /* Path */
+} signtree_task_t;
+
+/**
+ * 	State of a signing run
+ */
+typedef struct _signtree_run_t {
+	rsa_key_t key; /* Key shared by the workers */
+	rsa_ctx_t *ctxs; /* Key context of every worker */
+	char *ready; /* Whether each context is initialized */
+	size_t *nsigned; /* Files signed by every worker */
+} signtree_run_t;
+
+/**
+ * 	New task for `name` in directory `dir`, or for `dir` itself if NULL
+ */
+static signtree_task_t *signtree_task(char const *dir, char const *name, int isdir) {
+	size_t len = strlen(dir) + (name ? strlen(name) + 1 : 0);
+	signtree_task_t *task = malloc(sizeof(signtree_task_t) + len + 1);
+	task->dir = isdir;
+	strcpy(task->path, dir);
+	if (name) {
+		strcat(task->path, "/");
+		strcat(task->path, name);
+	}
+	return task;
+}
+
+/**
+ * 	Whether a path ends with SIGNSUFFIX
+ */
+static int signtree_is_sign(char const *path) {
+	size_t len = strlen(path), suffix = strlen(SIGNSUFFIX);
+	return len >= suffix && !strcmp(path + len - suffix, SIGNSUFFIX);
+}
+
+/**
+ * 	Push a task for every directory and file to sign in a directory
+ */
+static void signtree_list(struct _pool_steal_t *pool, int worker, char * const dirpath) {
+	DIR *dir = opendir(dirpath);
+	if (!dir) {
+		fprintf(stderr, "Could not open directory \"%s\"\n", dirpath);
+		exit(EXIT_FAILURE);
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir))) {
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+			continue;
+
+		signtree_task_t *task = signtree_task(dirpath, entry->d_name, 0);
+		struct stat st;
+		if (lstat(task->path, &st)) {
+			fprintf(stderr, "Could not stat \"%s\"\n", task->path);
+			exit(EXIT_FAILURE);
+		}
+
+		task->dir = S_ISDIR(st.st_mode);
+		if (task->dir || (S_ISREG(st.st_mode) && !signtree_is_sign(task->path)))
+			pool_push(pool, worker, task);
+		else
+			free(task);
+	}
+
+	closedir(dir);
+}
+
+/**
+ * 	List a directory or sign a file with the context of a worker
+ */
+static void signtree_run(struct _pool_steal_t *pool, void *arg, void *ptr, int worker) {
+	signtree_run_t *run = arg;
+	signtree_task_t *task = ptr;
+
+	if (task->dir) {
+		signtree_list(pool, worker, task->path);
+	} else {
+		if (!run->ready[worker]) {
+			rsa_ctx_init(run->ctxs[worker], run->key);
+			run->ready[worker] = 1;
+		}
+		arena_begin();
+		rsa_sign_file_ctx(task->path, task->path, run->ctxs[worker]);
+		arena_end();
+		run->nsigned[worker]++;
+	}
+
+	free(task);
+}
+
+size_t signtree_sign(char * const dirpath, rsa_key_t const key, int threads) {
+	signtree_run_t run = {key, malloc(threads * sizeof(rsa_ctx_t)), calloc(threads, 1), calloc(threads, sizeof(size_t))};
+
+	void *root = signtree_task(dirpath, NULL, 1);
+	pool_steal_run(signtree_run, &run, &root, 1, threads);
+
+	/* Clear */
+	size_t count = 0;
+	for (int i = 0; i < threads; i++) {
+		if (run.ready[i])
+			rsa_ctx_clear(run.ctxs[i]);
+		count += run.nsigned[i];
+	}
+	free(run.ctxs);
+	free(run.ready);
+	free(run.nsigned);
+
+	return count;
+}
@@ -0,0 +1,123 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/treehash.h"
+#include "../include/sha3.h"
+#include "../include/pool.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Threads of `treehash_file`, 0 for `pool_threads()` */
+static int treehash_nthreads = 0;
+
+/**
+ * 	State of a tree hashing run
+ */
+typedef struct _treehash_run_t {
+	char *path; /* File path */
+	size_t size; /* File size */
+	size_t leafsize; /* Leaf size */
+	byte_t *leaves; /* Digest of every leaf */
+	int *fds; /* File descriptor of every worker, -1 until opened */
+	byte_t **bufs; /* Read buffer of every worker */
+} treehash_run_t;
+
+int treehash_threads() {
+	return treehash_nthreads ? treehash_nthreads : pool_threads();
+}
+
+void treehash_set_threads(int threads) {
+	treehash_nthreads = threads;
+}
+
+/**
+ * 	Open a file for reading or exit
+ */
+static int treehash_open(char * const filepath) {
+	int fd = open(filepath, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Could not open \"%s\" for reading\n", filepath);
+		exit(EXIT_FAILURE);
+	}
+	return fd;
+}
+
+/**
+ * 	Hash a leaf with the file descriptor and buffer of a worker
+ */
+static void treehash_leaf(void *arg, size_t item, int worker) {
+	treehash_run_t *run = arg;
+	if (run->fds[worker] < 0) {
+		run->fds[worker] = treehash_open(run->path);
+		run->bufs[worker] = malloc(TREEHASH_BUFSIZE);
+	}
+	int fd = run->fds[worker];
+	byte_t *buf = run->bufs[worker];
+
+	off_t off = (off_t) item * run->leafsize;
+	size_t left = run->size - off < run->leafsize ? run->size - off : run->leafsize;
+	posix_fadvise(fd, off, left, POSIX_FADV_SEQUENTIAL);
+
+	sha3_ctx_t ctx;
+	shake256_init(ctx, TREEHASH_LEAFLEN * 8);
+	while (left) {
+		ssize_t got = pread(fd, buf, left < TREEHASH_BUFSIZE ? left : TREEHASH_BUFSIZE, off);
+		if (got <= 0) {
+			fprintf(stderr, "Could not read \"%s\"\n", run->path);
+			exit(EXIT_FAILURE);
+		}
+		sha3_update(ctx, buf, got);
+		off += got;
+		left -= got;
+	}
+	sha3_final_b(run->leaves + item * TREEHASH_LEAFLEN, ctx);
+}
+
+void treehash_file(bytestream_t hash, char * const filepath, size_t leafsize, size_t len) {
+	if (leafsize < TREEHASH_MINLEAF) {
+		fprintf(stderr, "Leaf size must be at least %d bytes\n", TREEHASH_MINLEAF);
+		exit(EXIT_FAILURE);
+	}
+
+	int fd = treehash_open(filepath);
+	struct stat st;
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+		fprintf(stderr, "Tree hashing needs a regular file, \"%s\" is not\n", filepath);
+		exit(EXIT_FAILURE);
+	}
+	close(fd);
+
+	int threads = treehash_threads();
+	size_t count = st.st_size ? (st.st_size + leafsize - 1) / leafsize : 1;
+	treehash_run_t run = {filepath, st.st_size, leafsize, malloc(count * TREEHASH_LEAFLEN),
+		malloc(threads * sizeof(int)), calloc(threads, sizeof(byte_t *))};
+	for (int i = 0; i < threads; i++)
+		run.fds[i] = -1;
+
+	/* Leaves */
+	pool_run(treehash_leaf, &run, count, threads);
+
+	/* Root over the sizes and the leaf digests */
+	byte_t sizes[16];
+	for (int k = 0; k < 8; k++) {
+		sizes[k] = (word_t) leafsize >> (8 * k);
+		sizes[8 + k] = (word_t) run.size >> (8 * k);
+	}
+	sha3_ctx_t ctx;
+	cshake256_init(ctx, len, bs_view_b((byte_t *) TREEHASH_CUSTOM, strlen(TREEHASH_CUSTOM)));
+	sha3_update(ctx, sizes, sizeof(sizes));
+	sha3_update(ctx, run.leaves, count * TREEHASH_LEAFLEN);
+	sha3_final(hash, ctx);
+
+	/* Clear */
+	for (int i = 0; i < threads; i++) {
+		if (run.fds[i] >= 0)
+			close(run.fds[i]);
+		free(run.bufs[i]);
+	}
+	free(run.fds);
+	free(run.bufs);
+	free(run.leaves);
+}
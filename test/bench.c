@@ -0,0 +1,548 @@
+#define _POSIX_C_SOURCE 200112L
+#include <gmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../include/arena.h"
+#include "../include/input.h"
+#include "../include/mont.h"
+#include "../include/rsa.h"
+#include "../include/sha3.h"
+#include "../include/pool.h"
+#include "../include/treehash.h"
+#include "../include/k12.h"
+#include "../include/chunkidx.h"
+
+/* Bytes hashed per sha3 benchmark run */
+#define SHA3_BENCH_SIZE (64 << 20)
+
+/* Masks per OAEP mask benchmark run */
+#define SHA3_MASK_BENCH_COUNT 200000
+
+/* Messages and message size for the multi-buffer benchmark */
+#define SHA3_XN_BENCH_COUNT 20000
+#define SHA3_XN_BENCH_SIZE 512
+
+/* Signatures per sign benchmark run */
+#define SIGN_BENCH_COUNT 200
+
+/* Exponentiations per powm benchmark run and modulo sizes in bits */
+#define POWM_BENCH_COUNT 20
+static const int powm_bench_bits[] = {1024, 2048, 3072, 4096};
+
+/* Verifications per verify benchmark run */
+#define VERIFY_BENCH_COUNT 20000
+
+/* Bytes of the file read per input benchmark run */
+#define INPUT_BENCH_SIZE (256 << 20)
+#define INPUT_BENCH_PATH "bench_input.tmp"
+
+/* Leaf size of the tree hashing benchmark, on a file like the input one */
+#define TREEHASH_BENCH_LEAF (1 << 20)
+
+/* Bytes of a checked range and ranges per chunk index benchmark run */
+#define CHUNKIDX_BENCH_RANGE (64 << 10)
+#define CHUNKIDX_BENCH_COUNT 100
+
+/* Operations per arena benchmark run, after as many to warm up */
+#define ARENA_BENCH_COUNT 2000
+
+/* Messages per batch benchmark run */
+#define BATCH_BENCH_COUNT 4096
+
+/* Seconds elapsed since `start` */
+static double elapsed(struct timespec *start) {
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void bench_sha3() {
+	bytestream_t msg, hash;
+	bs_init_size(msg, SHA3_BENCH_SIZE);
+	bs_init(hash);
+	bs_concat_zero(msg, msg, SHA3_BENCH_SIZE);
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	sha3(hash, msg, BITLEN);
+	double t = elapsed(&start);
+	printf("sha3: %.1f MB/s\n", SHA3_BENCH_SIZE / t / 1e6);
+
+	/* Fixed-parameter functions, squeezing 128 bytes like the signatures */
+	byte_t out[BITLEN / 8];
+	bs_view_t view = bs_view(msg);
+	const char *names[] = {"sha3_224", "sha3_256", "sha3_384", "sha3_512", "shake128", "shake256"};
+	for (int f = 0; f < 6; f++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		switch (f) {
+			case 0: sha3_224(out, view); break;
+			case 1: sha3_256(out, view); break;
+			case 2: sha3_384(out, view); break;
+			case 3: sha3_512(out, view); break;
+			case 4: shake128(out, sizeof(out), view); break;
+			case 5: shake256(out, sizeof(out), view); break;
+		}
+		t = elapsed(&start);
+		printf("%s: %.1f MB/s\n", names[f], SHA3_BENCH_SIZE / t / 1e6);
+	}
+
+	/* KangarooTwelve, chunks hashed in SIMD lanes */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	k12(hash, view, bs_view_b(NULL, 0), BITLEN);
+	t = elapsed(&start);
+	printf("k12, %d lanes: %.1f MB/s\n", sha3_xn_lanes(), SHA3_BENCH_SIZE / t / 1e6);
+
+	/* OAEP mask of the message part from the seed, generic and fixed */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < SHA3_MASK_BENCH_COUNT; i++)
+		sha3_view(hash, bs_view_b(out + i % 64, OAEP_RLEN), BITLEN - OAEP_K0);
+	t = elapsed(&start);
+	printf("sha3_view, OAEP mask: %.0f ns\n", t / SHA3_MASK_BENCH_COUNT * 1e9);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < SHA3_MASK_BENCH_COUNT; i++)
+		shake256_mask(out, OAEP_MSGLEN, bs_view_b(out + OAEP_MSGLEN, OAEP_RLEN));
+	t = elapsed(&start);
+	printf("shake256_mask, OAEP mask: %.0f ns\n", t / SHA3_MASK_BENCH_COUNT * 1e9);
+
+	bs_clear(msg);
+	bs_clear(hash);
+}
+
+static void bench_sha3_xn() {
+	bytestream_t *msgs = malloc(sizeof(bytestream_t) * SHA3_XN_BENCH_COUNT),
+		*hashes = malloc(sizeof(bytestream_t) * SHA3_XN_BENCH_COUNT);
+	for (int i = 0; i < SHA3_XN_BENCH_COUNT; i++) {
+		bs_init_size(msgs[i], SHA3_XN_BENCH_SIZE);
+		bs_concat_zero(msgs[i], msgs[i], SHA3_XN_BENCH_SIZE - i % 64);
+		bs_init(hashes[i]);
+	}
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < SHA3_XN_BENCH_COUNT; i++)
+		sha3(hashes[i], msgs[i], BITLEN);
+	double t = elapsed(&start);
+	printf("sha3, one at a time: %.0f msgs/s\n", SHA3_XN_BENCH_COUNT / t);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	sha3_xn(hashes, msgs, SHA3_XN_BENCH_COUNT, BITLEN);
+	t = elapsed(&start);
+	printf("sha3_xn, %d lanes: %.0f msgs/s\n", sha3_xn_lanes(), SHA3_XN_BENCH_COUNT / t);
+
+	for (int i = 0; i < SHA3_XN_BENCH_COUNT; i++) {
+		bs_clear(msgs[i]);
+		bs_clear(hashes[i]);
+	}
+	free(msgs);
+	free(hashes);
+}
+
+/* Average rsa_sign latency with `key` in microseconds */
+static double bench_sign_key(bytestream_t sign, bytestream_t const msg, rsa_key_t const key) {
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < SIGN_BENCH_COUNT; i++)
+		rsa_sign(sign, msg, key);
+	return elapsed(&start) / SIGN_BENCH_COUNT * 1e6;
+}
+
+/* Average rsa_sign_ctx latency with `key` in microseconds, one context for all */
+static double bench_sign_ctx(bytestream_t sign, bytestream_t const msg, rsa_key_t const key) {
+	struct timespec start;
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, key);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < SIGN_BENCH_COUNT; i++)
+		rsa_sign_ctx(sign, msg, ctx);
+	double t = elapsed(&start) / SIGN_BENCH_COUNT * 1e6;
+	rsa_ctx_clear(ctx);
+	return t;
+}
+
+static void bench_sign() {
+	bytestream_t msg, sign, crt_sign;
+	bs_init(msg);
+	bs_init(sign);
+	bs_init(crt_sign);
+	bs_set_b(msg, "abc", 3);
+
+	for (int nprimes = 2; nprimes <= MAXPRIMES; nprimes++) {
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		keypair_t keys = rsa_gen_keypair_primes(nprimes);
+		double t = elapsed(&start) * 1e3;
+		printf("rsa_gen_keypair, %d primes: %.0f ms\n", nprimes, t);
+
+		t = bench_sign_key(crt_sign, msg, keys.sk);
+		printf("rsa_sign, %d primes: %.0f us\n", nprimes, t);
+		t = bench_sign_ctx(crt_sign, msg, keys.sk);
+		printf("rsa_sign_ctx, %d primes: %.0f us\n", nprimes, t);
+
+		/* Same key without its prime factors */
+		keys.sk.nprimes = 0;
+		t = bench_sign_key(sign, msg, keys.sk);
+		printf("rsa_sign, %d primes, no CRT: %.0f us\n", nprimes, t);
+		t = bench_sign_ctx(sign, msg, keys.sk);
+		printf("rsa_sign_ctx, %d primes, no CRT: %.0f us\n", nprimes, t);
+		keys.sk.nprimes = nprimes;
+
+		if (bs_len(sign) != bs_len(crt_sign) || memcmp(sign[0]->_data, crt_sign[0]->_data, bs_len(sign)))
+			printf("rsa_sign: CRT signature differs\n");
+
+		rsa_clear_keys(keys);
+	}
+
+	bs_clear(msg);
+	bs_clear(sign);
+	bs_clear(crt_sign);
+}
+
+static void bench_powm() {
+	gmp_randstate_t rs;
+	gmp_randinit_default(rs);
+	mpz_t mod, exp, base, r1, r2, r3;
+	mpz_inits(mod, exp, base, r1, r2, r3, NULL);
+
+	for (size_t b = 0; b < sizeof(powm_bench_bits) / sizeof(*powm_bench_bits); b++) {
+		int bits = powm_bench_bits[b];
+		mpz_urandomb(mod, rs, bits);
+		mpz_setbit(mod, bits - 1);
+		mpz_setbit(mod, 0);
+		mpz_urandomb(exp, rs, bits);
+		mpz_setbit(exp, bits - 1);
+		mpz_urandomb(base, rs, bits - 1);
+
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int i = 0; i < POWM_BENCH_COUNT; i++)
+			mpz_powm_sec(r1, base, exp, mod);
+		double t = elapsed(&start) / POWM_BENCH_COUNT * 1e6;
+		printf("mpz_powm_sec, %d bits: %.0f us\n", bits, t);
+
+		/* mpn_sec_powm with its scratch allocated once */
+		mp_size_t n = mpz_size(mod);
+		mp_limb_t *scratch = malloc(mpn_sec_powm_itch(n, bits, n) * sizeof(mp_limb_t));
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int i = 0; i < POWM_BENCH_COUNT; i++) {
+			mpn_sec_powm(mpz_limbs_write(r2, n), mpz_limbs_read(base), n, mpz_limbs_read(exp), bits, mpz_limbs_read(mod), n, scratch);
+			mpz_limbs_finish(r2, n);
+		}
+		t = elapsed(&start) / POWM_BENCH_COUNT * 1e6;
+		printf("mpn_sec_powm, %d bits: %.0f us\n", bits, t);
+		free(scratch);
+
+		mont_t m;
+		mont_init(m, mod, exp);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int i = 0; i < POWM_BENCH_COUNT; i++)
+			mont_powm_sec(r3, base, m);
+		t = elapsed(&start) / POWM_BENCH_COUNT * 1e6;
+		printf("mont_powm_sec, %d bits: %.0f us\n", bits, t);
+		mont_clear(m);
+
+		if (mpz_cmp(r1, r2) || mpz_cmp(r1, r3))
+			printf("powm, %d bits: results differ\n", bits);
+	}
+
+	mpz_clears(mod, exp, base, r1, r2, r3, NULL);
+	gmp_randclear(rs);
+}
+
+static void bench_verify() {
+	keypair_t keys = rsa_gen_keypair();
+	bytestream_t msg, sign;
+	bs_init(msg);
+	bs_init(sign);
+	bs_set_b(msg, "abc", 3);
+	rsa_sign(sign, msg, keys.sk);
+
+	/* Public exponentiation alone, as done before key contexts */
+	mpz_t h;
+	mpz_init(h);
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < VERIFY_BENCH_COUNT; i++) {
+		mpz_set_bs(h, sign);
+		mpz_powm_sec(h, h, keys.pk.exp, keys.pk.mod);
+	}
+	double t = elapsed(&start) / VERIFY_BENCH_COUNT * 1e6;
+	printf("mpz_powm_sec, public key: %.1f us\n", t);
+
+	int valid = 1;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < VERIFY_BENCH_COUNT; i++)
+		valid &= rsa_verify(sign, msg, keys.pk);
+	t = elapsed(&start) / VERIFY_BENCH_COUNT * 1e6;
+	printf("rsa_verify: %.1f us\n", t);
+
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, keys.pk);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < VERIFY_BENCH_COUNT; i++)
+		valid &= rsa_verify_ctx(sign, msg, ctx);
+	t = elapsed(&start) / VERIFY_BENCH_COUNT * 1e6;
+	printf("rsa_verify_ctx: %.1f us\n", t);
+	rsa_ctx_clear(ctx);
+
+	if (!valid)
+		printf("rsa_verify: signature rejected\n");
+
+	mpz_clear(h);
+	bs_clear(msg);
+	bs_clear(sign);
+	rsa_clear_keys(keys);
+}
+
+static void bench_batch() {
+	keypair_t keys = rsa_gen_keypair();
+	bytestream_t *msgs = malloc(sizeof(bytestream_t) * BATCH_BENCH_COUNT),
+		*signs = malloc(sizeof(bytestream_t) * BATCH_BENCH_COUNT),
+		*ciphers = malloc(sizeof(bytestream_t) * BATCH_BENCH_COUNT);
+	int *valid = malloc(sizeof(int) * BATCH_BENCH_COUNT), all = 1;
+	for (int i = 0; i < BATCH_BENCH_COUNT; i++) {
+		bs_init(msgs[i]);
+		bs_init(signs[i]);
+		bs_init(ciphers[i]);
+		bs_set_b(msgs[i], "abc", 3);
+		bs_concat_zero(msgs[i], msgs[i], i % 16);
+		rsa_sign(signs[i], msgs[i], keys.sk);
+	}
+	rsa_enc_batch(ciphers, msgs, BATCH_BENCH_COUNT, keys.pk);
+
+	/* One context and one message at a time */
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, keys.pk);
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BATCH_BENCH_COUNT; i++)
+		all &= rsa_verify_ctx(signs[i], msgs[i], ctx);
+	double t = elapsed(&start) / BATCH_BENCH_COUNT * 1e6;
+	printf("rsa_verify_ctx: %.1f us\n", t);
+	rsa_ctx_clear(ctx);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	all &= rsa_verify_batch(valid, signs, msgs, BATCH_BENCH_COUNT, keys.pk);
+	t = elapsed(&start) / BATCH_BENCH_COUNT * 1e6;
+	printf("rsa_verify_batch, %d lanes: %.1f us\n", mont_xn_lanes(), t);
+
+	rsa_ctx_init(ctx, keys.sk);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BATCH_BENCH_COUNT; i++)
+		rsa_dec_ctx(signs[i], ciphers[i], ctx);
+	t = elapsed(&start) / BATCH_BENCH_COUNT * 1e6;
+	printf("rsa_dec_ctx: %.0f us\n", t);
+	rsa_ctx_clear(ctx);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	rsa_dec_batch(ciphers, ciphers, BATCH_BENCH_COUNT, keys.sk);
+	t = elapsed(&start) / BATCH_BENCH_COUNT * 1e6;
+	printf("rsa_dec_batch, %d lanes: %.0f us\n", mont_xn_lanes(), t);
+
+	if (!all)
+		printf("rsa_verify_batch: signature rejected\n");
+	for (int i = 0; i < BATCH_BENCH_COUNT; i++)
+		if (memcmp(ciphers[i][0]->_data, signs[i][0]->_data, bs_len(msgs[i])))
+			printf("rsa_dec_batch: message %d differs\n", i);
+
+	for (int i = 0; i < BATCH_BENCH_COUNT; i++) {
+		bs_clear(msgs[i]);
+		bs_clear(signs[i]);
+		bs_clear(ciphers[i]);
+	}
+	free(msgs);
+	free(signs);
+	free(ciphers);
+	free(valid);
+	rsa_clear_keys(keys);
+}
+
+static void bench_input_absorb(void *ctx, const byte_t *data, size_t len) {
+	sha3_update(ctx, data, len);
+}
+
+/* Drop the pages of a file from the page cache */
+static void bench_input_evict(char * const path) {
+	int fd = open(path, O_RDONLY);
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+static void bench_input() {
+	FILE *file = fopen(INPUT_BENCH_PATH, "wb");
+	byte_t buf[IOBUFSIZE] = {0};
+	for (int i = 0; i < INPUT_BENCH_SIZE / IOBUFSIZE; i++)
+		fwrite(buf, 1, IOBUFSIZE, file);
+	fclose(file);
+
+	bytestream_t hash;
+	bs_init(hash);
+	for (int backend = 0; backend < INPUT_BACKENDS; backend++)
+		for (int warm = 0; warm < 2; warm++) {
+			if (!warm)
+				bench_input_evict(INPUT_BENCH_PATH);
+			sha3_ctx_t ctx;
+			sha3_init(ctx, BITLEN);
+			struct timespec start;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			input_read(INPUT_BENCH_PATH, backend, bench_input_absorb, ctx);
+			sha3_final(hash, ctx);
+			double t = elapsed(&start);
+			printf("input %s, %s cache: %.1f MB/s\n", input_name(backend),
+				warm ? "warm" : "cold", INPUT_BENCH_SIZE / t / 1e6);
+		}
+
+	bs_clear(hash);
+	remove(INPUT_BENCH_PATH);
+}
+
+/**
+ * 	Time tree hashing against streaming a file through one sponge, warm,
+ * 	with 1 thread up to one per processor, then cold with all of them
+ */
+static void bench_treehash() {
+	FILE *file = fopen(INPUT_BENCH_PATH, "wb");
+	byte_t buf[IOBUFSIZE] = {0};
+	for (int i = 0; i < INPUT_BENCH_SIZE / IOBUFSIZE; i++)
+		fwrite(buf, 1, IOBUFSIZE, file);
+	fclose(file);
+
+	bytestream_t hash;
+	bs_init(hash);
+
+	sha3_ctx_t ctx;
+	shake256_init(ctx, BITLEN);
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	input_read(INPUT_BENCH_PATH, INPUT_PREAD, bench_input_absorb, ctx);
+	sha3_final(hash, ctx);
+	printf("one sponge, warm cache: %.1f MB/s\n", INPUT_BENCH_SIZE / elapsed(&start) / 1e6);
+
+	for (int threads = 1, cold = 0; !cold; threads *= 2) {
+		if (threads >= pool_threads()) {
+			threads = pool_threads();
+			cold = 1;
+		}
+		for (int warm = 1; warm >= !cold; warm--) {
+			if (!warm)
+				bench_input_evict(INPUT_BENCH_PATH);
+			treehash_set_threads(threads);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			treehash_file(hash, INPUT_BENCH_PATH, TREEHASH_BENCH_LEAF, BITLEN);
+			printf("tree hash, %d threads, %s cache: %.1f MB/s\n", threads,
+				warm ? "warm" : "cold", INPUT_BENCH_SIZE / elapsed(&start) / 1e6);
+		}
+	}
+
+	bs_clear(hash);
+	remove(INPUT_BENCH_PATH);
+}
+
+/**
+ * 	Time indexing the chunks of a file like the input one, with random
+ * 	bytes so boundaries follow the content, then checking ranges of it
+ */
+static void bench_chunkidx() {
+	FILE *file = fopen(INPUT_BENCH_PATH, "wb");
+	byte_t buf[IOBUFSIZE];
+	word_t x = 1;
+	for (int i = 0; i < INPUT_BENCH_SIZE / IOBUFSIZE; i++) {
+		for (int j = 0; j < IOBUFSIZE; j++)
+			buf[j] = (x = x * 6364136223846793005 + 1442695040888963407) >> 56;
+		fwrite(buf, 1, IOBUFSIZE, file);
+	}
+	fclose(file);
+
+	bytestream_t index;
+	bs_init(index);
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	chunkidx_file(index, INPUT_BENCH_PATH);
+	printf("chunk index, warm cache: %.1f MB/s, %zu bytes\n", INPUT_BENCH_SIZE / elapsed(&start) / 1e6, bs_len(index));
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int valid = 1;
+	for (int i = 0; i < CHUNKIDX_BENCH_COUNT; i++)
+		valid &= chunkidx_verify_range(bs_view(index), INPUT_BENCH_PATH,
+			(size_t) i * (INPUT_BENCH_SIZE / CHUNKIDX_BENCH_COUNT), CHUNKIDX_BENCH_RANGE);
+	printf("chunk index, %d byte range: %.0f us%s\n", CHUNKIDX_BENCH_RANGE,
+		elapsed(&start) / CHUNKIDX_BENCH_COUNT * 1e6, valid ? "" : " (invalid)");
+
+	bs_clear(index);
+	remove(INPUT_BENCH_PATH);
+}
+
+/**
+ * 	Time `rsa_sign_ctx` or `rsa_verify_ctx` with and without an arena
+ * 	scope per operation, and count the allocations of the scoped ones
+ */
+static void bench_arena_ctx(char const *name, bytestream_t sign, bytestream_t const msg, rsa_ctx_t ctx, int verify) {
+	struct timespec start;
+	arena_stats_t stats;
+	size_t allocs = 0, heap = 0;
+	double t[2];
+	for (int scoped = 0; scoped < 2; scoped++) {
+		for (int i = 0; i < 2 * ARENA_BENCH_COUNT; i++) {
+			if (i == ARENA_BENCH_COUNT)
+				clock_gettime(CLOCK_MONOTONIC, &start);
+			if (scoped)
+				arena_begin();
+			if (verify)
+				rsa_verify_ctx(sign, msg, ctx);
+			else
+				rsa_sign_ctx(sign, msg, ctx);
+			if (!scoped)
+				continue;
+			arena_end();
+			arena_stats(&stats);
+			if (i >= ARENA_BENCH_COUNT) {
+				allocs += stats.allocs;
+				heap += stats.heap;
+			}
+		}
+		t[scoped] = elapsed(&start) / ARENA_BENCH_COUNT * 1e6;
+	}
+	printf("%s: %.1f us, %.1f us in an arena, %.1f allocations and %.2f mallocs per operation\n",
+		name, t[0], t[1], (double) allocs / ARENA_BENCH_COUNT, (double) heap / ARENA_BENCH_COUNT);
+}
+
+static void bench_arena() {
+	keypair_t keys = rsa_gen_keypair();
+	bytestream_t msg, sign;
+	bs_init(msg);
+	bs_init_size(sign, BITLEN / 8);
+	bs_set_b(msg, "abc", 3);
+	rsa_sign(sign, msg, keys.sk);
+
+	rsa_ctx_t ctx;
+	rsa_ctx_init(ctx, keys.pk);
+	bench_arena_ctx("rsa_verify_ctx", sign, msg, ctx, 1);
+	rsa_ctx_clear(ctx);
+
+	rsa_ctx_init(ctx, keys.sk);
+	bench_arena_ctx("rsa_sign_ctx", sign, msg, ctx, 0);
+	rsa_ctx_clear(ctx);
+
+	bs_clear(msg);
+	bs_clear(sign);
+	rsa_clear_keys(keys);
+}
+
+int main() {
+	bench_sha3();
+	bench_sha3_xn();
+	bench_input();
+	bench_treehash();
+	bench_chunkidx();
+	bench_powm();
+	bench_sign();
+	bench_verify();
+	bench_batch();
+	bench_arena();
+	return 0;
+}
@@ -0,0 +1,830 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/rsa.h"
+#include "../include/sha3.h"
+#include "../include/k12.h"
+#include "../include/merkle.h"
+#include "../include/chunkidx.h"
+#include "../include/input.h"
+#include "../include/manifest.h"
+#include "../include/arena.h"
+#include "../include/mont.h"
+
+/* Longest KAT message, ten K12 chunks and a few bytes, a batch past the first chunk */
+#define KAT_MAXLEN (10 * 8192 + 5)
+
+/* Number of checks run and failed */
+static int checks, failures;
+
+/* Count a check, printing it with its message length or number of primes if it failed */
+static void check(char const *name, size_t n, int ok) {
+	checks++;
+	if (!ok) {
+		failures++;
+		printf("%s (%zu): FAILED\n", name, n);
+	}
+}
+
+/* Whether `len` bytes are those of a lowercase hex string */
+static int hex_eq(const byte_t *bytes, size_t len, char const *hex) {
+	char buf[3];
+	if (strlen(hex) != 2 * len)
+		return 0;
+	for (size_t i = 0; i < len; i++) {
+		sprintf(buf, "%02x", bytes[i]);
+		if (memcmp(buf, hex + 2 * i, 2))
+			return 0;
+	}
+	return 1;
+}
+
+/* KAT messages, the first bytes of the pattern of the KangarooTwelve test vectors */
+static byte_t kat_msg[KAT_MAXLEN];
+#define kat_view(len) bs_view_b(kat_msg, len)
+
+/* Write `len` bytes to a new file, its path in `path` */
+static void kat_file(char *path, const byte_t *data, size_t len) {
+	strcpy(path, "/tmp/kat_XXXXXX");
+	int fd = mkstemp(path);
+	if (fd < 0 || write(fd, data, len) != (ssize_t) len) {
+		fprintf(stderr, "Could not write a file to /tmp\n");
+		exit(EXIT_FAILURE);
+	}
+	close(fd);
+}
+
+/* Flip a bit of the byte at `offset` of a file, from its end if negative */
+static void kat_flip(char const *path, long offset) {
+	FILE *file = fopen(path, "r+b");
+	fseek(file, offset, offset < 0 ? SEEK_END : SEEK_SET);
+	int c = fgetc(file);
+	fseek(file, -1, SEEK_CUR);
+	fputc(c ^ 1, file);
+	fclose(file);
+}
+
+/* Absorb the KAT message of `msglen` bytes in pieces of 1, 2, 3... bytes */
+static void kat_update(sha3_ctx_t ctx, size_t msglen) {
+	for (size_t off = 0, n = 1; off < msglen; off += n, n++)
+		sha3_update(ctx, kat_msg + off, msglen - off < n ? msglen - off : n);
+}
+
+/**
+ * 	SHA3 known answers, of messages of no bytes, one SHA3-256 block and
+ * 	one to three K12 chunks
+ */
+static const struct {
+	size_t len; /* Output length in bits */
+	size_t msglen; /* Message length in bytes */
+	char const *hex; /* Hash */
+} sha3_kats[] = {
+	{224, 0, "6b4e03423667dbb73b6e15454f0eb1abd4597f9a1b078e3f5b5a6bc7"},
+	{256, 0, "a7ffc6f8bf1ed76651c14756a061d662f580ff4de43b49fa82d80a4b80f8434a"},
+	{384, 0, "0c63a75b845e4f7d01107d852e4c2485c51a50aaaa94fc61995e71bbee983a2ac3713831264adb47fb6bd1e058d5f004"},
+	{512, 0, "a69f73cca23a9ac5c8b567dc185a756e97c982164fe25859e0d1dcc1475c80a615b2123af1f5f94c11e3e9402c3ac558f500199d95b6d3e301758586281dcd26"},
+	{224, 136, "5d633f7e245e4338fa2698ef8b0cf98b129b5cc99622f770e3ba0cb6"},
+	{256, 136, "cf3ccff92480a29160c2d38317c430e14749bfee1788106957dfe73f8c4930e5"},
+	{384, 136, "ced899b993a69f66251a7872fbb87f8be5967857b2693e3feb032b3440dd94b78cab782debfa10956642ae536a8241e9"},
+	{512, 136, "ad8edff4f1b7aa1c63bbe49728ab9b165f7245b3d7102e6f99c261fc15d2d0bf6afef6a491720454a1349fbf5d848854875ac83a1156fd7f6e2a37af26c07fb2"},
+	{224, 8192, "b6b0c36fe2b845f393199b5896c06ea2203535fa40f61454f66be7ec"},
+	{256, 8192, "ae1e2d41aabdd5f20028d82dbd03bb02c64de6021b9c5afb5db3bec5b415528c"},
+	{384, 8192, "dfd45758ce0596a69b5ebcfbd41fd82ab73336b0798882a45b0fa19bdbc31cbfd2dbfc21b599d7baaaf0aa6db172d384"},
+	{512, 8192, "54944f3d94baf90603f2d2536d7612aced75dee0e8f1e9e70490729f33539e87a87c1db5eb12779802e47a9a2c4629f00d6363ea282bf876c28779140ab73d17"},
+	{224, 8193, "a7232b923c520ff46e1d3cf1c21fb712308b37c54ddf49b8a57618b0"},
+	{256, 8193, "91cbc140c95662bd52cfb156b36fe9eed52f264dd7babde25cb5e84837633b88"},
+	{384, 8193, "d68d76b03025d73fad0495718910f5167bca3667e7dcd90a91f721ec8d28f79d8ae7575db6ddc0d889b50619c3aed756"},
+	{512, 8193, "757d20247c70b52e77308ef1bc1eb3dcb5ccd04f9e22c62fb2c62ad49350f336a08d126e9d00edb85af69ff92524b477b9f515c4ce8742cfa2a9c6b243cbe6a0"},
+	{224, 24577, "9a376e8c6cb9c1193f98c9676b32193cbbb4c95f32e3150d1bd96b9b"},
+	{256, 24577, "f381e9ce750462a55efb74b67a336128bc11a9501beb1771bd730c490aeca5d8"},
+	{384, 24577, "5906c288cb331f4b6b803e86e84c65c92ed312315305f79b38cac508f3ca4c5e1226b0a7d35a441b350702195c89d2d8"},
+	{512, 24577, "e274eef19d8aa104c6adf400ba1fea4eeded79446d353813ff033113d9f72e2d627c13948ed48f9b8c9ff6140a770e27dcbe615f028b835a7751a80ce8c98c66"},
+};
+
+/* SHAKE known answers, 32 bytes of SHAKE128 and 64 of SHAKE256 */
+static const struct {
+	int bits; /* Security strength */
+	size_t msglen; /* Message length in bytes */
+	char const *hex; /* Output */
+} shake_kats[] = {
+	{128, 0, "7f9c2ba4e88f827d616045507605853ed73b8093f6efbc88eb1a6eacfa66ef26"},
+	{256, 0, "46b9dd2b0ba88d13233b3feb743eeb243fcd52ea62b81b82b50c27646ed5762fd75dc4ddd8c0f200cb05019d67b592f6fc821c49479ab48640292eacb3b7c4be"},
+	{128, 136, "30bdfd69382cab028173fba7c6d53878ec18081358e52c955dc6f5d52b60b029"},
+	{256, 136, "b7ff4073b3f5a8eabd6e17705ca7f6761a31058f9df781a6a47e3a3063b9d67a757e8dbf043dac48d2154e46d59c0b9e8bc36ba035153691fbe83b9eff5dae4a"},
+	{128, 8192, "d91222e88d0b3e4e12edf5d82d4c66c254682eb99de79d8ca47405b7527306b0"},
+	{256, 8192, "9cc49c82718707b00f1de5c812d620d7c1519b895bb968c07f1b5343e5e7a93c95245ad1588e7d72cf3f62ccfcc5f1064c25c9da02cfb9268a7da26d850fd012"},
+	{128, 8193, "c26f6910bbb4fe728330d3e497fd28aeda340ab2746029f0629b4684262e11fa"},
+	{256, 8193, "9b2be4e870af8b6cfcb6e64d23f8efeeef9fc6c42ea4492aa93d2fdd10288bccbf77267c63893602766f1eff876ad87d3d971fe75a06acc6fc37ede9fcfc9097"},
+	{128, 24577, "93b0662308efe319112e4437b3d326169e1da8b443884c174ca988a2362ab012"},
+	{256, 24577, "9ad1fda75168b39c53845c96311d436925206c98b6f9e42255702787ff60b6ae60a350f7bb9bf14dabcb800d702475ca3ed3e47676ba3f7863a1a5435f982efa"},
+};
+
+/* cSHAKE256 known answers, 64 bytes with an empty function name and KAT_CUSTOM */
+#define KAT_CUSTOM "RSA batch"
+static const struct {
+	size_t msglen; /* Message length in bytes */
+	char const *hex; /* Output */
+} cshake_kats[] = {
+	{0, "75b4514dbb9c60d87587cef161200f2482e6f1e90015662001e7fb146f08da468ddd284837be0f96cb13c44e22196e87c2f2eeead24d8ede21fe91a04524faf1"},
+	{136, "b9dc9684a8a556a736ea7e19af67aa687ed83fec3305efa6ce91e723f2e391327f1a38bcaa706dc9bde36a897dbf39bc93e67bc523b4ecb7c541328e057dc958"},
+	{8192, "62a5fee2264a04d6b7dfee0ab6740cc4e797b58f2a5db2a50682d2201e023c8dfa58ecc71eed4bb7df51f9b08841f12f2f15369f15d443961c812eaf71c0b43c"},
+	{8193, "5cd2b294e63a924e0cf4abe198d8a2cb38c28f279ff6c364bef0fe194d485358c7bff199c4f684bd472ab52c5a3637781561567fb7c679953bd21cdc3e07c4c3"},
+	{24577, "a150d0e46d6624c48681e9b74d9de2d071680e8d4c64cb3a2cd4fce278d9e971101862acf644b30d50bfe61a72f37c884ad50a3110f9faff22b3c5a36e6eddac"},
+};
+
+/* TurboSHAKE128 known answers, 32 bytes */
+static const struct {
+	byte_t pad; /* Domain separation byte */
+	size_t msglen; /* Message length in bytes */
+	char const *hex; /* Output */
+} turboshake_kats[] = {
+	{0x1f, 0, "1e415f1c5983aff2169217277d17bb538cd945a397ddec541f1ce41af2c1b74c"},
+	{0x0b, 0, "8b035ab8f8ea7b410217167458332e46f54be4ff8354baf3687104a6d24b0eab"},
+	{0x1f, 136, "9f2d9951d1e5f3f96a38d4256f06eeed9a91650d6e5981fbd4bfcd6c87aa5b1b"},
+	{0x0b, 136, "077b85bb2edae15147755e4daa7735cd4e58cbc9023f1bb37ea54c8228b68448"},
+	{0x1f, 8192, "74363209ed6afc33c1df18f7ac38a0536ecedca24cd538025f24fac4b72175d9"},
+	{0x0b, 8192, "1d1a3e452370abe1f903128d66b0b53593eeef6aaf809e93f776161f32f24383"},
+	{0x1f, 8193, "37c044dc3b92c28a6688dc5c6e5a911a9778305183929252242d1634e8815aae"},
+	{0x0b, 8193, "4b91fbddec612b171eeba8c9a0d12520c9d0d7941b0fa36cc6151de666c30bd5"},
+	{0x1f, 24577, "5eba8d7ceef63e5be458d96e200e72331fa9a61733106124b92a82b1f5159081"},
+	{0x0b, 24577, "19deab588f333f4b5a653b02b07ede5405598a292d674cb0287b1828d05f8268"},
+};
+
+/* KangarooTwelve known answers, 32 bytes, the first one from RFC 9861 */
+static const struct {
+	char const *custom; /* Customization string */
+	size_t msglen; /* Message length in bytes */
+	char const *hex; /* Output */
+} k12_kats[] = {
+	{"", 0, "1ac2d450fc3b4205d19da7bfca1b37513c0803577ac7167f06fe2ce1f0ef39e5"},
+	{"RSA", 0, "10e11eba286e5ee998b14f6534cb930729f806a02f0dc5892679ad75e549976a"},
+	{"", 136, "2dbe8da63eed894fb27a44ba8a5edbe65b6ecdab0e2163aef7fd64b5277e619e"},
+	{"RSA", 136, "d23ca86871b07322d4e4d0f1ca12b8cc85df190f0f8e8bab25e42634ed31885a"},
+	{"", 8192, "48f256f6772f9edfb6a8b661ec92dc93b95ebd05a08a17b39ae3490870c926c3"},
+	{"RSA", 8192, "7844f1ddd71e900a761ea6382df6e692a843cd7468cf490041fbab1cd90bedb4"},
+	{"", 8193, "bb66fe72eaea5179418d5295ee1344854d8ad7f3fa17efcb467ec152341284cf"},
+	{"RSA", 8193, "3db0f52c30c5703af4c13f739e0c51fc1ab40a3f6cc601441a2a7ae020756c17"},
+	{"", 24577, "38cb940999aca742d69dd79298c6051c4e316bf2a7b866aca960a1fc85fad3f8"},
+	{"RSA", 24577, "f07487589a03c1b92dff371ef42f8eaf098bb9174be09d2899ba270b1d26ed18"},
+	{"", 81925, "62ac3d98f815456a3ff06e1a7711823a6c7f7b246295880623faac44c6b91f1b"},
+	{"RSA", 81925, "7c363e6d2fb34845474fa9f9cf988d527cd1e28d0730bb5f4f3cedcf0a36d4d0"},
+};
+
+/* Calls to the GMP memory functions in place before the arena */
+static size_t gmp_allocs, gmp_frees;
+
+static void *gmp_alloc(size_t size) {
+	gmp_allocs++;
+	return malloc(size);
+}
+
+static void *gmp_realloc(void *ptr, size_t old, size_t size) {
+	(void) old;
+	return realloc(ptr, size);
+}
+
+static void gmp_free(void *ptr, size_t size) {
+	(void) size;
+	gmp_frees++;
+	free(ptr);
+}
+
+static void test_arena() {
+	/* Integers of before the first scope, grown inside it, stay with GMP's functions */
+	mp_set_memory_functions(gmp_alloc, gmp_realloc, gmp_free);
+	mpz_t before, inside;
+	mpz_init_set_ui(before, 1);
+	arena_begin();
+	mpz_mul_2exp(before, before, 1 << 16);
+	mpz_init_set(inside, before);
+	mpz_add_ui(inside, inside, 1);
+	arena_end();
+
+	arena_stats_t stats;
+	arena_stats(&stats);
+	check("arena, GMP inside a scope", stats.allocs, stats.allocs > 0 && gmp_allocs == 1);
+	mpz_clear(before);
+	check("arena, GMP outside of a scope", gmp_frees, gmp_allocs == 1 && gmp_frees == 1);
+	mpz_init_set_ui(before, 1);
+	mpz_clear(before);
+	check("arena, GMP outside of a scope", gmp_frees, gmp_allocs == 2 && gmp_frees == 2);
+}
+
+static void test_sha3() {
+	bytestream_t hash;
+	bs_init(hash);
+	sha3_ctx_t ctx;
+
+	for (size_t i = 0; i < sizeof(sha3_kats) / sizeof(*sha3_kats); i++) {
+		size_t len = sha3_kats[i].len, msglen = sha3_kats[i].msglen;
+		char const *hex = sha3_kats[i].hex;
+
+		/* Other lengths keep a capacity of SHA3_C without VARIABLE_CAPACITY, see sha3.h */
+		if (len != SHA3_C / 2)
+			continue;
+
+		sha3_view(hash, kat_view(msglen), len);
+		check("sha3", msglen, hex_eq(hash[0]->_data, bs_len(hash), hex));
+
+		sha3_init(ctx, len);
+		kat_update(ctx, msglen);
+		sha3_final(hash, ctx);
+		check("sha3_update", msglen, hex_eq(hash[0]->_data, bs_len(hash), hex));
+	}
+
+	/* Every lane of the multi-buffer kernel, with SHA3-256 messages of every length */
+	bytestream_t hashes[8];
+	bs_view_t msgs[8];
+	for (int j = 0; j < 8; j++) {
+		bs_init(hashes[j]);
+		msgs[j] = kat_view(sha3_kats[(4 * j + 1) % 20].msglen);
+	}
+	sha3_xn_view(hashes, msgs, 8, 256);
+	for (int j = 0; j < 8; j++) {
+		check("sha3_xn", msgs[j].len, hex_eq(hashes[j][0]->_data, bs_len(hashes[j]), sha3_kats[(4 * j + 1) % 20].hex));
+		bs_clear(hashes[j]);
+	}
+
+	bs_clear(hash);
+}
+
+/* Fixed-parameter SHA3 and SHAKE, see sha3.h */
+static void (*const sha3_fixed[])(byte_t *, bs_view_t) = {sha3_224, sha3_256, sha3_384, sha3_512};
+
+static void test_shake() {
+	byte_t out[64];
+	bytestream_t hash;
+	bs_init(hash);
+	sha3_ctx_t ctx;
+
+	for (size_t i = 0; i < sizeof(sha3_kats) / sizeof(*sha3_kats); i++) {
+		size_t len = sha3_kats[i].len, msglen = sha3_kats[i].msglen;
+		sha3_fixed[len == 224 ? 0 : len == 256 ? 1 : len == 384 ? 2 : 3](out, kat_view(msglen));
+		check("sha3_224/256/384/512", msglen, hex_eq(out, len / 8, sha3_kats[i].hex));
+	}
+
+	for (size_t i = 0; i < sizeof(shake_kats) / sizeof(*shake_kats); i++) {
+		size_t msglen = shake_kats[i].msglen, outlen = strlen(shake_kats[i].hex) / 2;
+		char const *hex = shake_kats[i].hex;
+		if (shake_kats[i].bits == 128) {
+			shake128(out, outlen, kat_view(msglen));
+			check("shake128", msglen, hex_eq(out, outlen, hex));
+			continue;
+		}
+
+		shake256(out, outlen, kat_view(msglen));
+		check("shake256", msglen, hex_eq(out, outlen, hex));
+
+		shake256_init(ctx, 8 * outlen);
+		kat_update(ctx, msglen);
+		sha3_final_b(out, ctx);
+		check("shake256_update", msglen, hex_eq(out, outlen, hex));
+
+		/* An empty customization string is SHAKE256 */
+		cshake256_init(ctx, 8 * outlen, bs_view_b(NULL, 0));
+		kat_update(ctx, msglen);
+		sha3_final_b(out, ctx);
+		check("cshake256, no customization", msglen, hex_eq(out, outlen, hex));
+	}
+
+	bs_view_t custom = bs_view_b(KAT_CUSTOM, strlen(KAT_CUSTOM));
+	bytestream_t msgs[5], hashes[5];
+	for (size_t i = 0; i < sizeof(cshake_kats) / sizeof(*cshake_kats); i++) {
+		size_t msglen = cshake_kats[i].msglen;
+		cshake256_init(ctx, 512, custom);
+		kat_update(ctx, msglen);
+		sha3_final(hash, ctx);
+		check("cshake256", msglen, hex_eq(hash[0]->_data, bs_len(hash), cshake_kats[i].hex));
+
+		bs_init(msgs[i]);
+		bs_init(hashes[i]);
+		bs_set_b(msgs[i], kat_msg, msglen);
+	}
+
+	/* Every message at once in the multi-buffer kernel */
+	cshake256_xn(hashes, msgs, 5, 512, custom);
+	for (size_t i = 0; i < 5; i++) {
+		check("cshake256_xn", cshake_kats[i].msglen, hex_eq(hashes[i][0]->_data, bs_len(hashes[i]), cshake_kats[i].hex));
+		bs_clear(msgs[i]);
+		bs_clear(hashes[i]);
+	}
+
+	bs_clear(hash);
+}
+
+static void test_k12() {
+	byte_t out[32], *outs[10];
+	bytestream_t hash;
+	bs_init(hash);
+	sha3_ctx_t ctx;
+	k12_ctx_t *k12ctx = malloc(sizeof(k12_ctx_t));
+
+	bs_view_t msgs[10];
+	size_t count = sizeof(turboshake_kats) / sizeof(*turboshake_kats);
+	for (size_t i = 0; i < count; i++) {
+		size_t msglen = turboshake_kats[i].msglen;
+		turboshake128_init(ctx, 256, turboshake_kats[i].pad);
+		kat_update(ctx, msglen);
+		sha3_final_b(out, ctx);
+		check("turboshake128", msglen, hex_eq(out, 32, turboshake_kats[i].hex));
+
+		msgs[i] = kat_view(msglen);
+		outs[i] = malloc(32);
+	}
+
+	/* Multi-buffer kernel, one padding byte for every lane */
+	for (int pad = 0; pad < 2; pad++) {
+		byte_t *padouts[5];
+		bs_view_t padmsgs[5];
+		for (size_t i = 0; i < count / 2; i++) {
+			padouts[i] = outs[2 * i + pad];
+			padmsgs[i] = msgs[2 * i + pad];
+		}
+		turboshake128_xn(padouts, padmsgs, count / 2, 256, turboshake_kats[pad].pad);
+	}
+	for (size_t i = 0; i < count; i++) {
+		check("turboshake128_xn", msgs[i].len, hex_eq(outs[i], 32, turboshake_kats[i].hex));
+		free(outs[i]);
+	}
+
+	for (size_t i = 0; i < sizeof(k12_kats) / sizeof(*k12_kats); i++) {
+		size_t msglen = k12_kats[i].msglen;
+		bs_view_t custom = bs_view_b(k12_kats[i].custom, strlen(k12_kats[i].custom));
+		char const *hex = k12_kats[i].hex;
+
+		k12(hash, kat_view(msglen), custom, 256);
+		check("k12", msglen, hex_eq(hash[0]->_data, bs_len(hash), hex));
+
+		/* Pieces of 1, 2, 3... bytes, across chunk and batch boundaries */
+		k12_init(*k12ctx, 256);
+		for (size_t off = 0, n = 1; off < msglen; off += n, n++)
+			k12_update(*k12ctx, kat_msg + off, msglen - off < n ? msglen - off : n);
+		k12_final(hash, *k12ctx, custom);
+		check("k12_update", msglen, hex_eq(hash[0]->_data, bs_len(hash), hex));
+	}
+
+	free(k12ctx);
+	bs_clear(hash);
+}
+
+/* Bytes of the files and pipes of the input test, past a SHA3-256 block and a K12 chunk */
+#define INPUT_TEST_SIZE 8193
+
+/* Absorb file bytes into the SHA3 context `arg` */
+static void input_hash(void *arg, const byte_t *data, size_t len) {
+	sha3_update(arg, data, len);
+}
+
+/* Hash a file read with a backend */
+static void input_digest(byte_t *out, char *path, int backend) {
+	bytestream_t hash;
+	bs_init(hash);
+	sha3_ctx_t ctx;
+	sha3_init(ctx, 256);
+	input_read(path, backend, input_hash, ctx);
+	sha3_final(hash, ctx);
+	memcpy(out, hash[0]->_data, 32);
+	bs_clear(hash);
+}
+
+static void test_input() {
+	byte_t digest[32], out[32];
+	sha3_256(digest, kat_view(INPUT_TEST_SIZE));
+
+	char path[32];
+	kat_file(path, kat_msg, INPUT_TEST_SIZE);
+	for (int backend = 0; backend < INPUT_BACKENDS; backend++) {
+		input_digest(out, path, backend);
+		check(input_name(backend), INPUT_TEST_SIZE, !memcmp(out, digest, 32));
+	}
+	remove(path);
+
+	/* Pipes have no size to map, the whole of them is read */
+	int backends[] = {INPUT_STDIO, INPUT_MMAP};
+	for (int i = 0; i < 2; i++) {
+		int fds[2];
+		if (pipe(fds) || write(fds[1], kat_msg, INPUT_TEST_SIZE) != INPUT_TEST_SIZE) {
+			fprintf(stderr, "Could not write a pipe\n");
+			exit(EXIT_FAILURE);
+		}
+		close(fds[1]);
+		sprintf(path, "/dev/fd/%d", fds[0]);
+		input_digest(out, path, backends[i]);
+		check(backends[i] == INPUT_MMAP ? "mmap, pipe" : "stdio, pipe", INPUT_TEST_SIZE, !memcmp(out, digest, 32));
+		close(fds[0]);
+	}
+}
+
+/* Modulo sizes of the exponentiation test, of specialized code and not */
+static const int mont_bits[] = {512, 1024, 2048, 3072, 4096};
+#define MONT_BASES 9
+
+static void test_mont() {
+	gmp_randstate_t rs;
+	gmp_randinit_default(rs);
+	mpz_t mod, exp, zero, expected, rop, bases[MONT_BASES], rops[MONT_BASES];
+	mpz_inits(mod, exp, zero, expected, rop, NULL);
+	for (int i = 0; i < MONT_BASES; i++)
+		mpz_inits(bases[i], rops[i], NULL);
+
+	for (size_t b = 0; b < sizeof(mont_bits) / sizeof(*mont_bits); b++) {
+		int bits = mont_bits[b];
+		mpz_urandomb(mod, rs, bits);
+		mpz_setbit(mod, bits - 1);
+		mpz_setbit(mod, 0);
+		mpz_urandomb(exp, rs, bits);
+		for (int i = 0; i < MONT_BASES; i++)
+			mpz_urandomb(bases[i], rs, bits - 1);
+
+		/* Secret and public exponents, one by one and in lanes */
+		mont_t m;
+		mont_init(m, mod, exp);
+		mpz_powm(expected, bases[0], exp, mod);
+		mont_powm_sec(rop, bases[0], m);
+		check("mont_powm_sec", bits, !mpz_cmp(rop, expected));
+		mont_powm(rop, bases[0], exp, m);
+		check("mont_powm", bits, !mpz_cmp(rop, expected));
+		mont_powm_sec_xn(rops, bases, MONT_BASES, m);
+		for (int i = 0; i < MONT_BASES; i++) {
+			mpz_powm(expected, bases[i], exp, mod);
+			check("mont_powm_sec_xn", bits, !mpz_cmp(rops[i], expected));
+		}
+
+		/* x ^ 0 = 1 */
+		mont_powm(rop, bases[0], zero, m);
+		check("mont_powm, zero exponent", bits, !mpz_cmp_ui(rop, 1));
+		mont_powm_xn(rops, bases, MONT_BASES, zero, m);
+		for (int i = 0; i < MONT_BASES; i++)
+			check("mont_powm_xn, zero exponent", bits, !mpz_cmp_ui(rops[i], 1));
+		mont_clear(m);
+		mont_init(m, mod, zero);
+		mont_powm_sec(rop, bases[0], m);
+		check("mont_powm_sec, zero exponent", bits, !mpz_cmp_ui(rop, 1));
+		mont_clear(m);
+	}
+
+	mpz_clears(mod, exp, zero, expected, rop, NULL);
+	for (int i = 0; i < MONT_BASES; i++)
+		mpz_clears(bases[i], rops[i], NULL);
+	gmp_randclear(rs);
+}
+
+/* Signatures verified one by one and in batches, one of them negated */
+#define VERIFY_MSGS 8
+
+static void test_verify(keypair_t keys) {
+	bytestream_t msgs[VERIFY_MSGS], signs[VERIFY_MSGS];
+	int valid[VERIFY_MSGS];
+	for (int i = 0; i < VERIFY_MSGS; i++) {
+		bs_init(msgs[i]);
+		bs_init(signs[i]);
+		bs_set_b(msgs[i], kat_msg + i, 100 * i);
+		rsa_sign(signs[i], msgs[i], keys.sk);
+	}
+	check("rsa_verify_batch", VERIFY_MSGS, rsa_verify_batch(valid, signs, msgs, VERIFY_MSGS, keys.pk));
+
+	/* mod - s is s times -1, a valid signature of nothing */
+	mpz_t s;
+	mpz_init(s);
+	mpz_set_bs(s, signs[2]);
+	mpz_sub(s, keys.pk.mod, s);
+	bs_set_mpz(signs[2], s);
+	check("rsa_verify, negated", bs_len(msgs[2]), !rsa_verify(signs[2], msgs[2], keys.pk));
+	check("rsa_verify_batch, negated", VERIFY_MSGS, !rsa_verify_batch(valid, signs, msgs, VERIFY_MSGS, keys.pk));
+	for (int i = 0; i < VERIFY_MSGS; i++)
+		check("rsa_verify_batch, negated", i, valid[i] == (i != 2));
+
+	mpz_clear(s);
+	for (int i = 0; i < VERIFY_MSGS; i++) {
+		bs_clear(msgs[i]);
+		bs_clear(signs[i]);
+	}
+}
+
+/* Merkle roots of trees of these many leaves against the inclusion path of every leaf */
+static const size_t merkle_counts[] = {1, 2, 3, 5, 8, 13};
+
+static void test_merkle(keypair_t keys) {
+	bytestream_t digests[13], root, proot, path[MERKLE_MAXPATH];
+	bs_view_t views[MERKLE_MAXPATH];
+	bs_init(root);
+	bs_init(proot);
+	for (int i = 0; i < 13; i++) {
+		bs_init(digests[i]);
+		bs_set_b(digests[i], kat_msg + i, 200);
+		shake256_xn(digests + i, digests + i, 1, BITLEN);
+	}
+	for (int j = 0; j < MERKLE_MAXPATH; j++)
+		bs_init(path[j]);
+
+	for (size_t c = 0; c < sizeof(merkle_counts) / sizeof(*merkle_counts); c++) {
+		size_t count = merkle_counts[c];
+		merkle_t tree;
+		merkle_init(tree, digests, count, BITLEN);
+		merkle_root(root, tree);
+
+		/* Roots are domain separated from the digests they commit to */
+		check("merkle_root, not a leaf", count, memcmp(root[0]->_data, digests[0][0]->_data, BITLEN / 8));
+
+		for (size_t i = 0; i < count; i++) {
+			size_t len = merkle_path_len(i, count);
+			merkle_path(path, tree, i);
+			for (size_t j = 0; j < len; j++)
+				views[j] = bs_view(path[j]);
+
+			merkle_root_path(proot, digests[i], i, count, views, BITLEN);
+			check("merkle_root_path", count, !memcmp(root[0]->_data, proot[0]->_data, BITLEN / 8));
+
+			/* Another leaf, or a changed node, commits to another root */
+			merkle_root_path(proot, digests[(i + 1) % 13], i, count, views, BITLEN);
+			check("merkle_root_path, other digest", count, memcmp(root[0]->_data, proot[0]->_data, BITLEN / 8));
+			if (!len)
+				continue;
+			path[len - 1][0]->_data[0] ^= 1;
+			merkle_root_path(proot, digests[i], i, count, views, BITLEN);
+			check("merkle_root_path, tampered node", count, memcmp(root[0]->_data, proot[0]->_data, BITLEN / 8));
+		}
+		merkle_clear(tree);
+	}
+
+	/* Batch signatures of files, then one with a tampered proof */
+	char paths[3][32], *ptrs[3], signpath[32 + sizeof(SIGNSUFFIX)];
+	for (int i = 0; i < 3; i++) {
+		kat_file(paths[i], kat_msg, 1000 * (i + 1));
+		ptrs[i] = paths[i];
+	}
+	rsa_sign_batch(ptrs, 3, keys.sk);
+	for (int i = 0; i < 3; i++) {
+		strcpy(signpath, paths[i]);
+		strcat(signpath, SIGNSUFFIX);
+		check("rsa_sign_batch", 1000 * (i + 1), rsa_verify_file(signpath, paths[i], keys.pk));
+		if (i == 2) {
+			kat_flip(signpath, -1);
+			check("rsa_sign_batch, tampered proof", 1000 * (i + 1), !rsa_verify_file(signpath, paths[i], keys.pk));
+		}
+		remove(signpath);
+		remove(paths[i]);
+	}
+
+	for (int j = 0; j < MERKLE_MAXPATH; j++)
+		bs_clear(path[j]);
+	for (int i = 0; i < 13; i++)
+		bs_clear(digests[i]);
+	bs_clear(root);
+	bs_clear(proot);
+}
+
+/* Entries of the manifest test, with a missing file and a missing signature */
+#define MANIFEST_ENTRIES 4
+
+static void test_manifest(keypair_t keys) {
+	char paths[2][32], missing[40], signpaths[2][32 + sizeof(SIGNSUFFIX)], keypath[32], manpath[32];
+	for (int i = 0; i < 2; i++) {
+		kat_file(paths[i], kat_msg, 1000 * (i + 1));
+		rsa_sign_file(paths[i], paths[i], keys.sk);
+		strcpy(signpaths[i], paths[i]);
+		strcat(signpaths[i], SIGNSUFFIX);
+	}
+	strcpy(missing, paths[0]);
+	strcat(missing, ".missing");
+	kat_file(keypath, NULL, 0);
+	rsa_save_key(keypath, keys.pk);
+
+	char text[8 * 64];
+	int len = snprintf(text, sizeof(text), "%s %s %s\n%s %s %s\n%s %s %s\n%s %s %s\n",
+		paths[0], signpaths[0], keypath, missing, signpaths[0], keypath,
+		paths[1], missing, keypath, paths[1], signpaths[1], keypath);
+	kat_file(manpath, (const byte_t *) text, len);
+
+	/* Unreadable entries are errors, the others are still verified */
+	manifest_t manifest;
+	manifest_load(manifest, manpath);
+	int valid[MANIFEST_ENTRIES], expected[MANIFEST_ENTRIES] = {1, -1, -1, 1};
+	check("manifest_verify", MANIFEST_ENTRIES, manifest_verify(valid, manifest, 2) == 2 &&
+		!memcmp(valid, expected, sizeof(valid)));
+	check("manifest_verify_pipeline", MANIFEST_ENTRIES, manifest_verify_pipeline(valid, NULL, manifest, 2, 1) == 2 &&
+		!memcmp(valid, expected, sizeof(valid)));
+	manifest_clear(manifest);
+
+	/* A directory opens but fails to read */
+	len = snprintf(text, sizeof(text), "/tmp %s %s\n", signpaths[0], keypath);
+	remove(manpath);
+	kat_file(manpath, (const byte_t *) text, len);
+	manifest_load(manifest, manpath);
+	check("manifest_verify_pipeline, read error", 1, manifest_verify_pipeline(valid, NULL, manifest, 2, 1) == 0 &&
+		valid[0] == -1);
+	manifest_clear(manifest);
+
+	for (int i = 0; i < 2; i++) {
+		remove(paths[i]);
+		remove(signpaths[i]);
+	}
+	remove(keypath);
+	remove(manpath);
+}
+
+/* Signatures and decryptions of keys of 2 to MAXPRIMES primes, with and without CRT */
+#define CRT_MSGS 6
+
+static void test_crt() {
+	bytestream_t msgs[CRT_MSGS], signs[CRT_MSGS], plain[CRT_MSGS], ciphers[CRT_MSGS], decs[CRT_MSGS];
+	for (int i = 0; i < CRT_MSGS; i++) {
+		bs_init(msgs[i]);
+		bs_init(signs[i]);
+		bs_init(plain[i]);
+		bs_init(ciphers[i]);
+		bs_init(decs[i]);
+		bs_set_b(msgs[i], kat_msg + i, 20 * i);
+	}
+
+	for (int nprimes = 2; nprimes <= MAXPRIMES; nprimes++) {
+		keypair_t keys = rsa_gen_keypair_primes(nprimes);
+		for (int i = 0; i < CRT_MSGS; i++) {
+			rsa_sign(signs[i], msgs[i], keys.sk);
+			check("rsa_sign, CRT", nprimes, rsa_verify(signs[i], msgs[i], keys.pk));
+			rsa_enc(ciphers[i], msgs[i], keys.pk);
+		}
+
+		/* Same key without its prime factors */
+		keys.sk.nprimes = 0;
+		for (int i = 0; i < CRT_MSGS; i++) {
+			rsa_sign(plain[i], msgs[i], keys.sk);
+			check("rsa_sign, CRT against no CRT", nprimes, bs_len(plain[i]) == bs_len(signs[i]) &&
+				!memcmp(plain[i][0]->_data, signs[i][0]->_data, bs_len(signs[i])));
+			rsa_dec(plain[i], ciphers[i], keys.sk);
+		}
+		keys.sk.nprimes = nprimes;
+
+		/* Batch decryption in the multi-lane kernels */
+		rsa_dec_batch(decs, ciphers, CRT_MSGS, keys.sk);
+		for (int i = 0; i < CRT_MSGS; i++)
+			check("rsa_dec_batch, CRT against no CRT", nprimes, bs_len(decs[i]) == OAEP_MSGLEN &&
+				bs_len(plain[i]) == OAEP_MSGLEN && !memcmp(decs[i][0]->_data, plain[i][0]->_data, OAEP_MSGLEN) &&
+				!memcmp(decs[i][0]->_data, msgs[i][0]->_data, bs_len(msgs[i])));
+
+		rsa_clear_keys(keys);
+	}
+
+	for (int i = 0; i < CRT_MSGS; i++) {
+		bs_clear(msgs[i]);
+		bs_clear(signs[i]);
+		bs_clear(plain[i]);
+		bs_clear(ciphers[i]);
+		bs_clear(decs[i]);
+	}
+}
+
+/* Whether an OAEP decoding is `msg` padded with zero bytes to OAEP_MSGLEN bytes */
+static int oaep_eq(const byte_t *decoded, const byte_t *msg, size_t len) {
+	static const byte_t zeros[OAEP_MSGLEN];
+	return !memcmp(decoded, msg, len) && !memcmp(decoded + len, zeros, OAEP_MSGLEN - len);
+}
+
+/* Lengths of OAEP messages, and zero bytes they start with */
+#define OAEP_LENS 6
+#define OAEP_ZEROS 4
+static const size_t oaep_lens[OAEP_LENS] = {0, 1, 4, 16, OAEP_MSGLEN - 1, OAEP_MSGLEN};
+
+static void test_oaep(keypair_t keys) {
+	size_t count = OAEP_LENS;
+	byte_t msg[OAEP_MSGLEN], encoded[OAEP_LEN];
+	bytestream_t msgs[2 * OAEP_LENS], encs[2 * OAEP_LENS], decs[2 * OAEP_LENS];
+
+	/* Messages of leading zero bytes, then of nothing but zero bytes */
+	for (size_t i = 0; i < 2 * count; i++) {
+		size_t len = oaep_lens[i % count];
+		memset(msg, 0, OAEP_MSGLEN);
+		if (i < count && len > OAEP_ZEROS)
+			memcpy(msg + OAEP_ZEROS, kat_msg + 1, len - OAEP_ZEROS);
+
+		rsa_oaep_enc_b(encoded, bs_view_b(msg, len));
+		rsa_oaep_dec_b(encoded);
+		check("rsa_oaep_enc_b", len, oaep_eq(encoded, msg, len));
+
+		bs_init(msgs[i]);
+		bs_init(encs[i]);
+		bs_init(decs[i]);
+		bs_set_b(msgs[i], msg, len);
+	}
+
+	/* Batches, hashed in the multi-buffer kernels */
+	rsa_oaep_enc_batch(encs, msgs, 2 * count);
+	rsa_oaep_dec_batch(decs, encs, 2 * count);
+	for (size_t i = 0; i < 2 * count; i++)
+		check("rsa_oaep_enc_batch", bs_len(msgs[i]), bs_len(decs[i]) == OAEP_MSGLEN &&
+			oaep_eq(decs[i][0]->_data, msgs[i][0]->_data, bs_len(msgs[i])));
+
+	/* Encodings starting with zero bytes, given without them */
+	for (size_t i = 0; i < count; i++) {
+		do
+			rsa_oaep_enc(encs[i], msgs[i]);
+		while (encs[i][0]->_data[0]);
+		bs_set_b(decs[i], encs[i][0]->_data + 1, OAEP_LEN - 1);
+		rsa_oaep_dec(decs[i], decs[i]);
+		check("rsa_oaep_dec, leading zero", bs_len(msgs[i]), bs_len(decs[i]) == OAEP_MSGLEN &&
+			oaep_eq(decs[i][0]->_data, msgs[i][0]->_data, bs_len(msgs[i])));
+	}
+
+	/* Whole encryptions */
+	for (size_t i = 0; i < 2 * count; i++) {
+		rsa_enc(encs[i], msgs[i], keys.pk);
+		rsa_dec(decs[i], encs[i], keys.sk);
+		check("rsa_enc", bs_len(msgs[i]), bs_len(decs[i]) == OAEP_MSGLEN &&
+			oaep_eq(decs[i][0]->_data, msgs[i][0]->_data, bs_len(msgs[i])));
+	}
+
+	for (size_t i = 0; i < 2 * count; i++) {
+		bs_clear(msgs[i]);
+		bs_clear(encs[i]);
+		bs_clear(decs[i]);
+	}
+}
+
+/* Bytes of the file of the chunk index test, about 25 chunks */
+#define CHUNKIDX_TEST_SIZE (2 << 20)
+
+/* Offset of chunk `i` of an index */
+static size_t chunk_offset(bytestream_t const index, size_t i) {
+	word_t offset;
+	memcpy(&offset, index[0]->_data + CHUNKIDX_HEAD + i * CHUNKIDX_ENTRY, sizeof(word_t));
+	return offset;
+}
+
+static void test_chunkidx(keypair_t keys) {
+	/* Random bytes, so chunks are cut by content and not at CHUNKIDX_MAX */
+	byte_t *data = malloc(CHUNKIDX_TEST_SIZE), digest[CHUNKIDX_DIGESTLEN];
+	word_t x = 1;
+	for (size_t i = 0; i < CHUNKIDX_TEST_SIZE; i++) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		data[i] = x >> 56;
+	}
+	char path[32], signpath[32 + sizeof(SIGNSUFFIX)];
+	kat_file(path, data, CHUNKIDX_TEST_SIZE);
+	strcpy(signpath, path);
+	strcat(signpath, SIGNSUFFIX);
+
+	/* Every entry is the SHA3-256 of its chunk */
+	bytestream_t index;
+	bs_init(index);
+	chunkidx_file(index, path);
+	size_t count = (bs_len(index) - CHUNKIDX_HEAD) / CHUNKIDX_ENTRY;
+	check("chunkidx_file", count, count >= 3 && chunkidx_len(bs_view(index)) == bs_len(index));
+	for (size_t i = 0; i < count; i++) {
+		size_t start = chunk_offset(index, i), end = i + 1 < count ? chunk_offset(index, i + 1) : CHUNKIDX_TEST_SIZE;
+		sha3_256(digest, bs_view_b(data + start, end - start));
+		check("chunkidx_file, digest", end - start, !memcmp(digest,
+			index[0]->_data + CHUNKIDX_HEAD + i * CHUNKIDX_ENTRY + sizeof(word_t), CHUNKIDX_DIGESTLEN));
+	}
+
+	/* Ranges of the whole file, of one chunk, across chunks and past the end */
+	size_t one = chunk_offset(index, 1), two = chunk_offset(index, 2), last = chunk_offset(index, count - 1);
+	rsa_sign_file_index(path, path, keys.sk);
+	check("rsa_verify_file_range, all", CHUNKIDX_TEST_SIZE,
+		rsa_verify_file_range(signpath, path, 0, CHUNKIDX_TEST_SIZE, keys.pk));
+	check("rsa_verify_file_range, one chunk", two - one, rsa_verify_file_range(signpath, path, one, two - one, keys.pk));
+	check("rsa_verify_file_range, across chunks", two, rsa_verify_file_range(signpath, path, one - 1, 2, keys.pk));
+	check("rsa_verify_file_range, past the end", 2, !rsa_verify_file_range(signpath, path, CHUNKIDX_TEST_SIZE - 1, 2, keys.pk));
+
+	/* A tampered chunk fails the ranges covering it, and only those */
+	kat_flip(path, one + (two - one) / 2);
+	check("rsa_verify_file_range, tampered chunk", two - one, !rsa_verify_file_range(signpath, path, one, two - one, keys.pk));
+	check("rsa_verify_file_range, tampered byte", 1, !rsa_verify_file_range(signpath, path, one + (two - one) / 2, 1, keys.pk));
+	check("rsa_verify_file_range, across a tampered chunk", two, !rsa_verify_file_range(signpath, path, one - 1, 2, keys.pk));
+	check("rsa_verify_file_range, before a tampered chunk", one, rsa_verify_file_range(signpath, path, 0, one, keys.pk));
+	check("rsa_verify_file_range, after a tampered chunk", CHUNKIDX_TEST_SIZE - last,
+		rsa_verify_file_range(signpath, path, last, CHUNKIDX_TEST_SIZE - last, keys.pk));
+	check("rsa_verify_file, tampered chunk", CHUNKIDX_TEST_SIZE, !rsa_verify_file(signpath, path, keys.pk));
+
+	remove(signpath);
+	remove(path);
+	bs_clear(index);
+	free(data);
+}
+
+int main() {
+	for (size_t i = 0; i < KAT_MAXLEN; i++)
+		kat_msg[i] = i % 251;
+
+	test_arena();
+	test_sha3();
+	test_shake();
+	test_k12();
+	test_input();
+	test_mont();
+
+	keypair_t keys = rsa_gen_keypair();
+	test_verify(keys);
+	test_merkle(keys);
+	test_manifest(keys);
+	test_crt();
+	test_oaep(keys);
+	test_chunkidx(keys);
+	rsa_clear_keys(keys);
+
+	printf("%d checks, %d failed\n", checks, failures);
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}